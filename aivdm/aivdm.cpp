@@ -4,7 +4,197 @@
 #include "stdafx.h"
 #include "aivdm.h"
 #include "String.h"
+#include <stdlib.h>
+#include "aivdm_thread.h"
 
+static void count_records(void *arg, unsigned int worker,
+			  const struct ais_t *records, size_t n)
+{
+	unsigned long *counts = (unsigned long *)arg;
+
+	(void)records;
+	counts[worker * 16] += n;	/* a cache line apart per worker */
+}
+
+static size_t make_traffic(char *out, size_t outlen, size_t nmsgs)
+/* position reports from a few thousand vessels, every tenth a type 5 */
+{
+	struct ais_t ais;
+	size_t used = 0, n;
+	unsigned int i;
+
+	for (i = 0; i < nmsgs; i++) {
+		memset(&ais, 0, sizeof(ais));
+		ais.mmsi = 200000000 + (i * 7919) % 5000;
+		if (i % 10 == 9) {
+			ais.type = 5;
+			memcpy(ais.type5.callsign, "ABCD123", sizeof("ABCD123"));
+			memcpy(ais.type5.shipname, "BENCHMARK VESSEL", sizeof("BENCHMARK VESSEL"));
+			memcpy(ais.type5.destination, "ROTTERDAM", sizeof("ROTTERDAM"));
+			ais.type5.shiptype = 70;
+			ais.type5.to_bow = 100;
+			ais.type5.to_stern = 20;
+		} else {
+			ais.type = 1;
+			ais.type1.speed = i % 300;
+			ais.type1.lon = (int)(i % 100000) * 60;
+			ais.type1.lat = 30000000 - (int)(i % 50000) * 60;
+			ais.type1.course = i % 3600;
+			ais.type1.heading = i % 360;
+			ais.type1.second = i % 60;
+		}
+		n = aivdm_encode_to(&ais, NULL, out + used, outlen - used);
+		if (n == 0)
+			break;
+		used += n;
+	}
+	return used;
+}
+
+static int benchmark(unsigned int maxworkers)
+/* sentences per second through the pipeline at 1, 2, 4... workers */
+{
+	const size_t nmsgs = 2000000, chunk = 1 << 20;
+	struct aivdm_pipeline_opts_t opts;
+	struct aivdm_pipeline_stats_t stats;
+	struct aivdm_pipeline_t *pipeline;
+	unsigned long counts[AIVDM_PIPELINE_MAXWORKERS * 16];
+	size_t len, off, outlen = nmsgs * 2 * AIVDM_SENTENCE_MAX;
+	char *traffic = (char *)malloc(outlen);
+	unsigned int workers, i;
+	unsigned long records;
+	double start, secs;
+
+	if (traffic == NULL)
+		return 1;
+	len = make_traffic(traffic, outlen, nmsgs);
+	printf("%lu bytes of traffic\n", (unsigned long)len);
+	for (workers = 1; workers <= maxworkers; workers *= 2) {
+		aivdm_pipeline_opts_init(&opts);
+		opts.workers = workers;
+		opts.type24 = 1;
+		opts.sink = count_records;
+		opts.arg = counts;
+		memset(counts, 0, sizeof(counts));
+		pipeline = aivdm_pipeline_create(&opts);
+		if (pipeline == NULL)
+			break;
+		start = aivdm_clock();
+		for (off = 0; off < len; off += chunk)
+			aivdm_pipeline_feed(pipeline, 0, traffic + off,
+					    len - off < chunk ? len - off : chunk);
+		aivdm_pipeline_flush(pipeline);
+		secs = aivdm_clock() - start;
+		aivdm_pipeline_stats(pipeline, &stats);
+		aivdm_pipeline_destroy(pipeline);
+		for (records = 0, i = 0; i < workers; i++)
+			records += counts[i * 16];
+		printf("%2u workers: %lu sentences, %lu records in %.3f s, "
+		       "%.0f sentences/s, %.1f MB/s\n",
+		       workers, stats.sentences, records, secs,
+		       stats.sentences / secs, len / secs / 1e6);
+	}
+	free(traffic);
+	return 0;
+}
+
+static void binary_message(struct ais_t *ais, unsigned int type, size_t bitcount)
+/* an addressed, structured type 25 or 26 with bitcount data bits */
+{
+	memset(ais, 0, sizeof(*ais));
+	ais->type = type;
+	ais->mmsi = 244670316;
+	if (type == 25) {
+		ais->type25.addressed = ais->type25.structured = 1;
+		ais->type25.dest_mmsi = 211378120;
+		ais->type25.app_id = 0x1234;
+		ais->type25.bitcount = bitcount;
+		memset(ais->type25.bitdata, 0xa5, sizeof(ais->type25.bitdata));
+	} else {
+		ais->type26.addressed = ais->type26.structured = 1;
+		ais->type26.dest_mmsi = 211378120;
+		ais->type26.app_id = 0x1234;
+		ais->type26.bitcount = bitcount;
+		memset(ais->type26.bitdata, 0xa5, sizeof(ais->type26.bitdata));
+		ais->type26.radio = 0x12345;
+	}
+}
+
+static int binary_roundtrip(unsigned int type, size_t bitcount)
+/* 1 if binary_message() comes back from its sentences with all its data */
+{
+	struct ais_t ais, back;
+	struct aivdm_context_t ctx;
+	struct aivdm_block_result_t result;
+	unsigned char status[AIVDM_MAX_FRAGMENTS];
+	char out[AIVDM_MAX_FRAGMENTS * AIVDM_SENTENCE_MAX];
+	size_t len;
+
+	binary_message(&ais, type, bitcount);
+	len = aivdm_encode_to(&ais, NULL, out, sizeof(out));
+	if (len == 0)
+		return 0;
+	aivdm_context_init(&ctx);
+	memset(&result, 0, sizeof(result));
+	result.records = &back;
+	result.maxrecords = 1;
+	result.status = status;
+	result.maxsentences = AIVDM_MAX_FRAGMENTS;
+	aivdm_decode_block(&ctx, out, len, &result);
+	if (result.nrecords != 1 || back.type != type)
+		return 0;
+	return (type == 25 ? back.type25.bitcount : back.type26.bitcount) == bitcount;
+}
+
+static int binary_rejected(unsigned int type, size_t bitcount)
+/* 1 if the encoder turns binary_message() away as too long */
+{
+	struct ais_t ais;
+
+	binary_message(&ais, type, bitcount);
+	return aivdm_validate(&ais) == AIS_FIELD_PAYLOAD;
+}
+
+static int selftest(void)
+/* encoder and peek boundaries; prints each failure, nonzero if any */
+{
+	static const char *const malformed[] = {
+		"!AIVDM,0,1,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0",
+		"!AIVDM,2,3,1,A,15RTgt0PAso;90TKcjM8h6g208CQ,0",
+		"!AIVDM,12,1,1,A,15RTgt0PAso;90TKcjM8h6g208CQ,0",
+		"!AIVDM,1,0,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0",
+	};
+	/* addressed and structured: 86 header bits, and 20 radio bits on 26 */
+	const size_t max25 = 168 - 86, max26 = 1004 - 86 - 20;
+	struct aivdm_peek_t peek;
+	int failed = 0;
+	size_t i;
+
+	if (!binary_roundtrip(25, max25)) {
+		printf("type 25 with %lu data bits did not round-trip\n", (unsigned long)max25);
+		failed++;
+	}
+	if (!binary_rejected(25, max25 + 1)) {
+		printf("type 25 with %lu data bits was not rejected\n", (unsigned long)max25 + 1);
+		failed++;
+	}
+	if (!binary_roundtrip(26, max26)) {
+		printf("type 26 with %lu data bits did not round-trip\n", (unsigned long)max26);
+		failed++;
+	}
+	if (!binary_rejected(26, max26 + 1)) {
+		printf("type 26 with %lu data bits was not rejected\n", (unsigned long)max26 + 1);
+		failed++;
+	}
+	for (i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+		if (aivdm_peek(malformed[i], strlen(malformed[i]),
+			       AIVDM_DECODE_NOCHECKSUM, &peek) != 0) {
+			printf("peek accepted %s\n", malformed[i]);
+			failed++;
+		}
+	printf("%d failed\n", failed);
+	return failed != 0;
+}
 
 int _tmain(int argc, _TCHAR* argv[])
 {
@@ -17,6 +207,15 @@ int _tmain(int argc, _TCHAR* argv[])
 	struct ais_t ais;
 	char out1[256], out2[256];
 
+	/* -b [workers]: pipeline throughput instead of the samples */
+	if (argc > 1 && _tcscmp(argv[1], _T("-b")) == 0)
+		return benchmark(argc > 2 ? (unsigned int)_ttoi(argv[2])
+					  : aivdm_cpu_count());
+	/* -t: boundary checks instead of the samples */
+	if (argc > 1 && _tcscmp(argv[1], _T("-t")) == 0)
+		return selftest();
+
+	aivdm_context_init(&ais_context);
 	aivdm_decode(msg, strlen(msg),&ais_context, &ais);
 
 	aivdm_encode(&ais, out1, out2);
@@ -384,6 +384,11 @@ struct ais_t
 	} type23;
 	/* Type 24 - Class B CS Static Data Report */
 	struct {
+	    unsigned int part;		/* which half this report carries */
+#define AIS_TYPE24_PART_A	0
+#define AIS_TYPE24_PART_B	1
+#define AIS_TYPE24_PART_AB	2	/* both halves merged by the decoder;
+					 * encode them as A and B */
 	    char shipname[AIS_SHIPNAME_MAXLEN+1];	/* vessel name */
 	    unsigned int shiptype;	/* ship type code */
 	    char vendorid[8];		/* vendor ID */
@@ -419,9 +424,27 @@ struct ais_t
 	    char bitdata[(AIS_TYPE26_BINARY_MAX + 7) / 8];
 	    unsigned int radio;		/* radio status bits */
 	} type26;
+	/* Type 27 - Long Range AIS Broadcast message */
+	struct {
+	    int accuracy;		/* position accuracy */
+	    int raim;			/* RAIM flag */
+	    unsigned int status;	/* navigation status */
+#define AIS_LONGRANGE_LATLON_SCALE	600.0
+	    int lon;			/* longitude */
+#define AIS_LONGRANGE_LON_NOT_AVAILABLE	0x1a838
+	    int lat;			/* latitude */
+#define AIS_LONGRANGE_LAT_NOT_AVAILABLE	0xd548
+	    unsigned int speed;		/* speed over ground in knots */
+#define AIS_LONGRANGE_SPEED_NOT_AVAILABLE	63
+	    unsigned int course;	/* course over ground in degrees */
+#define AIS_LONGRANGE_COURSE_NOT_AVAILABLE	511
+	    int gnss;			/* are we reporting GNSS position? */
+	} type27;
     };
 };
 
+#include "aivdm_schema.h"
+
 /* some multipliers for interpreting GPS output */
 #define METERS_TO_FEET	3.2808399	/* Meters to U.S./British feet */
 #define METERS_TO_MILES	0.00062137119	/* Meters to miles */
@@ -445,21 +468,1069 @@ struct ais_t
 
 #define NMEA_MAX 91
 #define AIS_SHIPNAME_MAXLEN 20
+/* zeroed tail kept after the payload in bits[] for word-wide reads */
+#define AIVDM_BITS_SLACK	16
+/* longest line aivdm_decode_block() carries from one block to the next */
+#define AIVDM_LINE_MAX	128
+
+/*
+ * Type 24 arrives in two halves, A with the name and B with the rest,
+ * usually well apart and interleaved with other vessels.  This cache
+ * keeps the last-known halves per MMSI so that each can be paired with
+ * its own vessel's other half.  Lookups go through an open-addressing
+ * table; the least recently heard vessel is forgotten when it fills.
+ */
+#ifndef AIVDM_TYPE24_CACHE
+#define AIVDM_TYPE24_CACHE	4096	/* vessels, a power of two */
+#endif
+#define AIVDM_TYPE24_HAVE_A	0x01
+#define AIVDM_TYPE24_HAVE_B	0x02
+struct aivdm_type24_entry_t {
+    unsigned int mmsi;
+    unsigned short newer, older;	/* LRU list */
+    unsigned int shiptype;
+    unsigned int dim[4];		/* dimensions, or mothership MMSI in dim[0] */
+    char shipname[AIS_SHIPNAME_MAXLEN+1];
+    char vendorid[8];
+    char callsign[8];
+    unsigned char have;			/* AIVDM_TYPE24_HAVE_* */
+};
+struct aivdm_type24_cache_t {
+    struct aivdm_type24_entry_t entry[AIVDM_TYPE24_CACHE];
+    unsigned short index[2 * AIVDM_TYPE24_CACHE];	/* entry + 1, 0 when free */
+    size_t count;
+    unsigned short newest, oldest;
+};
+
+/* an empty cache; a zero-filled one is empty too */
+void aivdm_type24_cache_init(struct aivdm_type24_cache_t *cache);
+
+/*
+ * Record the half of type 24 in ais and complete ais from the other
+ * half if the vessel's is known, making it AIS_TYPE24_PART_AB.  Returns
+ * AIVDM_STATUS_PENDING for a part A still waiting for its B, otherwise
+ * AIVDM_STATUS_DECODED.  The decoders call this when given a cache.
+ */
+int aivdm_type24_merge(struct aivdm_type24_cache_t *cache, struct ais_t *ais);
+
+/*
+ * Fill ais with what is known of mmsi's static data as a type 24
+ * record; returns the AIVDM_TYPE24_HAVE_* bits, 0 if nothing is known.
+ */
+int aivdm_type24_lookup(const struct aivdm_type24_cache_t *cache,
+			unsigned int mmsi, struct ais_t *ais);
+
+/*
+ * Message filters, compiled from expressions such as
+ *
+ *	type in {1,2,3,18} && lat in [22000000,23000000] && speed > 50
+ *
+ * and evaluated on the raw payload bits, so a rejected message never
+ * fills in a struct ais_t.  Field names are those of struct ais_t
+ * members; a field is looked up in the layout of whatever type each
+ * message turns out to be, and a message without it fails the test.
+ * Values are raw integers in the units the struct uses.  Comparisons
+ * are ==, !=, <, <=, > and >=, "in [lo,hi]" is an inclusive range and
+ * "in {a,b,...}" a set; they combine with &&, ||, ! and parentheses.
+ * Type 24 part B is taken to carry dimensions even from auxiliary
+ * craft, whose mothership MMSI sits there instead, so mothership_mmsi
+ * cannot be named.
+ */
+#define AIVDM_FILTER_PREDS	16	/* comparisons in one filter */
+#define AIVDM_FILTER_OPS	48	/* comparisons and operators in one filter */
+#define AIVDM_FILTER_SET	8	/* values in one set */
+
+/* where a field sits in one message type; width 0 where it has none */
+struct aivdm_filter_loc_t {
+    unsigned short start, guard_start;
+    unsigned char width, sign, guard_width, guard_value;
+};
+struct aivdm_filter_pred_t {
+    struct aivdm_filter_loc_t at[28];	/* by message type */
+    int nvalues;			/* 0 for the range lo-hi */
+    long lo, hi;
+    long value[AIVDM_FILTER_SET];
+};
+struct aivdm_filter_t {
+    struct aivdm_filter_pred_t pred[AIVDM_FILTER_PREDS];
+    int npreds;
+    signed char op[AIVDM_FILTER_OPS];	/* postfix program */
+    int nops;
+};
+
+/*
+ * Compile text into filter.  Returns -1 on success, otherwise the
+ * offset in text where compiling failed.
+ */
+int aivdm_filter_compile(struct aivdm_filter_t *filter, const char *text);
+
+/* nonzero if the payload of bitlen bits passes; bits needs read slack */
+int aivdm_filter_match(const struct aivdm_filter_t *filter,
+		       const unsigned char *bits, size_t bitlen);
+
+/*
+ * Projections: decode only the fields a consumer reads.  Compiling one
+ * resolves the requested member names against every message type's
+ * layout into a per-type plan of extractions; applying it runs the plan
+ * for the message's type and nothing else.  Binary payloads, the type
+ * 21 name extension and type 24 pairing are outside any projection,
+ * and type 24 part B reads as dimensions as it does for filters.
+ * Fields a message lacks are left alone.
+ */
+#define AIVDM_PROJECTION_ROWS	320	/* field extractions over all types */
+
+struct aivdm_projection_row_t {
+    unsigned short id;		/* enum aivdm_field_id */
+    unsigned short guard_start;
+    unsigned char guard_width, guard_value;
+};
+struct aivdm_projection_t {
+    unsigned short first[29];	/* rows of type t are first[t] to first[t+1] */
+    struct aivdm_projection_row_t row[AIVDM_PROJECTION_ROWS];
+};
+
+/*
+ * Compile the n member names (type, repeat and mmsi always come along)
+ * into proj.  Returns -1 on success, otherwise the index of the first
+ * name no message type has.
+ */
+int aivdm_projection_compile(struct aivdm_projection_t *proj,
+			     const char *const *names, size_t n);
+
+/* store the projected fields of a payload in ais; bits needs read slack */
+void aivdm_project(const struct aivdm_projection_t *proj,
+		   const unsigned char *bits, size_t bitlen, struct ais_t *ais);
+
+/*
+ * Or hand them to a visitor one by one: value for numeric fields, text
+ * (NUL-terminated, length in value) for text fields.
+ */
+typedef void (*aivdm_visitor_t)(void *arg, unsigned int id,
+				long value, const char *text);
+void aivdm_visit(const struct aivdm_projection_t *proj,
+		 const unsigned char *bits, size_t bitlen,
+		 aivdm_visitor_t visitor, void *arg);
+
+/*
+ * Decoder options.  Sentences whose *hh checksum does not match are
+ * rejected unless the feed is trusted to be clean already.
+ */
+#define AIVDM_DECODE_NOCHECKSUM	0x01	/* skip checksum verification */
+/*
+ * Record payloads stay in the decoder's bits, valid only until its next
+ * sentence, instead of being copied to the arena.  aivdm_decode_block()
+ * always copies.
+ */
+#define AIVDM_DECODE_ZEROCOPY	0x02
+
+/* compact records and their arena, further down */
+union aivdm_record_t;
+struct aivdm_arena_t;
+
 struct aivdm_context_t {
     /* hold context for decoding AIDVM packet sequences */
     int part, await;		/* for tracking AIDVM parts in a multipart sequence */
-    unsigned char *field[NMEA_MAX];
-    unsigned char fieldcopy[NMEA_MAX+1];
     unsigned char bits[2048];
     char shipname[AIS_SHIPNAME_MAXLEN+1];
+    struct aivdm_type24_cache_t *type24;	/* NULL pairs type 24 halves by arrival */
+    unsigned int flags;		/* AIVDM_DECODE_* */
+    const struct aivdm_filter_t *filter;	/* NULL decodes everything */
+    const struct aivdm_projection_t *projection;	/* NULL decodes every field */
+    struct aivdm_arena_t *arena;	/* payloads and text of compact records */
     size_t bitlen;
+    char carry[AIVDM_LINE_MAX];	/* unfinished last line of the previous block */
+    size_t carrylen;
+    int overlong;		/* carried line outgrew carry[], skip to its end */
 };
 
+/* a fresh context; static or zero-filled contexts are fresh too */
+void aivdm_context_init(struct aivdm_context_t *ais_context);
+
 int aivdm_decode(const char *buf, size_t buflen,
 		  struct aivdm_context_t *ais_context, struct ais_t *ais);
 
+/*
+ * Decode one sentence into a compact record; returns an AIVDM_STATUS_*
+ * code, AIVDM_STATUS_REJECTED also when the arena is missing or full.
+ */
+int aivdm_decode_record(struct aivdm_context_t *ais_context,
+			const char *buf, size_t buflen,
+			union aivdm_record_t *rec);
+
+/* what aivdm_peek() can tell from a sentence without decoding it */
+struct aivdm_peek_t {
+    int await, part;		/* fragment count and number */
+    int seqid;			/* -1 when the field is empty */
+    char channel;		/* '\0' when the field is empty */
+    int header;			/* nonzero when the next three are valid */
+    unsigned int type, repeat, mmsi;
+};
+
+/*
+ * Read the sentence framing and, from a first fragment, the message
+ * type, repeat indicator and MMSI out of the first seven payload
+ * characters, so that unwanted traffic can be dropped before it is
+ * reassembled and decoded.  flags takes AIVDM_DECODE_NOCHECKSUM.
+ * Returns 0 for a sentence that would be rejected as malformed.
+ */
+int aivdm_peek(const char *buf, size_t buflen, unsigned int flags,
+	       struct aivdm_peek_t *peek);
+
+/* what became of each sentence handed to aivdm_decode_block() */
+#define AIVDM_STATUS_REJECTED	0	/* malformed, wrong length or unknown type */
+#define AIVDM_STATUS_DECODED	1	/* completed a message, see records[] */
+#define AIVDM_STATUS_PENDING	2	/* fragment kept, waiting for the rest */
+#define AIVDM_STATUS_IGNORED	3	/* not an AIS sentence */
+#define AIVDM_STATUS_FILTERED	4	/* complete, but turned away by the filter */
+#define AIVDM_STATUS_DEFERRED	5	/* left for the general decoder, see aivdm_decode_columns() */
+#define AIVDM_STATUS_COUNT	6	/* for arrays indexed by status */
+
+struct aivdm_block_result_t {
+    struct ais_t *records;	/* completed messages, in input order */
+    union aivdm_record_t *compact;	/* used instead of records unless NULL */
+    size_t maxrecords;
+    size_t nrecords;		/* set by the decoder */
+    unsigned char *status;	/* one AIVDM_STATUS_* per non-empty line */
+    size_t maxsentences;
+    size_t nsentences;		/* set by the decoder */
+};
+
+/*
+ * Decode a block of newline-separated sentences (CR LF or LF) in
+ * place, without copying them.  A last line with no newline yet is kept
+ * in the context and completed by the next call.  Returns the number of
+ * bytes of buf used up; that is less than buflen only when records or
+ * status filled up, or when compact records are asked for and the
+ * arena has less than AIVDM_RECORD_ARENA_MAX bytes left.  The caller
+ * should then make room and pass the rest again.
+ */
+size_t aivdm_decode_block(struct aivdm_context_t *ais_context,
+			  const char *buf, size_t buflen,
+			  struct aivdm_block_result_t *result);
+
+/*
+ * Columnar decoding of the position reports that always fit one
+ * sentence of 168 bits: types 1, 2, 3, 9 and 18.  Rows are decoded a
+ * batch at a time, one field at a time across the batch, into
+ * structure-of-arrays columns of the caller's.  Values are as in
+ * struct ais_t, in each type's own units (type 9 speed is in knots);
+ * a field the type lacks gets its not-available value.  Columns left
+ * NULL are skipped.
+ */
+struct aivdm_columns_t {
+    size_t max;			/* rows each column has room for */
+    size_t n;			/* rows filled so far */
+    unsigned int *type;
+    unsigned int *mmsi;
+    unsigned int *status;	/* types 1-3, else 15, not defined */
+    int *turn;			/* types 1-3, else -AIS_TURN_NOT_AVAILABLE */
+    unsigned int *speed;
+    unsigned int *accuracy;
+    int *lon;
+    int *lat;
+    unsigned int *course;
+    unsigned int *heading;	/* not type 9: AIS_HEADING_NOT_AVAILABLE */
+    unsigned int *second;
+};
+
+/*
+ * Decode n sentences, sentence i at buf[i] with len[i] characters and
+ * no newline, appending rows to cols from cols->n on.  status[i] gets
+ * AIVDM_STATUS_DECODED for a sentence that became a row, REJECTED or
+ * IGNORED as aivdm_decode_block() would, and DEFERRED for any other
+ * AIS sentence, multipart ones included, which the caller hands to the
+ * general decoder in order.  flags takes AIVDM_DECODE_NOCHECKSUM.
+ * Returns the number of sentences looked at, less than n only when the
+ * columns filled up.
+ */
+size_t aivdm_decode_columns(const char *const *buf, const size_t *len,
+			    size_t n, unsigned int flags,
+			    struct aivdm_columns_t *cols,
+			    unsigned char *status);
+
+/*
+ * Multipart reassembly for feeds that interleave many receivers and
+ * both channels.  Each message being put together is keyed by the
+ * caller's source number, the channel and the sequence id, so
+ * fragments of different messages no longer land in one buffer.
+ */
+#define AIVDM_REASM_SLOTS	256	/* messages in flight at once */
+#define AIVDM_REASM_TABLE	(2 * AIVDM_REASM_SLOTS)	/* probe table, a power of two */
+/* bytes per message: the longest payload, 1008 bits, and read slack */
+#define AIVDM_REASM_BITS	(128 + AIVDM_BITS_SLACK)
+struct aivdm_reasm_slot_t {
+    unsigned long started;	/* caller's clock at the first fragment */
+    unsigned long tick;		/* fragment count at the first fragment */
+    unsigned int source;	/* caller's receiver or feed number */
+    unsigned short bitlen;
+    unsigned short buffer;	/* index into pool[] */
+    unsigned char channel;	/* '\0' when the sentence left it empty */
+    unsigned char seqid;	/* 0xff when the sentence left it empty */
+    unsigned char await, part;	/* part 0 marks an unused slot */
+};
+struct aivdm_reasm_t {
+    struct aivdm_reasm_slot_t slot[AIVDM_REASM_TABLE];
+    unsigned char pool[AIVDM_REASM_SLOTS][AIVDM_REASM_BITS];
+    unsigned short freebuf[AIVDM_REASM_SLOTS];	/* unused pool[] entries */
+    size_t nfree;
+    unsigned long timeout;	/* clock units a message may take, 0 for no limit */
+    unsigned long maxage;	/* fragments of any message meanwhile, 0 for no limit */
+    unsigned long tick;		/* fragments seen */
+    unsigned long dropped;	/* messages given up on unfinished */
+    unsigned char bits[AIVDM_REASM_BITS];	/* single-sentence messages */
+    char shipname[AIS_SHIPNAME_MAXLEN+1];
+    struct aivdm_type24_cache_t *type24;	/* NULL pairs type 24 halves by arrival */
+    unsigned int flags;		/* AIVDM_DECODE_* */
+    const struct aivdm_filter_t *filter;	/* NULL decodes everything */
+    const struct aivdm_projection_t *projection;	/* NULL decodes every field */
+    struct aivdm_arena_t *arena;	/* payloads and text of compact records */
+};
+
+void aivdm_reasm_init(struct aivdm_reasm_t *reasm,
+		      unsigned long timeout, unsigned long maxage);
+
+/*
+ * Feed one sentence heard from source at time now (any unit that
+ * matches the timeout).  Returns an AIVDM_STATUS_* code; ais is filled
+ * in only on AIVDM_STATUS_DECODED.
+ */
+int aivdm_reasm_decode(struct aivdm_reasm_t *reasm, unsigned int source,
+		       unsigned long now, const char *buf, size_t buflen,
+		       struct ais_t *ais);
+
+/* the same into a compact record, as aivdm_decode_record() does */
+int aivdm_reasm_decode_record(struct aivdm_reasm_t *reasm,
+			      unsigned int source, unsigned long now,
+			      const char *buf, size_t buflen,
+			      union aivdm_record_t *rec);
+
+/* drop every message that has timed out by now; returns how many */
+size_t aivdm_reasm_expire(struct aivdm_reasm_t *reasm, unsigned long now);
+
+/*
+ * Multi-threaded decoding.  The thread that feeds the pipeline splits
+ * its input into sentences, peeks at each one and hands it to one of
+ * several worker threads, each with its own reassembly table and type
+ * 24 cache.  Sentences are dealt out by MMSI; later fragments follow
+ * their first fragment, found by source, channel and sequence id.  So
+ * every message from one vessel is decoded by the same worker, in the
+ * order it was fed, while different vessels are decoded in parallel.
+ */
+#define AIVDM_PIPELINE_MAXWORKERS	64
+#define AIVDM_PIPELINE_BATCH	(32 * 1024)	/* bytes of sentences per handover */
+#define AIVDM_PIPELINE_DEPTH	4	/* batches each worker may have queued */
+#define AIVDM_PIPELINE_RECORDS	256	/* records delivered to the sink at once */
+
+/*
+ * Receives the decoded records of worker, in the order their sentences
+ * were fed.  It is called on the worker's own thread, so it runs
+ * concurrently for different workers; per-worker state needs no lock.
+ */
+typedef void (*aivdm_sink_t)(void *arg, unsigned int worker,
+			     const struct ais_t *records, size_t n);
+
+struct aivdm_pipeline_opts_t {
+    unsigned int workers;	/* worker threads, 0 for one per processor */
+    unsigned long maxage;	/* reassembly bound in fragments, 0 for none */
+    int type24;			/* nonzero pairs type 24 halves by MMSI */
+    unsigned int flags;		/* AIVDM_DECODE_* */
+    const struct aivdm_filter_t *filter;	/* NULL decodes everything */
+    const struct aivdm_projection_t *projection;	/* NULL decodes every field */
+    aivdm_sink_t sink;
+    void *arg;			/* passed to sink */
+};
+
+struct aivdm_pipeline_stats_t {
+    unsigned long sentences;	/* non-empty lines fed */
+    unsigned long status[AIVDM_STATUS_COUNT];	/* counts by AIVDM_STATUS_* */
+    unsigned long dropped;	/* unfinished messages given up on */
+};
+
+struct aivdm_pipeline_t;
+
+/* defaults: one worker per processor, no filter, every field */
+void aivdm_pipeline_opts_init(struct aivdm_pipeline_opts_t *opts);
+
+/* start the workers; NULL if memory or threads ran out */
+struct aivdm_pipeline_t *aivdm_pipeline_create(
+			const struct aivdm_pipeline_opts_t *opts);
+
+/*
+ * Deal out a block of newline-separated sentences from source.  Only
+ * one thread may feed a pipeline.  A last line with no newline yet is
+ * kept and completed by the next call.  Blocks while every worker is
+ * busy with a full queue.
+ */
+void aivdm_pipeline_feed(struct aivdm_pipeline_t *pipeline,
+			 unsigned int source, const char *buf, size_t buflen);
+
+/* hand over whatever is batched and wait until the sink has seen it all */
+void aivdm_pipeline_flush(struct aivdm_pipeline_t *pipeline);
+
+/* totals so far; exact after aivdm_pipeline_flush() */
+void aivdm_pipeline_stats(struct aivdm_pipeline_t *pipeline,
+			  struct aivdm_pipeline_stats_t *stats);
+
+/* flush, stop the workers and free everything */
+void aivdm_pipeline_destroy(struct aivdm_pipeline_t *pipeline);
+
+/* scratch size for one encoded payload, including bit-writer slack */
+#define AIVDM_ENCODE_BUFSIZE	160
+
+/* pack ais into bits[AIVDM_ENCODE_BUFSIZE]; returns the bit length, 0 if unencodable */
+size_t aivdm_encode_payload(const struct ais_t *ais, unsigned char *bits);
+
+/*
+ * Check that every numeric field of ais fits its width in the layout.
+ * Returns -1 if the message is encodable, otherwise the aivdm_field_id
+ * of the first offending field (AIS_FIELD_type for unknown types,
+ * AIS_FIELD_PAYLOAD for binary data the message cannot carry).
+ */
+int aivdm_validate(const struct ais_t *ais);
+
 int aivdm_encode(struct ais_t *ais, char * out1, char * out2);
 
+/*
+ * Sentence framing for aivdm_encode_sentences().  NMEA 0183 caps a
+ * sentence at 82 characters including CR LF, which leaves room for 60
+ * payload characters; the fragment count is a single digit.
+ */
+#define AIVDM_MAX_PAYLOAD_CHARS	60
+#define AIVDM_MAX_FRAGMENTS	9
+#define AIVDM_SENTENCE_MAX	82
+
+#define AIVDM_OPT_ROTATE_SEQID	0x01	/* step seqid 0-9 after each multipart message */
+#define AIVDM_OPT_ALTERNATE_CHANNEL	0x02	/* swap channel A/B after each message */
+
+struct aivdm_sentence_opts_t {
+    const char *talker;		/* "AIVDM", or "AIVDO" for own-ship reports */
+    char channel;		/* 'A' or 'B', '\0' leaves the field empty */
+    int seqid;			/* 0-9, used only by multipart messages */
+    unsigned int maxchars;	/* payload characters per sentence, at most 60;
+				 * rounded down to a multiple of 4 */
+    unsigned int flags;		/* AIVDM_OPT_* */
+};
+
+/* defaults: !AIVDM on channel A, sequence id 1, full-length sentences */
+void aivdm_sentence_opts_init(struct aivdm_sentence_opts_t *opts);
+
+/*
+ * Encode ais as one or more sentences written back to back into out,
+ * each ending in CR LF and not NUL-terminated; lens[i] receives the
+ * length of sentence i.  Returns the number of sentences, or 0 if the
+ * message cannot be encoded or does not fit in outlen bytes or
+ * maxfrags sentences.  opts is advanced as its flags ask.
+ */
+int aivdm_encode_sentences(const struct ais_t *ais,
+			   struct aivdm_sentence_opts_t *opts,
+			   char *out, size_t outlen,
+			   size_t *lens, int maxfrags);
+
+/*
+ * The same without the per-sentence lengths: returns the exact number
+ * of bytes written to out, 0 if ais is unencodable or outlen too small.
+ * Nothing past the last CR LF is touched.  opts may be NULL for the
+ * defaults.
+ */
+size_t aivdm_encode_to(const struct ais_t *ais,
+		       struct aivdm_sentence_opts_t *opts,
+		       char *out, size_t outlen);
+
+/*
+ * Encode n messages back to back into out, CR LF after every sentence,
+ * ready to be written out as is.  The sentences of ais[i] occupy bytes
+ * offsets[i] to offsets[i+1], so offsets needs n + 1 entries; messages
+ * that cannot be encoded get an empty span.  Returns how many messages
+ * were consumed, fewer than n if out filled up.  opts may be NULL.
+ */
+size_t aivdm_encode_batch(const struct ais_t *ais, size_t n,
+			  struct aivdm_sentence_opts_t *opts,
+			  char *out, size_t outlen, size_t *offsets);
+
+/*
+ * Lock-free bounded rings for handing sentences and records between
+ * threads.  Positions are free-running counters; the indices each side
+ * writes sit on cache lines of their own, and each side keeps a cached
+ * copy of the other's index so it only looks across when it seems to
+ * have run out.  Nothing is allocated: the caller supplies the memory.
+ */
+#define AIVDM_CACHE_LINE	64
+
+/*
+ * One producer, one consumer, variable-length records stored in place.
+ * Records are written and read where they lie; produced records become
+ * visible together at aivdm_ring_publish(), consumed ones are given
+ * back together at aivdm_ring_release(), so a batch costs one index
+ * store on each side.
+ */
+struct aivdm_ring_t {
+    unsigned char *buf;		/* size bytes, 8-byte aligned */
+    unsigned int mask;		/* size - 1 */
+    char pad0[AIVDM_CACHE_LINE - sizeof(unsigned char *) - sizeof(unsigned int)];
+    /* the producer's line */
+    volatile unsigned int tail;	/* end of the published records */
+    unsigned int ptail;		/* end of the produced ones */
+    unsigned int headcache;	/* head as last seen */
+    char pad1[AIVDM_CACHE_LINE - 3 * sizeof(unsigned int)];
+    /* the consumer's line */
+    volatile unsigned int head;	/* start of the unreleased records */
+    unsigned int chead;		/* start of the unconsumed ones */
+    unsigned int tailcache;	/* tail as last seen */
+    char pad2[AIVDM_CACHE_LINE - 3 * sizeof(unsigned int)];
+};
+
+/*
+ * size must be a power of two, and a record may take at most half of
+ * it, counting 8 bytes of header.  Returns 0, or -1 for a bad size.
+ */
+int aivdm_ring_init(struct aivdm_ring_t *ring, void *buf, size_t size);
+
+/*
+ * Room for a record of up to maxlen bytes, contiguous and 8-byte
+ * aligned, or NULL if the ring is too full.  Nothing is produced until
+ * aivdm_ring_produce(); a reservation left unproduced costs nothing.
+ */
+void *aivdm_ring_reserve(struct aivdm_ring_t *ring, size_t maxlen);
+/* keep the first len bytes of the last reservation as a record */
+void aivdm_ring_produce(struct aivdm_ring_t *ring, size_t len);
+/* make every produced record visible to the consumer */
+void aivdm_ring_publish(struct aivdm_ring_t *ring);
+
+/* the next published record and its length, or NULL if there is none */
+const void *aivdm_ring_peek(struct aivdm_ring_t *ring, size_t *len);
+/* step past the record aivdm_ring_peek() returned */
+void aivdm_ring_consume(struct aivdm_ring_t *ring);
+/* hand the space of every consumed record back to the producer */
+void aivdm_ring_release(struct aivdm_ring_t *ring);
+
+/* copy in up to n records and publish them; returns how many fit */
+size_t aivdm_ring_push(struct aivdm_ring_t *ring, const void *const *data,
+		       const size_t *lens, size_t n);
+/*
+ * Copy out up to n records, record i to out + i * stride with its
+ * length in lens[i], and release them; records longer than stride are
+ * truncated.  Returns how many were taken.
+ */
+size_t aivdm_ring_pop(struct aivdm_ring_t *ring, void *out, size_t stride,
+		      size_t *lens, size_t n);
+
+/*
+ * Any number of producers and consumers, records of up to cellsize
+ * bytes copied in and out of fixed cells.  A batch of n records is
+ * claimed with a single compare-and-swap on tail or head.
+ */
+struct aivdm_mpmc_t {
+    unsigned char *cells;	/* ncells * stride bytes, 8-byte aligned */
+    size_t cellsize;		/* largest record */
+    size_t stride;		/* sequence and length words, then the record */
+    unsigned int mask;		/* ncells - 1 */
+    char pad0[AIVDM_CACHE_LINE - sizeof(unsigned char *) - 2 * sizeof(size_t)
+	      - sizeof(unsigned int)];
+    volatile unsigned int tail;
+    char pad1[AIVDM_CACHE_LINE - sizeof(unsigned int)];
+    volatile unsigned int head;
+    char pad2[AIVDM_CACHE_LINE - sizeof(unsigned int)];
+};
+
+/* bytes of memory aivdm_mpmc_init() needs for ncells cells */
+size_t aivdm_mpmc_bufsize(size_t ncells, size_t cellsize);
+
+/* ncells must be a power of two; returns 0, or -1 if it is not */
+int aivdm_mpmc_init(struct aivdm_mpmc_t *q, void *buf,
+		    size_t ncells, size_t cellsize);
+
+/* copy in up to n records; returns how many fit, 0 if full */
+size_t aivdm_mpmc_push(struct aivdm_mpmc_t *q, const void *const *data,
+		       const size_t *lens, size_t n);
+
+/* copy out up to n records as aivdm_ring_pop() does; 0 if empty */
+size_t aivdm_mpmc_pop(struct aivdm_mpmc_t *q, void *out, size_t stride,
+		      size_t *lens, size_t n);
+
+/*
+ * Decode sentences from source straight out of one ring into struct
+ * ais_t records reserved in another, one sentence per input record,
+ * until the input runs dry or the output fills.  Returns the number of
+ * sentences consumed; input is released and output published once.
+ */
+size_t aivdm_reasm_decode_ring(struct aivdm_reasm_t *reasm,
+			       unsigned int source, unsigned long now,
+			       struct aivdm_ring_t *sentences,
+			       struct aivdm_ring_t *records);
+
+/*
+ * Encode the struct ais_t records of one ring into another, one
+ * sentence with its CR LF per output record.  A message goes in whole
+ * or waits for room.  Unencodable records are consumed and dropped.
+ * Returns the number of records consumed.
+ */
+size_t aivdm_encode_ring(struct aivdm_ring_t *records,
+			 struct aivdm_sentence_opts_t *opts,
+			 struct aivdm_ring_t *sentences);
+
+/*
+ * Latest known state of every vessel heard, kept up to date from
+ * decoded messages.  Slots are open addressing on the MMSI.  The
+ * dynamic fields of a vessel fill one 32-byte slot in hot[], and its
+ * static and voyage data sit in the same slot of cold[], so a position
+ * update touches a single cache line.
+ *
+ * One thread updates the store while any number of others read it.
+ * Readers never lock: each vessel has a sequence counter that is odd
+ * while it is being written, and the store has a generation that is
+ * odd while aivdm_store_expire() moves slots about, and a reader just
+ * tries again when either changed under it.
+ */
+struct aivdm_vessel_t {
+    volatile unsigned int version;	/* odd while being written */
+    volatile unsigned int mmsi;		/* 0 for an empty slot */
+    int lon, lat;		/* AIS_LATLON_SCALE units */
+    unsigned short speed;	/* deciknots */
+    unsigned short course;	/* decidegrees */
+    unsigned short heading;	/* degrees */
+    short turn;			/* rate of turn, as in type1 */
+    unsigned char status;	/* navigation status, 15 if never sent */
+    unsigned char type;		/* message type of the last position */
+    unsigned char second;	/* UTC second of the last position */
+    unsigned char flags;	/* AIVDM_VESSEL_* */
+    unsigned int updated;	/* caller's clock at the last position */
+};
+#define AIVDM_VESSEL_ACCURACY	0x01	/* position accuracy flag */
+#define AIVDM_VESSEL_RAIM	0x02	/* RAIM flag */
+#define AIVDM_VESSEL_POSITION	0x04	/* a position has been heard */
+
+struct aivdm_vessel_static_t {
+    unsigned int imo;
+    unsigned int mothership_mmsi;	/* type 24 from an auxiliary craft */
+    unsigned int updated;	/* caller's clock at the last static data */
+    unsigned short to_bow, to_stern;
+    unsigned char to_port, to_starboard;
+    unsigned char shiptype, epfd;
+    unsigned char draught;	/* decimeters */
+    unsigned char month, day, hour, minute;	/* ETA */
+    unsigned char have;		/* AIVDM_STATIC_* */
+    char callsign[8];
+    char shipname[AIS_SHIPNAME_MAXLEN+1];
+    char destination[21];
+    char vendorid[8];
+};
+#define AIVDM_STATIC_VOYAGE	0x01	/* type 5 */
+#define AIVDM_STATIC_NAME	0x02	/* type 19, 21 or 24 part A */
+#define AIVDM_STATIC_SHIP	0x04	/* type 19 or 24 part B */
+
+struct aivdm_store_t {
+    struct aivdm_vessel_t *hot;
+    struct aivdm_vessel_static_t *cold;
+    unsigned int mask;		/* slots - 1 */
+    unsigned int count;		/* vessels held */
+    unsigned int limit;		/* vessels it may hold, 3/4 of the slots */
+    volatile unsigned int generation;	/* odd while slots move */
+};
+
+/* bytes of memory aivdm_store_init() needs for this many slots */
+size_t aivdm_store_bufsize(size_t slots);
+
+/*
+ * slots must be a power of two; 262144 slots hold 196608 vessels in
+ * 29 MB.  buf must be 8-byte aligned.  Returns 0, or -1 for bad slots.
+ */
+int aivdm_store_init(struct aivdm_store_t *store, void *buf, size_t slots);
+
+/*
+ * Fold a decoded message heard at now into its vessel's state.  Types
+ * 1-3, 9, 18, 19, 21 and 27 move a vessel, 5, 19, 21 and 24 describe
+ * it.  Returns 1 if the store changed, 0 for other types, -1 if the
+ * vessel is new and the store is full.  Only one thread may update.
+ */
+int aivdm_store_update(struct aivdm_store_t *store,
+		       const struct ais_t *ais, unsigned long now);
+
+/*
+ * Copy out what is known of mmsi; cold may be NULL when only the
+ * dynamic fields are wanted.  Returns 1 if the vessel is known, else 0.
+ * Safe from any thread.
+ */
+int aivdm_store_get(const struct aivdm_store_t *store, unsigned int mmsi,
+		    struct aivdm_vessel_t *hot,
+		    struct aivdm_vessel_static_t *cold);
+
+/*
+ * Walk the store: start with *cursor at 0 and call until it returns 0.
+ * Safe from any thread, but a vessel may be seen twice or missed if
+ * aivdm_store_expire() runs meanwhile.
+ */
+int aivdm_store_next(const struct aivdm_store_t *store, unsigned int *cursor,
+		     struct aivdm_vessel_t *hot,
+		     struct aivdm_vessel_static_t *cold);
+
+/* forget vessels not heard from for more than maxage; the updating thread only */
+size_t aivdm_store_expire(struct aivdm_store_t *store,
+			  unsigned long now, unsigned long maxage);
+
+/*
+ * Spatial index of vessel positions on a uniform grid of square cells
+ * in AIS_LATLON_SCALE units.  Each vessel sits on the list of its cell,
+ * and the cells share a hashed table of list heads, so the whole globe
+ * can be gridded finely without a table per cell.  A vessel crossing
+ * into another cell is unlinked and relinked, nothing more; one that
+ * stays in its cell only has its coordinates overwritten.  Queries
+ * visit the cells a box covers and return only what lies inside it.
+ * Not safe for concurrent use.
+ */
+#define AIVDM_GRID_NONE	0xffffffffU	/* end of a list */
+
+struct aivdm_grid_entry_t {
+    unsigned int mmsi;		/* 0 for a free entry */
+    int lon, lat;
+    unsigned int cell;
+    unsigned int prev, next;	/* neighbours on the cell's list */
+};
+
+struct aivdm_grid_t {
+    struct aivdm_grid_entry_t *entry;	/* capacity of them */
+    unsigned int *bucket;	/* list heads, hashed by cell */
+    unsigned int *index;	/* MMSI to entry + 1, open addressing */
+    unsigned int cellsize;	/* cell side in AIS_LATLON_SCALE units */
+    unsigned int rows;		/* cells from pole to pole */
+    unsigned int capacity, count;
+    unsigned int bucketmask, indexmask;
+    unsigned int freelist;	/* unused entries, chained through next */
+};
+
+/* bytes of memory aivdm_grid_init() needs */
+size_t aivdm_grid_bufsize(size_t capacity, size_t buckets);
+
+/*
+ * Room for capacity vessels in cells of cellsize units (60000 is a
+ * tenth of a degree, 2400 the least allowed).  buckets must be a power
+ * of two, about as many as the cells usually occupied.  Returns 0, or
+ * -1 for bad sizes.
+ */
+int aivdm_grid_init(struct aivdm_grid_t *grid, void *buf, size_t capacity,
+		    size_t buckets, unsigned int cellsize);
+
+/*
+ * Put mmsi at lon, lat or move it there.  An unavailable or impossible
+ * position takes the vessel off the grid.  Returns 1 if it is on the
+ * grid afterwards, 0 if not, -1 if it is new and the grid is full.
+ */
+int aivdm_grid_move(struct aivdm_grid_t *grid, unsigned int mmsi,
+		    int lon, int lat);
+
+/* the same for whatever position a decoded message reports; 0 if none */
+int aivdm_grid_update(struct aivdm_grid_t *grid, const struct ais_t *ais);
+
+/* take mmsi off the grid; 1 if it was there */
+int aivdm_grid_remove(struct aivdm_grid_t *grid, unsigned int mmsi);
+
+/*
+ * MMSIs of the vessels inside the box, edges included, into out[max].
+ * A box with sw_lon > ne_lon crosses the antimeridian.  Returns how
+ * many there are, which may be more than max.
+ */
+size_t aivdm_grid_box(const struct aivdm_grid_t *grid,
+		      int sw_lon, int sw_lat, int ne_lon, int ne_lat,
+		      unsigned int *out, size_t max);
+
+/* the same for the vessels within meters of lon, lat */
+size_t aivdm_grid_radius(const struct aivdm_grid_t *grid, int lon, int lat,
+			 double meters, unsigned int *out, size_t max);
+
+/*
+ * Compact records: one packed struct per message type for keeping
+ * decoded messages around in bulk.  The members are bitfields of their
+ * wire widths, expanded from the same schema rows as the decoder, and
+ * text is held in char arrays of exactly the transmitted length, not
+ * NUL-terminated.  A position report takes 24 bytes.  Binary payloads
+ * and free text stay out of line behind a view.  Every record starts
+ * with the same head, so the type can be read through any arm.
+ */
+#define AIS_RECORD_UINT(member, width)	unsigned int member : width;
+#define AIS_RECORD_SINT(member, width)	signed int member : width;
+#define AIS_RECORD_FLAG(member, width)	unsigned int member : width;
+#define AIS_RECORD_TEXT(member, width)	char member[width];
+#define AIS_RECORD_SPARE(member, width)
+#define AIS_RECORD(arm, member, start, width, kind) \
+	AIS_RECORD_##kind(member, width)
+#define AIS_RECORD_HEAD \
+	unsigned int mmsi : 30, repeat : 2; \
+	unsigned int type : 6;
+
+/* the bits of a binary payload, wherever they are kept */
+struct aivdm_payload_t {
+    const unsigned char *bits;	/* NULL when bitcount is 0 */
+    unsigned short start;	/* bit offset of the payload in bits */
+    unsigned short bitcount;
+};
+
+struct aivdm_rec_head_t { AIS_RECORD_HEAD };
+struct aivdm_rec1_t { AIS_RECORD_HEAD AIS_TYPE1_FIELDS(AIS_RECORD) };
+struct aivdm_rec4_t { AIS_RECORD_HEAD AIS_TYPE4_FIELDS(AIS_RECORD) };
+struct aivdm_rec5_t { AIS_RECORD_HEAD AIS_TYPE5_FIELDS(AIS_RECORD) };
+struct aivdm_rec6_t {
+    AIS_RECORD_HEAD AIS_TYPE6_FIELDS(AIS_RECORD)
+    struct aivdm_payload_t payload;
+};
+struct aivdm_rec7_t {
+    AIS_RECORD_HEAD AIS_TYPE7_FIELDS(AIS_RECORD)
+    AIS_TYPE7_ACK2_FIELDS(AIS_RECORD) AIS_TYPE7_ACK3_FIELDS(AIS_RECORD)
+    AIS_TYPE7_ACK4_FIELDS(AIS_RECORD)
+};
+struct aivdm_rec8_t {
+    AIS_RECORD_HEAD AIS_TYPE8_FIELDS(AIS_RECORD)
+    struct aivdm_payload_t payload;
+};
+struct aivdm_rec9_t { AIS_RECORD_HEAD AIS_TYPE9_FIELDS(AIS_RECORD) };
+struct aivdm_rec10_t { AIS_RECORD_HEAD AIS_TYPE10_FIELDS(AIS_RECORD) };
+struct aivdm_rec12_t {
+    AIS_RECORD_HEAD AIS_TYPE12_FIELDS(AIS_RECORD)
+    const char *text;		/* NUL-terminated */
+};
+struct aivdm_rec14_t {
+    AIS_RECORD_HEAD AIS_TYPE14_FIELDS(AIS_RECORD)
+    const char *text;		/* NUL-terminated */
+};
+struct aivdm_rec15_t {
+    AIS_RECORD_HEAD AIS_TYPE15_FIELDS(AIS_RECORD)
+    AIS_TYPE15_REQ2_FIELDS(AIS_RECORD) AIS_TYPE15_STATION2_FIELDS(AIS_RECORD)
+};
+struct aivdm_rec16_t {
+    AIS_RECORD_HEAD AIS_TYPE16_FIELDS(AIS_RECORD)
+    AIS_TYPE16_STATION2_FIELDS(AIS_RECORD)
+};
+struct aivdm_rec17_t {
+    AIS_RECORD_HEAD AIS_TYPE17_FIELDS(AIS_RECORD)
+    struct aivdm_payload_t payload;
+};
+struct aivdm_rec18_t { AIS_RECORD_HEAD AIS_TYPE18_FIELDS(AIS_RECORD) };
+struct aivdm_rec19_t { AIS_RECORD_HEAD AIS_TYPE19_FIELDS(AIS_RECORD) };
+struct aivdm_rec20_t {
+    AIS_RECORD_HEAD AIS_TYPE20_FIELDS(AIS_RECORD)
+    AIS_TYPE20_BLOCK2_FIELDS(AIS_RECORD) AIS_TYPE20_BLOCK3_FIELDS(AIS_RECORD)
+    AIS_TYPE20_BLOCK4_FIELDS(AIS_RECORD)
+};
+struct aivdm_rec21_t {
+    AIS_RECORD_HEAD AIS_TYPE21_FIELDS(AIS_RECORD)
+    char name_ext[14];		/* name past 20 characters */
+};
+struct aivdm_rec22_t {
+    AIS_RECORD_HEAD AIS_TYPE22_FIELDS(AIS_RECORD)
+    AIS_TYPE22_AREA_FIELDS(AIS_RECORD) AIS_TYPE22_DEST_FIELDS(AIS_RECORD)
+    AIS_TYPE22_TAIL_FIELDS(AIS_RECORD)
+};
+struct aivdm_rec23_t { AIS_RECORD_HEAD AIS_TYPE23_FIELDS(AIS_RECORD) };
+struct aivdm_rec24_t {
+    AIS_RECORD_HEAD AIS_TYPE24_FIELDS(AIS_RECORD)
+    AIS_TYPE24A_FIELDS(AIS_RECORD) AIS_TYPE24B_FIELDS(AIS_RECORD)
+    AIS_TYPE24B_DIM_FIELDS(AIS_RECORD) AIS_TYPE24B_MOTHERSHIP_FIELDS(AIS_RECORD)
+};
+struct aivdm_rec25_t {
+    AIS_RECORD_HEAD AIS_TYPE25_FIELDS(AIS_RECORD)
+    AIS_TYPE25_DEST_FIELDS(AIS_RECORD) AIS_TYPE25_APP_FIELDS(AIS_RECORD)
+    struct aivdm_payload_t payload;
+};
+struct aivdm_rec26_t {
+    AIS_RECORD_HEAD AIS_TYPE26_FIELDS(AIS_RECORD)
+    AIS_TYPE26_DEST_FIELDS(AIS_RECORD) AIS_TYPE26_APP_FIELDS(AIS_RECORD)
+    AIS_TYPE26_RADIO_FIELDS(AIS_RECORD)
+    struct aivdm_payload_t payload;
+};
+struct aivdm_rec27_t { AIS_RECORD_HEAD AIS_TYPE27_FIELDS(AIS_RECORD) };
+
+/* arms are named as in struct ais_t; types sharing a layout share an arm */
+union aivdm_record_t {
+    struct aivdm_rec_head_t head;
+    struct aivdm_rec1_t type1;		/* also 2 and 3 */
+    struct aivdm_rec4_t type4;		/* also 11 */
+    struct aivdm_rec5_t type5;
+    struct aivdm_rec6_t type6;
+    struct aivdm_rec7_t type7;		/* also 13 */
+    struct aivdm_rec8_t type8;
+    struct aivdm_rec9_t type9;
+    struct aivdm_rec10_t type10;
+    struct aivdm_rec12_t type12;
+    struct aivdm_rec14_t type14;
+    struct aivdm_rec15_t type15;
+    struct aivdm_rec16_t type16;
+    struct aivdm_rec17_t type17;
+    struct aivdm_rec18_t type18;
+    struct aivdm_rec19_t type19;
+    struct aivdm_rec20_t type20;
+    struct aivdm_rec21_t type21;
+    struct aivdm_rec22_t type22;
+    struct aivdm_rec23_t type23;
+    struct aivdm_rec24_t type24;
+    struct aivdm_rec25_t type25;
+    struct aivdm_rec26_t type26;
+    struct aivdm_rec27_t type27;
+};
+
+/*
+ * Bytes a record of message type takes, rounded up to a multiple of 8
+ * so that records can be laid back to back; 0 for unknown types.
+ */
+size_t aivdm_record_size(unsigned int type);
+
+/*
+ * Pack ais into rec, which needs aivdm_record_size(ais->type) bytes;
+ * returns that size, 0 for an unknown type.  Values are cut to their
+ * wire widths, as aivdm_validate() would find them.  Payloads and text
+ * are not copied: the views point into ais until aivdm_record_keep().
+ */
+size_t aivdm_compact(const struct ais_t *ais, union aivdm_record_t *rec);
+
+/* unpack rec into ais; returns 0, or -1 for an unknown type */
+int aivdm_expand(const union aivdm_record_t *rec, struct ais_t *ais);
+
+/* the payload view of a record of type 6, 8, 17, 25 or 26, else NULL */
+struct aivdm_payload_t *aivdm_record_payload(union aivdm_record_t *rec);
+
+/*
+ * Bump allocator for what records keep out of line.  Each payload or
+ * text takes exactly its own bytes, one after the other, and the whole
+ * arena is given back at once by aivdm_arena_reset(), typically after
+ * each batch has been consumed.  The caller supplies the memory.
+ */
+struct aivdm_arena_t {
+    unsigned char *buf;
+    size_t size;
+    size_t used;
+};
+
+/* the most one record keeps in an arena: a type 14 text */
+#define AIVDM_RECORD_ARENA_MAX	AIS_TYPE14_TEXT_MAX
+
+void aivdm_arena_init(struct aivdm_arena_t *arena, void *buf, size_t size);
+void aivdm_arena_reset(struct aivdm_arena_t *arena);
+
+/* n bytes, not aligned, or NULL if the arena is full */
+void *aivdm_arena_alloc(struct aivdm_arena_t *arena, size_t n);
+
+/*
+ * Copy the payload or text of rec into the arena and point rec there,
+ * so that it outlives whatever it was compacted from.  Returns 0, or
+ * -1 if the arena is NULL or too full, leaving rec as it was.
+ */
+int aivdm_record_keep(struct aivdm_arena_t *arena, union aivdm_record_t *rec);
+
+/*
+ * Application-specific payloads of types 6 and 8.  A registry maps the
+ * carrying message type and application id to a sub-decoder, which is
+ * run only when aivdm_app_decode() is asked for that record, so ids
+ * nobody registered cost nothing past the payload view.  The built-in
+ * results are bitfields of their wire widths, expanded from the
+ * AIS_APP_* schema rows, with values in wire units as in struct ais_t;
+ * six-bit text is NUL-terminated.
+ */
+#define AIVDM_APP_ID(dac, fi)	(((dac) << 6) | (fi))
+#define AIVDM_APP_DAC(app_id)	((app_id) >> 6)
+#define AIVDM_APP_FI(app_id)	((app_id) & 0x3f)
+
+#define AIS_APP_MEMBER_UINT(member, width)	unsigned int member : width;
+#define AIS_APP_MEMBER_SINT(member, width)	signed int member : width;
+#define AIS_APP_MEMBER_FLAG(member, width)	unsigned int member : width;
+#define AIS_APP_MEMBER_TEXT(member, width)	char member[width + 1];
+#define AIS_APP_MEMBER_SPARE(member, width)
+#define AIS_APP_MEMBER(arm, member, start, width, kind) \
+	AIS_APP_MEMBER_##kind(member, width)
+
+/* DAC 1 FI 31 - Meteorological and Hydrographic data, in type 8 */
+struct aivdm_app_met_t { AIS_APP_DAC1FI31_FIELDS(AIS_APP_MEMBER) };
+
+/* DAC 1 FI 22 (type 8) and FI 23 (type 6) - Area Notice, subarea by subarea */
+struct aivdm_app_circle_t {	/* a point when the radius is 0 */
+    AIS_APP_AREA_ORIGIN_FIELDS(AIS_APP_MEMBER)
+    AIS_APP_AREA_CIRCLE_FIELDS(AIS_APP_MEMBER)
+};
+struct aivdm_app_rect_t {
+    AIS_APP_AREA_ORIGIN_FIELDS(AIS_APP_MEMBER)
+    AIS_APP_AREA_RECT_FIELDS(AIS_APP_MEMBER)
+};
+struct aivdm_app_sector_t {
+    AIS_APP_AREA_ORIGIN_FIELDS(AIS_APP_MEMBER)
+    AIS_APP_AREA_SECTOR_FIELDS(AIS_APP_MEMBER)
+};
+struct aivdm_app_poly_t { AIS_APP_AREA_POLY_FIELDS(AIS_APP_MEMBER) };
+struct aivdm_app_text_t { AIS_APP_AREA_TEXT_FIELDS(AIS_APP_MEMBER) };
+struct aivdm_app_subarea_t {
+    AIS_APP_AREA_SHAPE_FIELDS(AIS_APP_MEMBER)
+#define AIS_APP_SHAPE_CIRCLE	0
+#define AIS_APP_SHAPE_RECT	1
+#define AIS_APP_SHAPE_SECTOR	2
+#define AIS_APP_SHAPE_POLYLINE	3	/* points continue the subarea before */
+#define AIS_APP_SHAPE_POLYGON	4
+#define AIS_APP_SHAPE_TEXT	5	/* text continues the notice */
+    union {
+	struct aivdm_app_circle_t circle;
+	struct aivdm_app_rect_t rect;
+	struct aivdm_app_sector_t sector;
+	struct aivdm_app_poly_t poly;	/* polyline and polygon */
+	struct aivdm_app_text_t text;
+    };
+};
+#define AIS_APP_AREA_SUBAREAS	10	/* as many as a type 8 can carry */
+struct aivdm_app_area_t {
+    AIS_APP_AREA_FIELDS(AIS_APP_MEMBER)
+    unsigned int nsubareas;
+    struct aivdm_app_subarea_t subareas[AIS_APP_AREA_SUBAREAS];
+};
+
+/* DAC 235 and 250 FI 10 - AtoN monitoring data, in type 6 */
+struct aivdm_app_aton_t { AIS_APP_ATON_FIELDS(AIS_APP_MEMBER) };
+
+/*
+ * A sub-decoder gets the application data realigned to bit 0 of bits,
+ * with AIVDM_BITS_SLACK zeroed bytes after it so that ubits_fast() may
+ * be used, and fills out, which has room for the size it was
+ * registered with.  Returns 0, or -1 if the data does not fit its
+ * layout.
+ */
+typedef int (*aivdm_app_decoder_t)(const unsigned char *bits,
+				   size_t bitcount, void *out);
+
+struct aivdm_app_t {
+    unsigned int key;		/* message type << 16 | application id */
+    size_t size;		/* bytes the decoder writes */
+    aivdm_app_decoder_t decode;
+};
+
+#define AIVDM_APP_MAX	32
+struct aivdm_app_registry_t {
+    size_t napps;
+    struct aivdm_app_t apps[AIVDM_APP_MAX];	/* sorted by key */
+};
+
+/* a registry holding just the built-in decoders */
+void aivdm_app_init(struct aivdm_app_registry_t *reg);
+
+/*
+ * Add, or replace, the decoder for app_id carried in messages of type
+ * msgtype, 6 or 8.  Returns 0, or -1 for another type or a full
+ * registry.
+ */
+int aivdm_app_register(struct aivdm_app_registry_t *reg,
+		       unsigned int msgtype, unsigned int app_id,
+		       size_t size, aivdm_app_decoder_t decode);
+
+/* the decoder for app_id in msgtype, or NULL; a NULL reg means the built-ins */
+const struct aivdm_app_t *aivdm_app_find(const struct aivdm_app_registry_t *reg,
+					 unsigned int msgtype,
+					 unsigned int app_id);
+
+/*
+ * Decode the application data of a type 6 or 8 message into out, which
+ * has outlen bytes.  Returns the bytes written, 0 when no decoder is
+ * registered for it (or the message is of another type), -1 when the
+ * data does not fit the layout or out is too small.  A NULL reg means
+ * the built-ins.
+ */
+int aivdm_app_decode(const struct aivdm_app_registry_t *reg,
+		     const union aivdm_record_t *rec,
+		     void *out, size_t outlen);
+/* the same for a decoded struct ais_t */
+int aivdm_app_decode_ais(const struct aivdm_app_registry_t *reg,
+			 const struct ais_t *ais, void *out, size_t outlen);
+
 #ifdef __cplusplus
 }  /* End of the 'extern "C"' block */
 #endif
@@ -0,0 +1,251 @@
+/* aivdm_app.c - registry of application-specific payload decoders
+ *
+ * Types 6 and 8 carry a 16-bit application id, a DAC and a function
+ * identifier, ahead of data whose layout that id defines.  The registry
+ * is a short array sorted by carrying type and id, searched only when a
+ * consumer asks for one message's data; the data is then realigned to
+ * a slack-padded buffer so that sub-decoders can read it with
+ * ubits_fast() from bit 0 whatever offset the message put it at.
+ *
+ * The built-in layouts are schema rows like the messages' own, and are
+ * unpacked member by member from them.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <string.h>
+
+#include "aivdm.h"
+#include "bits.h"
+#include "sixbit.h"
+
+#define APP_KEY(msgtype, app_id)	((unsigned int)(msgtype) << 16 | (app_id))
+
+/* unpack one row into out->member, at bit base + start */
+#define APP_DECODE_UINT(member, start, width) \
+	out->member = (unsigned int)ubits_fast(bits, base + (start), width);
+#define APP_DECODE_SINT(member, start, width) \
+	out->member = (int)sbits_fast(bits, base + (start), width);
+#define APP_DECODE_FLAG(member, start, width) \
+	out->member = (unsigned int)ubits_fast(bits, base + (start), width);
+#define APP_DECODE_TEXT(member, start, width) \
+	(void)sixbit_get_text(bits, base + (start), width, out->member);
+#define APP_DECODE_SPARE(member, start, width)
+#define APP_DECODE(arm, member, start, width, kind) \
+	APP_DECODE_##kind(member, start, width)
+
+/* bits through the ice field; some stations cut the trailing spare */
+#define MET_BITS	294
+/* bits through the off-position flag */
+#define ATON_BITS	44
+
+static int decode_met(const unsigned char *bits, size_t bitcount, void *to)
+{
+	struct aivdm_app_met_t *out = (struct aivdm_app_met_t *)to;
+	const unsigned int base = 0;
+
+	if (bitcount < MET_BITS)
+		return -1;
+	AIS_APP_DAC1FI31_FIELDS(APP_DECODE)
+	return 0;
+}
+
+static void decode_subarea(const unsigned char *bits, unsigned int base,
+			   struct aivdm_app_subarea_t *sub)
+/* one subarea; reserved shapes keep only the shape */
+{
+	{
+		struct aivdm_app_subarea_t *out = sub;
+		AIS_APP_AREA_SHAPE_FIELDS(APP_DECODE)
+	}
+	switch (sub->shape) {
+	case AIS_APP_SHAPE_CIRCLE: {
+		struct aivdm_app_circle_t *out = &sub->circle;
+		AIS_APP_AREA_ORIGIN_FIELDS(APP_DECODE)
+		AIS_APP_AREA_CIRCLE_FIELDS(APP_DECODE)
+		break;
+	}
+	case AIS_APP_SHAPE_RECT: {
+		struct aivdm_app_rect_t *out = &sub->rect;
+		AIS_APP_AREA_ORIGIN_FIELDS(APP_DECODE)
+		AIS_APP_AREA_RECT_FIELDS(APP_DECODE)
+		break;
+	}
+	case AIS_APP_SHAPE_SECTOR: {
+		struct aivdm_app_sector_t *out = &sub->sector;
+		AIS_APP_AREA_ORIGIN_FIELDS(APP_DECODE)
+		AIS_APP_AREA_SECTOR_FIELDS(APP_DECODE)
+		break;
+	}
+	case AIS_APP_SHAPE_POLYLINE:
+	case AIS_APP_SHAPE_POLYGON: {
+		struct aivdm_app_poly_t *out = &sub->poly;
+		AIS_APP_AREA_POLY_FIELDS(APP_DECODE)
+		break;
+	}
+	case AIS_APP_SHAPE_TEXT: {
+		struct aivdm_app_text_t *out = &sub->text;
+		AIS_APP_AREA_TEXT_FIELDS(APP_DECODE)
+		break;
+	}
+	}
+}
+
+static int decode_area(const unsigned char *bits, size_t bitcount, void *to)
+{
+	struct aivdm_app_area_t *out = (struct aivdm_app_area_t *)to;
+	const unsigned int base = 0;
+	const size_t head = AIS_FIELDS_BITS(AIS_APP_AREA_FIELDS);
+	size_t i, n;
+
+	if (bitcount < head)
+		return -1;
+	AIS_APP_AREA_FIELDS(APP_DECODE)
+	n = (bitcount - head) / AIS_APP_AREA_SUBAREA_BITS;
+	if (n > AIS_APP_AREA_SUBAREAS)
+		n = AIS_APP_AREA_SUBAREAS;
+	for (i = 0; i < n; i++)
+		decode_subarea(bits,
+			       (unsigned int)(head + i * AIS_APP_AREA_SUBAREA_BITS),
+			       &out->subareas[i]);
+	out->nsubareas = (unsigned int)n;
+	return 0;
+}
+
+static int decode_aton(const unsigned char *bits, size_t bitcount, void *to)
+{
+	struct aivdm_app_aton_t *out = (struct aivdm_app_aton_t *)to;
+	const unsigned int base = 0;
+
+	if (bitcount < ATON_BITS)
+		return -1;
+	AIS_APP_ATON_FIELDS(APP_DECODE)
+	return 0;
+}
+
+/* sorted by key */
+static const struct aivdm_app_t builtin_apps[] = {
+	{APP_KEY(6, AIVDM_APP_ID(1, 23)), sizeof(struct aivdm_app_area_t), decode_area},
+	{APP_KEY(6, AIVDM_APP_ID(235, 10)), sizeof(struct aivdm_app_aton_t), decode_aton},
+	{APP_KEY(6, AIVDM_APP_ID(250, 10)), sizeof(struct aivdm_app_aton_t), decode_aton},
+	{APP_KEY(8, AIVDM_APP_ID(1, 22)), sizeof(struct aivdm_app_area_t), decode_area},
+	{APP_KEY(8, AIVDM_APP_ID(1, 31)), sizeof(struct aivdm_app_met_t), decode_met},
+};
+#define NBUILTIN	(sizeof(builtin_apps) / sizeof(builtin_apps[0]))
+
+static size_t lower_bound(const struct aivdm_app_t *apps, size_t n,
+			  unsigned int key)
+/* index of the first entry not below key */
+{
+	size_t lo = 0, hi = n;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (apps[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+void aivdm_app_init(struct aivdm_app_registry_t *reg)
+{
+	memcpy(reg->apps, builtin_apps, sizeof(builtin_apps));
+	reg->napps = NBUILTIN;
+}
+
+int aivdm_app_register(struct aivdm_app_registry_t *reg,
+		       unsigned int msgtype, unsigned int app_id,
+		       size_t size, aivdm_app_decoder_t decode)
+{
+	unsigned int key = APP_KEY(msgtype, app_id & 0xffff);
+	size_t i;
+
+	if (msgtype != 6 && msgtype != 8)
+		return -1;
+	i = lower_bound(reg->apps, reg->napps, key);
+	if (i == reg->napps || reg->apps[i].key != key) {
+		if (reg->napps == AIVDM_APP_MAX)
+			return -1;
+		memmove(&reg->apps[i + 1], &reg->apps[i],
+			(reg->napps - i) * sizeof(reg->apps[0]));
+		reg->napps++;
+	}
+	reg->apps[i].key = key;
+	reg->apps[i].size = size;
+	reg->apps[i].decode = decode;
+	return 0;
+}
+
+const struct aivdm_app_t *aivdm_app_find(const struct aivdm_app_registry_t *reg,
+					 unsigned int msgtype,
+					 unsigned int app_id)
+{
+	const struct aivdm_app_t *apps = reg ? reg->apps : builtin_apps;
+	size_t n = reg ? reg->napps : NBUILTIN;
+	unsigned int key = APP_KEY(msgtype, app_id);
+	size_t i = lower_bound(apps, n, key);
+
+	return i < n && apps[i].key == key ? &apps[i] : NULL;
+}
+
+static int app_decode(const struct aivdm_app_registry_t *reg,
+		      unsigned int msgtype, unsigned int app_id,
+		      const struct aivdm_payload_t *payload,
+		      void *out, size_t outlen)
+{
+	unsigned char bits[(AIS_TYPE8_BINARY_MAX + 7) / 8 + AIVDM_BITS_SLACK];
+	const struct aivdm_app_t *app = aivdm_app_find(reg, msgtype, app_id);
+	size_t nbytes = ((size_t)payload->bitcount + 7) / 8;
+
+	if (app == NULL)
+		return 0;
+	if (outlen < app->size || payload->bitcount > AIS_TYPE8_BINARY_MAX)
+		return -1;
+	if (payload->bitcount > 0)
+		copy_bits(bits, payload->bits, payload->start, payload->bitcount);
+	memset(bits + nbytes, 0, AIVDM_BITS_SLACK);
+	memset(out, 0, app->size);
+	if (app->decode(bits, payload->bitcount, out) != 0)
+		return -1;
+	return (int)app->size;
+}
+
+int aivdm_app_decode(const struct aivdm_app_registry_t *reg,
+		     const union aivdm_record_t *rec,
+		     void *out, size_t outlen)
+{
+	switch (rec->head.type) {
+	case 6:
+		return app_decode(reg, 6, rec->type6.app_id,
+				  &rec->type6.payload, out, outlen);
+	case 8:
+		return app_decode(reg, 8, rec->type8.app_id,
+				  &rec->type8.payload, out, outlen);
+	default:
+		return 0;
+	}
+}
+
+int aivdm_app_decode_ais(const struct aivdm_app_registry_t *reg,
+			 const struct ais_t *ais, void *out, size_t outlen)
+{
+	struct aivdm_payload_t payload;
+
+	payload.start = 0;
+	switch (ais->type) {
+	case 6:
+		payload.bits = (const unsigned char *)ais->type6.bitdata;
+		payload.bitcount = (unsigned short)ais->type6.bitcount;
+		return app_decode(reg, 6, ais->type6.app_id, &payload,
+				  out, outlen);
+	case 8:
+		payload.bits = (const unsigned char *)ais->type8.bitdata;
+		payload.bitcount = (unsigned short)ais->type8.bitcount;
+		return app_decode(reg, 8, ais->type8.app_id, &payload,
+				  out, outlen);
+	default:
+		return 0;
+	}
+}
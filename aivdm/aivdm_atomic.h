@@ -0,0 +1,76 @@
+/*
+ * aivdm_atomic.h - the few atomic operations the lock-free code needs
+ *
+ * Acquire loads, release stores, fences and a compare-and-swap on
+ * 32-bit words.  GCC and Clang get the __atomic builtins.  MSVC targets
+ * x86 and x64 only, where plain volatile accesses already have acquire
+ * and release semantics and only the compiler needs holding back.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_AIVDM_ATOMIC_H_
+#define _GPSD_AIVDM_ATOMIC_H_
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange, _ReadWriteBarrier)
+#define ATOMIC_INLINE	static __inline
+
+ATOMIC_INLINE unsigned int aivdm_load_acquire(const volatile unsigned int *p)
+{
+	unsigned int v = *p;
+	_ReadWriteBarrier();
+	return v;
+}
+
+ATOMIC_INLINE void aivdm_store_release(volatile unsigned int *p, unsigned int v)
+{
+	_ReadWriteBarrier();
+	*p = v;
+}
+
+ATOMIC_INLINE int aivdm_compare_swap(volatile unsigned int *p,
+				     unsigned int expect, unsigned int v)
+{
+	return (unsigned int)_InterlockedCompareExchange((volatile long *)p,
+			(long)v, (long)expect) == expect;
+}
+
+/* x86 keeps loads in order and stores in order; stop the compiler */
+ATOMIC_INLINE void aivdm_fence_acquire(void)	{ _ReadWriteBarrier(); }
+ATOMIC_INLINE void aivdm_fence_release(void)	{ _ReadWriteBarrier(); }
+#else
+#define ATOMIC_INLINE	static __inline__
+
+ATOMIC_INLINE unsigned int aivdm_load_acquire(const volatile unsigned int *p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+ATOMIC_INLINE void aivdm_store_release(volatile unsigned int *p, unsigned int v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+ATOMIC_INLINE int aivdm_compare_swap(volatile unsigned int *p,
+				     unsigned int expect, unsigned int v)
+{
+	return __atomic_compare_exchange_n(p, &expect, v, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+ATOMIC_INLINE void aivdm_fence_acquire(void)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+ATOMIC_INLINE void aivdm_fence_release(void)
+{
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+#endif
+
+#undef ATOMIC_INLINE
+
+#endif /* _GPSD_AIVDM_ATOMIC_H_ */
@@ -0,0 +1,289 @@
+/* aivdm_columns.c - batch decoding of position reports into columns
+ *
+ * Types 1-3, 9 and 18 are always one sentence of 168 bits, with every
+ * field at a fixed offset for the type.  A batch of them is de-armored
+ * into rows of a fixed stride, and each field is then pulled out of all
+ * rows at once: with AVX2, four rows per step by a gather of the 64-bit
+ * windows, a byte swap, per-lane shifts by the field's bit offset in
+ * each row's layout, a mask and the xor/sub sign extension.  Offsets
+ * come from the schema rows, one layout per type family.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aivdm.h"
+#include "bits.h"
+#include "nmea.h"
+#include "simd.h"
+#include "sixbit.h"
+
+#define ROW_BYTES	32	/* 168 bits, then de-armor and read slack */
+#define BATCH		64	/* rows de-armored before fields are pulled */
+
+/* schema starts and widths as constants: AT_type1_lon, WIDTH_type1_lon */
+#define ROW_ENUM_UINT(arm, member, start, width) \
+	AT_##arm##_##member = start, WIDTH_##arm##_##member = width,
+#define ROW_ENUM_SINT	ROW_ENUM_UINT
+#define ROW_ENUM_FLAG	ROW_ENUM_UINT
+#define ROW_ENUM_TEXT	ROW_ENUM_UINT
+#define ROW_ENUM_SPARE(arm, member, start, width)
+#define ROW_ENUM(arm, member, start, width, kind) \
+	ROW_ENUM_##kind(arm, member, start, width)
+enum {
+	AIS_TYPE1_FIELDS(ROW_ENUM) AIS_TYPE9_FIELDS(ROW_ENUM)
+	AIS_TYPE18_FIELDS(ROW_ENUM) ROW_ENUM_END
+};
+
+/* a column shares one width across the layouts that have it */
+#define SAME_WIDTH(member) \
+	typedef char member##_width_check[(WIDTH_type1_##member == WIDTH_type9_##member \
+		&& WIDTH_type1_##member == WIDTH_type18_##member) ? 1 : -1];
+SAME_WIDTH(speed)
+SAME_WIDTH(accuracy)
+SAME_WIDTH(lon)
+SAME_WIDTH(lat)
+SAME_WIDTH(course)
+SAME_WIDTH(second)
+typedef char heading_width_check[WIDTH_type1_heading == WIDTH_type18_heading ? 1 : -1];
+
+enum { LAYOUT_CLASS_A, LAYOUT_SAR, LAYOUT_CLASS_B, NLAYOUTS };
+
+#define ABSENT		-1	/* the layout has no such field */
+#define STATUS_NOT_DEFINED	15
+
+struct column_t {
+	int start[NLAYOUTS];
+	unsigned int width;
+	int sign;
+	int dflt;		/* for ABSENT */
+};
+
+/* in the order of struct aivdm_columns_t */
+#define NCOLUMNS	11
+static const struct column_t columns[NCOLUMNS] = {
+	{{0, 0, 0}, 6, 0, 0},
+	{{8, 8, 8}, 30, 0, 0},
+	{{AT_type1_status, ABSENT, ABSENT}, WIDTH_type1_status, 0,
+	 STATUS_NOT_DEFINED},
+	{{AT_type1_turn, ABSENT, ABSENT}, WIDTH_type1_turn, 1,
+	 -AIS_TURN_NOT_AVAILABLE},
+	{{AT_type1_speed, AT_type9_speed, AT_type18_speed},
+	 WIDTH_type1_speed, 0, 0},
+	{{AT_type1_accuracy, AT_type9_accuracy, AT_type18_accuracy},
+	 WIDTH_type1_accuracy, 0, 0},
+	{{AT_type1_lon, AT_type9_lon, AT_type18_lon}, WIDTH_type1_lon, 1, 0},
+	{{AT_type1_lat, AT_type9_lat, AT_type18_lat}, WIDTH_type1_lat, 1, 0},
+	{{AT_type1_course, AT_type9_course, AT_type18_course},
+	 WIDTH_type1_course, 0, 0},
+	{{AT_type1_heading, ABSENT, AT_type18_heading}, WIDTH_type1_heading, 0,
+	 AIS_HEADING_NOT_AVAILABLE},
+	{{AT_type1_second, AT_type9_second, AT_type18_second},
+	 WIDTH_type1_second, 0, 0},
+};
+
+/* one field of nrows rows, row r read at bit start[r] or ABSENT */
+typedef void (*column_kernel_t)(const unsigned char *rows, const int *start,
+				size_t nrows, unsigned int width, int sign,
+				int dflt, int *out);
+
+static void column_none(const unsigned char *rows, const int *start,
+			size_t nrows, unsigned int width, int sign,
+			int dflt, int *out)
+{
+	size_t r;
+
+	for (r = 0; r < nrows; r++) {
+		const unsigned char *row = rows + r * ROW_BYTES;
+
+		if (start[r] == ABSENT)
+			out[r] = dflt;
+		else if (sign)
+			out[r] = (int)sbits_fast(row, (unsigned int)start[r], width);
+		else
+			out[r] = (int)ubits_fast(row, (unsigned int)start[r], width);
+	}
+}
+
+#ifdef AIVDM_HAVE_AVX2
+AIVDM_TARGET_AVX2
+static void column_avx2(const unsigned char *rows, const int *start,
+			size_t nrows, unsigned int width, int sign,
+			int dflt, int *out)
+{
+	const __m256i kswap = _mm256_setr_epi8(
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	const __m128i kstride = _mm_setr_epi32(0, ROW_BYTES, 2 * ROW_BYTES,
+					       3 * ROW_BYTES);
+	const __m128i k7 = _mm_set1_epi32(7);
+	const __m128i kcount = _mm_cvtsi32_si128((int)(64 - width));
+	/* xor/sub with zero leaves unsigned fields alone */
+	const __m256i ksign = _mm256_set1_epi64x(sign ? (long long)1 << (width - 1) : 0);
+	const __m256i kdflt = _mm256_set1_epi64x(dflt);
+	const __m256i klow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	size_t r;
+
+	for (r = 0; r + 4 <= nrows; r += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(start + r));
+		__m128i absent = _mm_cmpeq_epi32(s, _mm_set1_epi32(ABSENT));
+		__m256i w;
+
+		/* absent lanes read bit 0 of their row and are replaced below */
+		s = _mm_andnot_si128(absent, s);
+		w = _mm256_i32gather_epi64((const long long *)(rows + r * ROW_BYTES),
+				_mm_add_epi32(_mm_srli_epi32(s, 3), kstride), 1);
+		w = _mm256_shuffle_epi8(w, kswap);
+		w = _mm256_sllv_epi64(w, _mm256_cvtepu32_epi64(_mm_and_si128(s, k7)));
+		w = _mm256_srl_epi64(w, kcount);
+		w = _mm256_sub_epi64(_mm256_xor_si256(w, ksign), ksign);
+		w = _mm256_blendv_epi8(w, kdflt, _mm256_cvtepi32_epi64(absent));
+		w = _mm256_permutevar8x32_epi32(w, klow);
+		_mm_storeu_si128((__m128i *)(out + r), _mm256_castsi256_si128(w));
+	}
+	column_none(rows + r * ROW_BYTES, start + r, nrows - r, width, sign,
+		    dflt, out + r);
+}
+#endif /* AIVDM_HAVE_AVX2 */
+
+static void column_dispatch(const unsigned char *, const int *, size_t,
+			    unsigned int, int, int, int *);
+
+static column_kernel_t column_bulk = column_dispatch;
+
+static void column_dispatch(const unsigned char *rows, const int *start,
+			    size_t nrows, unsigned int width, int sign,
+			    int dflt, int *out)
+/* pick the best kernel for this host on first use */
+{
+	column_kernel_t kernel = column_none;
+
+#ifdef AIVDM_HAVE_AVX2
+	if (aivdm_cpu_features() & AIVDM_CPU_AVX2)
+		kernel = column_avx2;
+#endif
+	column_bulk = kernel;
+	kernel(rows, start, nrows, width, sign, dflt, out);
+}
+
+static int classify(const char *line, size_t len, unsigned int flags,
+		    const char **data, size_t *datalen, unsigned char *layout)
+/* AIVDM_STATUS_DECODED for a sentence that makes a row, else its status */
+{
+	struct nmea_scan_t scan;
+	const char *const *field = scan.field;
+	size_t bitlen;
+	char pad;
+
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+	if (len == 0)
+		return AIVDM_STATUS_IGNORED;
+	/* !xxVDM from other stations, !xxVDO from our own */
+	if (len < 7 || line[0] != '!' || line[3] != 'V' || line[4] != 'D'
+			|| (line[5] != 'M' && line[5] != 'O') || line[6] != ',')
+		return AIVDM_STATUS_IGNORED;
+	if (nmea_scan(line, len, &scan) < 7)
+		return AIVDM_STATUS_REJECTED;
+	if ((flags & AIVDM_DECODE_NOCHECKSUM) == 0
+			&& !nmea_checksum_ok(&scan, line + len))
+		return AIVDM_STATUS_REJECTED;
+	if (atoi(field[1]) != 1 || atoi(field[2]) != 1)
+		return AIVDM_STATUS_DEFERRED;
+	*data = field[5];
+	*datalen = (size_t)(field[6] - 1 - field[5]);
+	if (*datalen == 0)
+		return AIVDM_STATUS_DEFERRED;
+	switch (sixbit_dearmor_table[(unsigned char)**data]) {
+	case 1:
+	case 2:
+	case 3:
+		*layout = LAYOUT_CLASS_A;
+		break;
+	case 9:
+		*layout = LAYOUT_SAR;
+		break;
+	case 18:
+		*layout = LAYOUT_CLASS_B;
+		break;
+	default:
+		return AIVDM_STATUS_DEFERRED;
+	}
+	/* odd lengths are for the general decoder to judge */
+	pad = field[6] < line + len ? field[6][0] : '\0';
+	bitlen = 6 * *datalen;
+	if (isdigit((unsigned char)pad) && (size_t)(pad - '0') <= bitlen)
+		bitlen -= (size_t)(pad - '0');
+	if (bitlen != 168 || *datalen > 29)
+		return AIVDM_STATUS_DEFERRED;
+	return AIVDM_STATUS_DECODED;
+}
+
+static void flush(const unsigned char *rows, const unsigned char *layout,
+		  size_t nrows, struct aivdm_columns_t *cols)
+/* every wanted field of the batch, column by column */
+{
+	int *dst[NCOLUMNS];
+	int start[BATCH];
+	size_t c, r;
+
+	dst[0] = (int *)cols->type;
+	dst[1] = (int *)cols->mmsi;
+	dst[2] = (int *)cols->status;
+	dst[3] = cols->turn;
+	dst[4] = (int *)cols->speed;
+	dst[5] = (int *)cols->accuracy;
+	dst[6] = cols->lon;
+	dst[7] = cols->lat;
+	dst[8] = (int *)cols->course;
+	dst[9] = (int *)cols->heading;
+	dst[10] = (int *)cols->second;
+	for (c = 0; c < NCOLUMNS; c++) {
+		const struct column_t *col = &columns[c];
+
+		if (dst[c] == NULL)
+			continue;
+		for (r = 0; r < nrows; r++)
+			start[r] = col->start[layout[r]];
+		column_bulk(rows, start, nrows, col->width, col->sign,
+			    col->dflt, dst[c] + cols->n);
+	}
+	cols->n += nrows;
+}
+
+size_t aivdm_decode_columns(const char *const *buf, const size_t *len,
+			    size_t n, unsigned int flags,
+			    struct aivdm_columns_t *cols,
+			    unsigned char *status)
+{
+	unsigned char rows[BATCH * ROW_BYTES];
+	unsigned char layout[BATCH];
+	size_t i, nrows = 0;
+
+	/* bytes past a row's payload are read, though never used */
+	(void)memset(rows, '\0', sizeof(rows));
+	for (i = 0; i < n; i++) {
+		const char *data;
+		size_t datalen;
+		int st;
+
+		if (cols->n + nrows == cols->max)
+			break;
+		st = classify(buf[i], len[i], flags, &data, &datalen,
+			      &layout[nrows]);
+		status[i] = (unsigned char)st;
+		if (st != AIVDM_STATUS_DECODED)
+			continue;
+		(void)aivdm_dearmor(rows + nrows * ROW_BYTES, 0, data, datalen);
+		if (++nrows == BATCH) {
+			flush(rows, layout, nrows, cols);
+			nrows = 0;
+		}
+	}
+	if (nrows > 0)
+		flush(rows, layout, nrows, cols);
+	return i;
+}
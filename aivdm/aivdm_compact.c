@@ -0,0 +1,478 @@
+/* aivdm_compact.c - pack struct ais_t into per-type compact records and back
+ *
+ * Both directions are expanded from the schema rows, member by member,
+ * so a record holds exactly the fields the decoder fills in.  Members
+ * that share storage in struct ais_t (the type 22 area and addresses,
+ * the type 24 dimensions and mothership) are copied for the form the
+ * message is in, the same choice the encoder makes.
+ *
+ * What a record holds out of line can be moved into an arena, a plain
+ * bump allocator over caller memory, so that it no longer depends on
+ * the struct ais_t or the decoder buffer it came from.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <string.h>
+
+#include "aivdm.h"
+#include "bits.h"
+
+/* record arms of the schema's arm tokens; nested ones are flattened */
+#define AIS_REC_type1		type1
+#define AIS_REC_type4		type4
+#define AIS_REC_type5		type5
+#define AIS_REC_type6		type6
+#define AIS_REC_type7		type7
+#define AIS_REC_type8		type8
+#define AIS_REC_type9		type9
+#define AIS_REC_type10		type10
+#define AIS_REC_type12		type12
+#define AIS_REC_type14		type14
+#define AIS_REC_type15		type15
+#define AIS_REC_type16		type16
+#define AIS_REC_type17		type17
+#define AIS_REC_type18		type18
+#define AIS_REC_type19		type19
+#define AIS_REC_type20		type20
+#define AIS_REC_type21		type21
+#define AIS_REC_type22		type22
+#define AIS_REC_type22_area	type22
+#define AIS_REC_type22_mmsi	type22
+#define AIS_REC_type23		type23
+#define AIS_REC_type24		type24
+#define AIS_REC_type24_dim	type24
+#define AIS_REC_type25		type25
+#define AIS_REC_type26		type26
+#define AIS_REC_type27		type27
+
+#define RECORD_SIZE(arm)	((sizeof(struct aivdm_rec##arm##_t) + 7) & ~(size_t)7)
+
+static const unsigned short record_sizes[28] = {
+	0, RECORD_SIZE(1), RECORD_SIZE(1), RECORD_SIZE(1), RECORD_SIZE(4),
+	RECORD_SIZE(5), RECORD_SIZE(6), RECORD_SIZE(7), RECORD_SIZE(8),
+	RECORD_SIZE(9), RECORD_SIZE(10), RECORD_SIZE(4), RECORD_SIZE(12),
+	RECORD_SIZE(7), RECORD_SIZE(14), RECORD_SIZE(15), RECORD_SIZE(16),
+	RECORD_SIZE(17), RECORD_SIZE(18), RECORD_SIZE(19), RECORD_SIZE(20),
+	RECORD_SIZE(21), RECORD_SIZE(22), RECORD_SIZE(23), RECORD_SIZE(24),
+	RECORD_SIZE(25), RECORD_SIZE(26), RECORD_SIZE(27),
+};
+
+size_t aivdm_record_size(unsigned int type)
+{
+	return type < 28 ? record_sizes[type] : 0;
+}
+
+/* schema rows to packing statements */
+#define AIS_PACK_UINT(arm, member, width) \
+	rec->AIS_REC_##arm.member = ais->AIS_ARM_##arm.member;
+#define AIS_PACK_SINT(arm, member, width) \
+	rec->AIS_REC_##arm.member = ais->AIS_ARM_##arm.member;
+#define AIS_PACK_FLAG(arm, member, width) \
+	rec->AIS_REC_##arm.member = ais->AIS_ARM_##arm.member != 0;
+#define AIS_PACK_TEXT(arm, member, width) \
+	pack_text(rec->AIS_REC_##arm.member, ais->AIS_ARM_##arm.member, width);
+#define AIS_PACK_SPARE(arm, member, width)
+#define AIS_PACK(arm, member, start, width, kind) \
+	AIS_PACK_##kind(arm, member, width)
+
+static void pack_text(char *to, const char *from, size_t width)
+/* up to width characters, zero-filled, no terminator */
+{
+	size_t i;
+
+	for (i = 0; i < width && from[i] != '\0'; i++)
+		to[i] = from[i];
+	for (; i < width; i++)
+		to[i] = '\0';
+}
+
+static void pack_payload(struct aivdm_payload_t *payload,
+			 const char *bitdata, size_t bitcount)
+{
+	payload->bits = bitcount != 0 ? (const unsigned char *)bitdata : NULL;
+	payload->start = 0;
+	payload->bitcount = (unsigned short)bitcount;
+}
+
+size_t aivdm_compact(const struct ais_t *ais, union aivdm_record_t *rec)
+{
+	size_t size = aivdm_record_size(ais->type);
+	size_t len;
+
+	if (size == 0)
+		return 0;
+	(void)memset(rec, '\0', size);
+	rec->head.mmsi = ais->mmsi;
+	rec->head.repeat = ais->repeat;
+	rec->head.type = ais->type;
+
+	switch (ais->type) {
+	case 1:
+	case 2:
+	case 3:
+		AIS_TYPE1_FIELDS(AIS_PACK)
+		break;
+	case 4:
+	case 11:
+		AIS_TYPE4_FIELDS(AIS_PACK)
+		break;
+	case 5:
+		AIS_TYPE5_FIELDS(AIS_PACK)
+		break;
+	case 6:
+		AIS_TYPE6_FIELDS(AIS_PACK)
+		pack_payload(&rec->type6.payload, ais->type6.bitdata,
+			     ais->type6.bitcount);
+		break;
+	case 7:
+	case 13:
+		AIS_TYPE7_FIELDS(AIS_PACK)
+		AIS_TYPE7_ACK2_FIELDS(AIS_PACK)
+		AIS_TYPE7_ACK3_FIELDS(AIS_PACK)
+		AIS_TYPE7_ACK4_FIELDS(AIS_PACK)
+		break;
+	case 8:
+		AIS_TYPE8_FIELDS(AIS_PACK)
+		pack_payload(&rec->type8.payload, ais->type8.bitdata,
+			     ais->type8.bitcount);
+		break;
+	case 9:
+		AIS_TYPE9_FIELDS(AIS_PACK)
+		break;
+	case 10:
+		AIS_TYPE10_FIELDS(AIS_PACK)
+		break;
+	case 12:
+		AIS_TYPE12_FIELDS(AIS_PACK)
+		rec->type12.text = ais->type12.text;
+		break;
+	case 14:
+		AIS_TYPE14_FIELDS(AIS_PACK)
+		rec->type14.text = ais->type14.text;
+		break;
+	case 15:
+		AIS_TYPE15_FIELDS(AIS_PACK)
+		AIS_TYPE15_REQ2_FIELDS(AIS_PACK)
+		AIS_TYPE15_STATION2_FIELDS(AIS_PACK)
+		break;
+	case 16:
+		AIS_TYPE16_FIELDS(AIS_PACK)
+		AIS_TYPE16_STATION2_FIELDS(AIS_PACK)
+		break;
+	case 17:
+		AIS_TYPE17_FIELDS(AIS_PACK)
+		pack_payload(&rec->type17.payload, ais->type17.bitdata,
+			     ais->type17.bitcount);
+		break;
+	case 18:
+		AIS_TYPE18_FIELDS(AIS_PACK)
+		break;
+	case 19:
+		AIS_TYPE19_FIELDS(AIS_PACK)
+		break;
+	case 20:
+		AIS_TYPE20_FIELDS(AIS_PACK)
+		AIS_TYPE20_BLOCK2_FIELDS(AIS_PACK)
+		AIS_TYPE20_BLOCK3_FIELDS(AIS_PACK)
+		AIS_TYPE20_BLOCK4_FIELDS(AIS_PACK)
+		break;
+	case 21:
+		AIS_TYPE21_FIELDS(AIS_PACK)
+		len = strlen(ais->type21.name);
+		if (len > 20)
+			pack_text(rec->type21.name_ext, ais->type21.name + 20,
+				  sizeof(rec->type21.name_ext));
+		break;
+	case 22:
+		AIS_TYPE22_FIELDS(AIS_PACK)
+		AIS_TYPE22_TAIL_FIELDS(AIS_PACK)
+		if (ais->type22.addressed) {
+			AIS_TYPE22_DEST_FIELDS(AIS_PACK)
+		} else {
+			AIS_TYPE22_AREA_FIELDS(AIS_PACK)
+		}
+		break;
+	case 23:
+		AIS_TYPE23_FIELDS(AIS_PACK)
+		break;
+	case 24:
+		AIS_TYPE24_FIELDS(AIS_PACK)
+		if (ais->type24.part != AIS_TYPE24_PART_B) {
+			AIS_TYPE24A_FIELDS(AIS_PACK)
+		}
+		if (ais->type24.part != AIS_TYPE24_PART_A) {
+			AIS_TYPE24B_FIELDS(AIS_PACK)
+			if (AIS_AUXILIARY_MMSI(ais->mmsi)) {
+				AIS_TYPE24B_MOTHERSHIP_FIELDS(AIS_PACK)
+			} else {
+				AIS_TYPE24B_DIM_FIELDS(AIS_PACK)
+			}
+		}
+		break;
+	case 25:
+		AIS_TYPE25_FIELDS(AIS_PACK)
+		AIS_TYPE25_DEST_FIELDS(AIS_PACK)
+		AIS_TYPE25_APP_FIELDS(AIS_PACK)
+		pack_payload(&rec->type25.payload, ais->type25.bitdata,
+			     ais->type25.bitcount);
+		break;
+	case 26:
+		AIS_TYPE26_FIELDS(AIS_PACK)
+		AIS_TYPE26_DEST_FIELDS(AIS_PACK)
+		AIS_TYPE26_APP_FIELDS(AIS_PACK)
+		AIS_TYPE26_RADIO_FIELDS(AIS_PACK)
+		pack_payload(&rec->type26.payload, ais->type26.bitdata,
+			     ais->type26.bitcount);
+		break;
+	case 27:
+		AIS_TYPE27_FIELDS(AIS_PACK)
+		break;
+	}
+	return size;
+}
+
+/* and back */
+#define AIS_UNPACK_UINT(arm, member, width) \
+	ais->AIS_ARM_##arm.member = rec->AIS_REC_##arm.member;
+#define AIS_UNPACK_SINT(arm, member, width) \
+	ais->AIS_ARM_##arm.member = rec->AIS_REC_##arm.member;
+#define AIS_UNPACK_FLAG(arm, member, width) \
+	ais->AIS_ARM_##arm.member = rec->AIS_REC_##arm.member;
+#define AIS_UNPACK_TEXT(arm, member, width) \
+	(void)memcpy(ais->AIS_ARM_##arm.member, rec->AIS_REC_##arm.member, width); \
+	ais->AIS_ARM_##arm.member[width] = '\0';
+#define AIS_UNPACK_SPARE(arm, member, width)
+#define AIS_UNPACK(arm, member, start, width, kind) \
+	AIS_UNPACK_##kind(arm, member, width)
+
+static size_t unpack_payload(char *bitdata, size_t size,
+			     const struct aivdm_payload_t *payload)
+/* copy the payload into bitdata[size]; returns the bits copied */
+{
+	size_t bitcount = payload->bitcount;
+
+	if (bitcount > size * 8)
+		bitcount = size * 8;
+	if (bitcount != 0)
+		copy_bits((unsigned char *)bitdata, payload->bits,
+			  payload->start, bitcount);
+	return bitcount;
+}
+
+static void unpack_text(char *to, size_t size, const char *text)
+{
+	if (text == NULL)
+		text = "";
+	(void)strncpy(to, text, size - 1);
+	to[size - 1] = '\0';
+}
+
+int aivdm_expand(const union aivdm_record_t *rec, struct ais_t *ais)
+{
+	ais->type = rec->head.type;
+	ais->repeat = rec->head.repeat;
+	ais->mmsi = rec->head.mmsi;
+
+	switch (ais->type) {
+	case 1:
+	case 2:
+	case 3:
+		AIS_TYPE1_FIELDS(AIS_UNPACK)
+		break;
+	case 4:
+	case 11:
+		AIS_TYPE4_FIELDS(AIS_UNPACK)
+		break;
+	case 5:
+		AIS_TYPE5_FIELDS(AIS_UNPACK)
+		break;
+	case 6:
+		AIS_TYPE6_FIELDS(AIS_UNPACK)
+		ais->type6.bitcount = unpack_payload(ais->type6.bitdata,
+				sizeof(ais->type6.bitdata), &rec->type6.payload);
+		break;
+	case 7:
+	case 13:
+		AIS_TYPE7_FIELDS(AIS_UNPACK)
+		AIS_TYPE7_ACK2_FIELDS(AIS_UNPACK)
+		AIS_TYPE7_ACK3_FIELDS(AIS_UNPACK)
+		AIS_TYPE7_ACK4_FIELDS(AIS_UNPACK)
+		break;
+	case 8:
+		AIS_TYPE8_FIELDS(AIS_UNPACK)
+		ais->type8.bitcount = unpack_payload(ais->type8.bitdata,
+				sizeof(ais->type8.bitdata), &rec->type8.payload);
+		break;
+	case 9:
+		AIS_TYPE9_FIELDS(AIS_UNPACK)
+		break;
+	case 10:
+		AIS_TYPE10_FIELDS(AIS_UNPACK)
+		break;
+	case 12:
+		AIS_TYPE12_FIELDS(AIS_UNPACK)
+		unpack_text(ais->type12.text, sizeof(ais->type12.text),
+			    rec->type12.text);
+		break;
+	case 14:
+		AIS_TYPE14_FIELDS(AIS_UNPACK)
+		unpack_text(ais->type14.text, sizeof(ais->type14.text),
+			    rec->type14.text);
+		break;
+	case 15:
+		AIS_TYPE15_FIELDS(AIS_UNPACK)
+		AIS_TYPE15_REQ2_FIELDS(AIS_UNPACK)
+		AIS_TYPE15_STATION2_FIELDS(AIS_UNPACK)
+		break;
+	case 16:
+		AIS_TYPE16_FIELDS(AIS_UNPACK)
+		AIS_TYPE16_STATION2_FIELDS(AIS_UNPACK)
+		break;
+	case 17:
+		AIS_TYPE17_FIELDS(AIS_UNPACK)
+		ais->type17.bitcount = unpack_payload(ais->type17.bitdata,
+				sizeof(ais->type17.bitdata), &rec->type17.payload);
+		break;
+	case 18:
+		AIS_TYPE18_FIELDS(AIS_UNPACK)
+		break;
+	case 19:
+		AIS_TYPE19_FIELDS(AIS_UNPACK)
+		break;
+	case 20:
+		AIS_TYPE20_FIELDS(AIS_UNPACK)
+		AIS_TYPE20_BLOCK2_FIELDS(AIS_UNPACK)
+		AIS_TYPE20_BLOCK3_FIELDS(AIS_UNPACK)
+		AIS_TYPE20_BLOCK4_FIELDS(AIS_UNPACK)
+		break;
+	case 21:
+		AIS_TYPE21_FIELDS(AIS_UNPACK)
+		(void)memcpy(ais->type21.name + 20, rec->type21.name_ext,
+			     sizeof(rec->type21.name_ext));
+		ais->type21.name[sizeof(ais->type21.name) - 1] = '\0';
+		break;
+	case 22:
+		AIS_TYPE22_FIELDS(AIS_UNPACK)
+		AIS_TYPE22_TAIL_FIELDS(AIS_UNPACK)
+		if (ais->type22.addressed) {
+			AIS_TYPE22_DEST_FIELDS(AIS_UNPACK)
+		} else {
+			AIS_TYPE22_AREA_FIELDS(AIS_UNPACK)
+		}
+		break;
+	case 23:
+		AIS_TYPE23_FIELDS(AIS_UNPACK)
+		break;
+	case 24:
+		AIS_TYPE24_FIELDS(AIS_UNPACK)
+		AIS_TYPE24A_FIELDS(AIS_UNPACK)
+		AIS_TYPE24B_FIELDS(AIS_UNPACK)
+		if (AIS_AUXILIARY_MMSI(ais->mmsi)) {
+			AIS_TYPE24B_MOTHERSHIP_FIELDS(AIS_UNPACK)
+		} else {
+			AIS_TYPE24B_DIM_FIELDS(AIS_UNPACK)
+		}
+		break;
+	case 25:
+		AIS_TYPE25_FIELDS(AIS_UNPACK)
+		AIS_TYPE25_DEST_FIELDS(AIS_UNPACK)
+		AIS_TYPE25_APP_FIELDS(AIS_UNPACK)
+		ais->type25.bitcount = unpack_payload(ais->type25.bitdata,
+				sizeof(ais->type25.bitdata), &rec->type25.payload);
+		break;
+	case 26:
+		AIS_TYPE26_FIELDS(AIS_UNPACK)
+		AIS_TYPE26_DEST_FIELDS(AIS_UNPACK)
+		AIS_TYPE26_APP_FIELDS(AIS_UNPACK)
+		AIS_TYPE26_RADIO_FIELDS(AIS_UNPACK)
+		ais->type26.bitcount = unpack_payload(ais->type26.bitdata,
+				sizeof(ais->type26.bitdata), &rec->type26.payload);
+		break;
+	case 27:
+		AIS_TYPE27_FIELDS(AIS_UNPACK)
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+struct aivdm_payload_t *aivdm_record_payload(union aivdm_record_t *rec)
+{
+	switch (rec->head.type) {
+	case 6:
+		return &rec->type6.payload;
+	case 8:
+		return &rec->type8.payload;
+	case 17:
+		return &rec->type17.payload;
+	case 25:
+		return &rec->type25.payload;
+	case 26:
+		return &rec->type26.payload;
+	default:
+		return NULL;
+	}
+}
+
+void aivdm_arena_init(struct aivdm_arena_t *arena, void *buf, size_t size)
+{
+	arena->buf = (unsigned char *)buf;
+	arena->size = size;
+	arena->used = 0;
+}
+
+void aivdm_arena_reset(struct aivdm_arena_t *arena)
+{
+	arena->used = 0;
+}
+
+void *aivdm_arena_alloc(struct aivdm_arena_t *arena, size_t n)
+{
+	void *p;
+
+	if (arena == NULL || arena->size - arena->used < n)
+		return NULL;
+	p = arena->buf + arena->used;
+	arena->used += n;
+	return p;
+}
+
+static int keep_text(struct aivdm_arena_t *arena, const char **text)
+{
+	size_t len = *text != NULL ? strlen(*text) + 1 : 0;
+	char *copy;
+
+	if (len == 0)
+		return 0;
+	copy = (char *)aivdm_arena_alloc(arena, len);
+	if (copy == NULL)
+		return -1;
+	(void)memcpy(copy, *text, len);
+	*text = copy;
+	return 0;
+}
+
+int aivdm_record_keep(struct aivdm_arena_t *arena, union aivdm_record_t *rec)
+{
+	struct aivdm_payload_t *payload;
+	char *copy;
+
+	switch (rec->head.type) {
+	case 12:
+		return keep_text(arena, &rec->type12.text);
+	case 14:
+		return keep_text(arena, &rec->type14.text);
+	}
+	payload = aivdm_record_payload(rec);
+	if (payload == NULL || payload->bitcount == 0)
+		return 0;
+	copy = (char *)aivdm_arena_alloc(arena, (payload->bitcount + 7) / 8);
+	if (copy == NULL)
+		return -1;
+	(void)unpack_payload(copy, (payload->bitcount + 7) / 8, payload);
+	payload->bits = (const unsigned char *)copy;
+	payload->start = 0;
+	return 0;
+}
@@ -0,0 +1,304 @@
+/* aivdm_filter.c - message filters compiled against the schema layouts
+ *
+ * A filter compiles to a table of comparisons and a postfix program
+ * over them.  At compile time each named field is looked up in the
+ * layouts of all 27 message types, so matching a payload is one type
+ * extraction followed by a direct bit extraction per comparison, with
+ * no struct ais_t in between.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "aivdm.h"
+#include "bits.h"
+
+/* postfix operators; comparisons are their index, 0 and up */
+#define OP_AND	-1
+#define OP_OR	-2
+#define OP_NOT	-3
+
+#define NAME_MAX_LEN	24
+
+struct parser_t {
+	const char *cp;
+	struct aivdm_filter_t *filter;
+	int depth;		/* nested '!' and '(' */
+};
+
+static void skip_space(struct parser_t *p)
+{
+	while (isspace((unsigned char)*p->cp))
+		p->cp++;
+}
+
+static int accept(struct parser_t *p, const char *token)
+/* consume token if it comes next */
+{
+	size_t len = strlen(token);
+
+	skip_space(p);
+	if (strncmp(p->cp, token, len) != 0)
+		return 0;
+	p->cp += len;
+	return 1;
+}
+
+static int emit(struct parser_t *p, int op)
+{
+	if (p->filter->nops >= AIVDM_FILTER_OPS)
+		return 0;
+	p->filter->op[p->filter->nops++] = (signed char)op;
+	return 1;
+}
+
+static int parse_number(struct parser_t *p, long *value)
+{
+	char *end;
+
+	skip_space(p);
+	*value = strtol(p->cp, &end, 10);
+	if (end == p->cp)
+		return 0;
+	p->cp = end;
+	return 1;
+}
+
+static void locate(struct aivdm_filter_loc_t *loc, unsigned int id,
+		   const struct aivdm_layout_t *layout)
+{
+	loc->start = aivdm_fields[id].start;
+	loc->width = aivdm_fields[id].width;
+	loc->sign = aivdm_fields[id].kind == AIS_KIND_SINT;
+	if (layout != NULL) {
+		loc->guard_start = layout->guard_start;
+		loc->guard_width = layout->guard_width;
+		loc->guard_value = layout->guard_value;
+	}
+}
+
+static int resolve(struct aivdm_filter_pred_t *pred, const char *name)
+/* fill in where name sits in each message type; 0 if nowhere */
+{
+	const struct aivdm_layout_t *layout;
+	const unsigned short *id;
+	unsigned int type, header;
+	int found = 0;
+
+	(void)memset(pred->at, '\0', sizeof(pred->at));
+	for (header = AIS_FIELD_type; header <= AIS_FIELD_mmsi; header++)
+		if (strcmp(aivdm_fields[header].name, name) == 0) {
+			for (type = 1; type < 28; type++)
+				locate(&pred->at[type], header, NULL);
+			return 1;
+		}
+	for (type = 1; type < 28; type++)
+		for (layout = aivdm_layouts[type];
+				layout->fields != NULL && pred->at[type].width == 0;
+				layout++)
+			for (id = layout->fields; *id != AIS_FIELD_COUNT; id++)
+				if (aivdm_fields[*id].kind != AIS_KIND_TEXT
+						&& strcmp(aivdm_fields[*id].name, name) == 0) {
+					locate(&pred->at[type], *id, layout);
+					found = 1;
+					break;
+				}
+	return found;
+}
+
+static int parse_comparison(struct parser_t *p)
+{
+	struct aivdm_filter_t *filter = p->filter;
+	struct aivdm_filter_pred_t *pred;
+	char name[NAME_MAX_LEN];
+	size_t len = 0;
+	long value;
+	int negate = 0;
+
+	skip_space(p);
+	while (isalnum((unsigned char)p->cp[len]) || p->cp[len] == '_')
+		len++;
+	if (len == 0 || len >= sizeof(name)
+			|| filter->npreds >= AIVDM_FILTER_PREDS)
+		return 0;
+	(void)memcpy(name, p->cp, len);
+	name[len] = '\0';
+	pred = &filter->pred[filter->npreds];
+	if (!resolve(pred, name))
+		return 0;
+	p->cp += len;
+
+	pred->nvalues = 0;
+	pred->lo = LONG_MIN;
+	pred->hi = LONG_MAX;
+	if (accept(p, "in")) {
+		if (accept(p, "[")) {
+			if (!parse_number(p, &pred->lo) || !accept(p, ",")
+					|| !parse_number(p, &pred->hi) || !accept(p, "]"))
+				return 0;
+		} else if (accept(p, "{")) {
+			do {
+				if (pred->nvalues >= AIVDM_FILTER_SET
+						|| !parse_number(p, &value))
+					return 0;
+				pred->value[pred->nvalues++] = value;
+			} while (accept(p, ","));
+			if (!accept(p, "}"))
+				return 0;
+		} else
+			return 0;
+	} else if (accept(p, "==")) {
+		if (!parse_number(p, &pred->lo))
+			return 0;
+		pred->hi = pred->lo;
+	} else if (accept(p, "!=")) {
+		if (!parse_number(p, &pred->lo))
+			return 0;
+		pred->hi = pred->lo;
+		negate = 1;
+	} else if (accept(p, "<=")) {
+		if (!parse_number(p, &pred->hi))
+			return 0;
+	} else if (accept(p, ">=")) {
+		if (!parse_number(p, &pred->lo))
+			return 0;
+	} else if (accept(p, "<")) {
+		if (!parse_number(p, &value) || value == LONG_MIN)
+			return 0;
+		pred->hi = value - 1;
+	} else if (accept(p, ">")) {
+		if (!parse_number(p, &value) || value == LONG_MAX)
+			return 0;
+		pred->lo = value + 1;
+	} else
+		return 0;
+
+	if (!emit(p, filter->npreds++))
+		return 0;
+	return !negate || emit(p, OP_NOT);
+}
+
+static int parse_or(struct parser_t *p);
+
+static int parse_unary(struct parser_t *p)
+/* nothing nested deeper than the program is long could compile anyway */
+{
+	int ok;
+
+	if (++p->depth > AIVDM_FILTER_OPS)
+		return 0;
+	if (accept(p, "!"))
+		ok = parse_unary(p) && emit(p, OP_NOT);
+	else if (accept(p, "("))
+		ok = parse_or(p) && accept(p, ")");
+	else
+		ok = parse_comparison(p);
+	p->depth--;
+	return ok;
+}
+
+static int parse_and(struct parser_t *p)
+{
+	if (!parse_unary(p))
+		return 0;
+	while (accept(p, "&&"))
+		if (!parse_unary(p) || !emit(p, OP_AND))
+			return 0;
+	return 1;
+}
+
+static int parse_or(struct parser_t *p)
+{
+	if (!parse_and(p))
+		return 0;
+	while (accept(p, "||"))
+		if (!parse_and(p) || !emit(p, OP_OR))
+			return 0;
+	return 1;
+}
+
+int aivdm_filter_compile(struct aivdm_filter_t *filter, const char *text)
+{
+	struct parser_t p;
+
+	filter->npreds = 0;
+	filter->nops = 0;
+	p.cp = text;
+	p.filter = filter;
+	p.depth = 0;
+	if (!parse_or(&p))
+		return (int)(p.cp - text);
+	skip_space(&p);
+	if (*p.cp != '\0')
+		return (int)(p.cp - text);
+	return -1;
+}
+
+static int pred_match(const struct aivdm_filter_pred_t *pred,
+		      const struct aivdm_filter_loc_t *loc,
+		      const unsigned char *bits, size_t bitlen)
+{
+	long value;
+	int i;
+
+	if (loc->width == 0 || loc->start + loc->width > bitlen)
+		return 0;
+	if (loc->guard_width != 0
+			&& ubits_fast(bits, loc->guard_start, loc->guard_width)
+			   != loc->guard_value)
+		return 0;
+	if (loc->sign)
+		value = (long)sbits_fast(bits, loc->start, loc->width);
+	else
+		value = (long)ubits_fast(bits, loc->start, loc->width);
+	if (pred->nvalues == 0)
+		return value >= pred->lo && value <= pred->hi;
+	for (i = 0; i < pred->nvalues; i++)
+		if (value == pred->value[i])
+			return 1;
+	return 0;
+}
+
+int aivdm_filter_match(const struct aivdm_filter_t *filter,
+		       const unsigned char *bits, size_t bitlen)
+{
+	unsigned char stack[AIVDM_FILTER_OPS];
+	unsigned int type;
+	int i, top = 0, op;
+
+	if (bitlen < 38)
+		return 0;
+	type = (unsigned int)ubits_fast(bits, 0, 6);
+	if (type == 0 || type >= 28)
+		return 0;
+	for (i = 0; i < filter->nops; i++) {
+		op = filter->op[i];
+		switch (op) {
+		case OP_AND:
+			top--;
+			stack[top - 1] &= stack[top];
+			break;
+		case OP_OR:
+			top--;
+			stack[top - 1] |= stack[top];
+			break;
+		case OP_NOT:
+			stack[top - 1] ^= 1;
+			break;
+		default:
+			stack[top++] = (unsigned char)pred_match(&filter->pred[op],
+					&filter->pred[op].at[type], bits, bitlen);
+			break;
+		}
+	}
+	return top == 1 && stack[0];
+}
+
+#undef NAME_MAX_LEN
+#undef OP_NOT
+#undef OP_OR
+#undef OP_AND
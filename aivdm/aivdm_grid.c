@@ -0,0 +1,380 @@
+/* aivdm_grid.c - uniform grid index over vessel positions
+ *
+ * A cell is numbered column * rows + row, counting from 180 W and 90 S,
+ * and hashed to one of the bucket lists; a list may mix cells, so each
+ * entry keeps its cell number and queries skip the strangers.  Entries
+ * never move, so they are found from the MMSI through index[], open
+ * addressing with backward-shift deletion as in the type 24 cache.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <math.h>
+#include <string.h>
+
+#include "aivdm.h"
+
+#define LON_RANGE	(180 * 600000)	/* 180 degrees in AIS_LATLON_SCALE units */
+#define LAT_RANGE	(90 * 600000)
+#define MIN_CELLSIZE	2400		/* keeps cell numbers in 32 bits */
+#define METERS_PER_UNIT	0.1852		/* a ten-thousandth of a nautical mile */
+
+static unsigned int mix(unsigned int x)
+{
+	x *= 0x9e3779b1U;
+	return x ^ (x >> 16);
+}
+
+size_t aivdm_grid_bufsize(size_t capacity, size_t buckets)
+{
+	size_t slots = 1;
+
+	while (slots < 2 * capacity)
+		slots <<= 1;
+	return capacity * sizeof(struct aivdm_grid_entry_t)
+		+ (buckets + slots) * sizeof(unsigned int);
+}
+
+int aivdm_grid_init(struct aivdm_grid_t *grid, void *buf, size_t capacity,
+		    size_t buckets, unsigned int cellsize)
+{
+	size_t slots = 1, i;
+
+	if (capacity == 0 || capacity >= AIVDM_GRID_NONE / 2
+			|| buckets == 0 || (buckets & (buckets - 1)) != 0
+			|| cellsize < MIN_CELLSIZE)
+		return -1;
+	while (slots < 2 * capacity)
+		slots <<= 1;
+	grid->entry = (struct aivdm_grid_entry_t *)buf;
+	grid->bucket = (unsigned int *)(grid->entry + capacity);
+	grid->index = grid->bucket + buckets;
+	grid->cellsize = cellsize;
+	grid->rows = 2 * LAT_RANGE / cellsize + 1;
+	grid->capacity = (unsigned int)capacity;
+	grid->count = 0;
+	grid->bucketmask = (unsigned int)(buckets - 1);
+	grid->indexmask = (unsigned int)(slots - 1);
+	for (i = 0; i < buckets; i++)
+		grid->bucket[i] = AIVDM_GRID_NONE;
+	(void)memset(grid->index, '\0', slots * sizeof(unsigned int));
+	for (i = 0; i < capacity; i++) {
+		grid->entry[i].mmsi = 0;
+		grid->entry[i].next = (unsigned int)(i + 1 < capacity ? i + 1
+							: AIVDM_GRID_NONE);
+	}
+	grid->freelist = 0;
+	return 0;
+}
+
+static unsigned int find_slot(const struct aivdm_grid_t *grid,
+			      unsigned int mmsi)
+/* the index slot holding mmsi, or the free one where it belongs */
+{
+	unsigned int i;
+
+	for (i = mix(mmsi) & grid->indexmask; grid->index[i] != 0;
+			i = (i + 1) & grid->indexmask)
+		if (grid->entry[grid->index[i] - 1].mmsi == mmsi)
+			break;
+	return i;
+}
+
+static void unindex(struct aivdm_grid_t *grid, unsigned int i)
+{
+	unsigned int j = i, home;
+
+	for (;;) {
+		grid->index[i] = 0;
+		/* find a later slot of the run that may move into the hole */
+		for (;;) {
+			j = (j + 1) & grid->indexmask;
+			if (grid->index[j] == 0)
+				return;
+			home = mix(grid->entry[grid->index[j] - 1].mmsi)
+				& grid->indexmask;
+			/* it stays put if its home lies cyclically in (i, j] */
+			if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+				continue;
+			break;
+		}
+		grid->index[i] = grid->index[j];
+		i = j;
+	}
+}
+
+static unsigned int cell_of(const struct aivdm_grid_t *grid, int lon, int lat)
+{
+	unsigned int column = (unsigned int)(lon + LON_RANGE) / grid->cellsize;
+	unsigned int row = (unsigned int)(lat + LAT_RANGE) / grid->cellsize;
+
+	return column * grid->rows + row;
+}
+
+static void bucket_link(struct aivdm_grid_t *grid, unsigned int e)
+{
+	struct aivdm_grid_entry_t *p = &grid->entry[e];
+	unsigned int *head = &grid->bucket[mix(p->cell) & grid->bucketmask];
+
+	p->prev = AIVDM_GRID_NONE;
+	p->next = *head;
+	if (*head != AIVDM_GRID_NONE)
+		grid->entry[*head].prev = e;
+	*head = e;
+}
+
+static void bucket_unlink(struct aivdm_grid_t *grid, unsigned int e)
+{
+	struct aivdm_grid_entry_t *p = &grid->entry[e];
+
+	if (p->prev != AIVDM_GRID_NONE)
+		grid->entry[p->prev].next = p->next;
+	else
+		grid->bucket[mix(p->cell) & grid->bucketmask] = p->next;
+	if (p->next != AIVDM_GRID_NONE)
+		grid->entry[p->next].prev = p->prev;
+}
+
+int aivdm_grid_remove(struct aivdm_grid_t *grid, unsigned int mmsi)
+{
+	unsigned int i = find_slot(grid, mmsi), e;
+
+	if (grid->index[i] == 0)
+		return 0;
+	e = grid->index[i] - 1;
+	bucket_unlink(grid, e);
+	unindex(grid, i);
+	grid->entry[e].mmsi = 0;
+	grid->entry[e].next = grid->freelist;
+	grid->freelist = e;
+	grid->count--;
+	return 1;
+}
+
+int aivdm_grid_move(struct aivdm_grid_t *grid, unsigned int mmsi,
+		    int lon, int lat)
+{
+	unsigned int i, e, cell;
+	struct aivdm_grid_entry_t *p;
+
+	/* this also turns away the not-available values, 181 and 91 degrees */
+	if (mmsi == 0 || lon < -LON_RANGE || lon >= LON_RANGE
+			|| lat < -LAT_RANGE || lat > LAT_RANGE) {
+		(void)aivdm_grid_remove(grid, mmsi);
+		return 0;
+	}
+	cell = cell_of(grid, lon, lat);
+	i = find_slot(grid, mmsi);
+	if (grid->index[i] != 0) {
+		e = grid->index[i] - 1;
+		p = &grid->entry[e];
+		if (p->cell != cell) {
+			bucket_unlink(grid, e);
+			p->cell = cell;
+			bucket_link(grid, e);
+		}
+	} else {
+		if (grid->freelist == AIVDM_GRID_NONE)
+			return -1;
+		e = grid->freelist;
+		p = &grid->entry[e];
+		grid->freelist = p->next;
+		grid->index[i] = e + 1;
+		grid->count++;
+		p->mmsi = mmsi;
+		p->cell = cell;
+		bucket_link(grid, e);
+	}
+	p->lon = lon;
+	p->lat = lat;
+	return 1;
+}
+
+int aivdm_grid_update(struct aivdm_grid_t *grid, const struct ais_t *ais)
+{
+	int lon, lat;
+
+	switch (ais->type) {
+	case 1:
+	case 2:
+	case 3:
+		lon = ais->type1.lon;
+		lat = ais->type1.lat;
+		break;
+	case 9:
+		lon = ais->type9.lon;
+		lat = ais->type9.lat;
+		break;
+	case 18:
+		lon = ais->type18.lon;
+		lat = ais->type18.lat;
+		break;
+	case 19:
+		lon = ais->type19.lon;
+		lat = ais->type19.lat;
+		break;
+	case 21:
+		lon = ais->type21.lon;
+		lat = ais->type21.lat;
+		break;
+	case 27:
+		/* tenths of a minute; unavailable values stay out of range */
+		lon = ais->type27.lon * 1000;
+		lat = ais->type27.lat * 1000;
+		break;
+	default:
+		return 0;
+	}
+	return aivdm_grid_move(grid, ais->mmsi, lon, lat);
+}
+
+struct query_t {
+	int sw_lon, sw_lat, ne_lon, ne_lat;
+	/* radius queries only, in lat units with lon scaled down */
+	int circle;
+	double lon, lat, scale, r2;
+	unsigned int *out;
+	size_t max, n;
+};
+
+static void consider(struct query_t *q, const struct aivdm_grid_entry_t *p)
+{
+	double dx, dy;
+
+	if (p->lon < q->sw_lon || p->lon > q->ne_lon
+			|| p->lat < q->sw_lat || p->lat > q->ne_lat)
+		return;
+	if (q->circle) {
+		dx = p->lon - q->lon;
+		if (dx > LON_RANGE)
+			dx -= 2.0 * LON_RANGE;
+		else if (dx < -LON_RANGE)
+			dx += 2.0 * LON_RANGE;
+		dx *= q->scale;
+		dy = p->lat - q->lat;
+		if (dx * dx + dy * dy > q->r2)
+			return;
+	}
+	if (q->n < q->max)
+		q->out[q->n] = p->mmsi;
+	q->n++;
+}
+
+static void scan(const struct aivdm_grid_t *grid, struct query_t *q)
+/* one box that does not cross the antimeridian */
+{
+	unsigned int c0, c1, r0, r1, column, row, cell, e;
+	const struct aivdm_grid_entry_t *p;
+
+	if (q->sw_lon < -LON_RANGE)
+		q->sw_lon = -LON_RANGE;
+	if (q->ne_lon >= LON_RANGE)
+		q->ne_lon = LON_RANGE - 1;
+	if (q->sw_lat < -LAT_RANGE)
+		q->sw_lat = -LAT_RANGE;
+	if (q->ne_lat > LAT_RANGE)
+		q->ne_lat = LAT_RANGE;
+	if (q->sw_lon > q->ne_lon || q->sw_lat > q->ne_lat)
+		return;
+	c0 = (unsigned int)(q->sw_lon + LON_RANGE) / grid->cellsize;
+	c1 = (unsigned int)(q->ne_lon + LON_RANGE) / grid->cellsize;
+	r0 = (unsigned int)(q->sw_lat + LAT_RANGE) / grid->cellsize;
+	r1 = (unsigned int)(q->ne_lat + LAT_RANGE) / grid->cellsize;
+
+	/* a box of more cells than buckets reads every list anyway */
+	if ((double)(c1 - c0 + 1) * (r1 - r0 + 1) > grid->bucketmask + 1.0) {
+		for (e = 0; e < grid->capacity; e++)
+			if (grid->entry[e].mmsi != 0)
+				consider(q, &grid->entry[e]);
+		return;
+	}
+	for (column = c0; column <= c1; column++)
+		for (row = r0; row <= r1; row++) {
+			cell = column * grid->rows + row;
+			for (e = grid->bucket[mix(cell) & grid->bucketmask];
+					e != AIVDM_GRID_NONE; e = p->next) {
+				p = &grid->entry[e];
+				if (p->cell == cell)
+					consider(q, p);
+			}
+		}
+}
+
+static void scan_wrapped(const struct aivdm_grid_t *grid, struct query_t *q)
+/* split a box that crosses the antimeridian in two */
+{
+	int ne_lon = q->ne_lon;
+
+	if (q->sw_lon <= ne_lon) {
+		scan(grid, q);
+		return;
+	}
+	q->ne_lon = LON_RANGE - 1;
+	scan(grid, q);
+	q->sw_lon = -LON_RANGE;
+	q->ne_lon = ne_lon;
+	scan(grid, q);
+}
+
+size_t aivdm_grid_box(const struct aivdm_grid_t *grid,
+		      int sw_lon, int sw_lat, int ne_lon, int ne_lat,
+		      unsigned int *out, size_t max)
+{
+	struct query_t q;
+
+	(void)memset(&q, '\0', sizeof(q));
+	q.sw_lon = sw_lon;
+	q.sw_lat = sw_lat;
+	q.ne_lon = ne_lon;
+	q.ne_lat = ne_lat;
+	q.out = out;
+	q.max = max;
+	scan_wrapped(grid, &q);
+	return q.n;
+}
+
+size_t aivdm_grid_radius(const struct aivdm_grid_t *grid, int lon, int lat,
+			 double meters, unsigned int *out, size_t max)
+{
+	struct query_t q;
+	double r = meters / METERS_PER_UNIT, rlon;
+
+	(void)memset(&q, '\0', sizeof(q));
+	q.circle = 1;
+	q.lon = lon;
+	q.lat = lat;
+	q.scale = cos(lat / AIS_LATLON_SCALE * 3.14159265358979323846 / 180.0);
+	q.r2 = r * r;
+	q.out = out;
+	q.max = max;
+	q.sw_lat = lat - (int)r;
+	q.ne_lat = lat + (int)r + 1;
+	rlon = q.scale > r / LON_RANGE ? r / q.scale : LON_RANGE;
+	if (rlon >= LON_RANGE) {
+		/* the circle takes in a pole; every longitude is a candidate */
+		q.sw_lon = -LON_RANGE;
+		q.ne_lon = LON_RANGE - 1;
+		scan(grid, &q);
+		return q.n;
+	}
+	q.sw_lon = lon - (int)rlon;
+	q.ne_lon = lon + (int)rlon + 1;
+	if (q.sw_lon < -LON_RANGE) {
+		/* shift one side across the antimeridian, and the center with it */
+		q.sw_lon += 2 * LON_RANGE;
+		scan_wrapped(grid, &q);
+		return q.n;
+	}
+	if (q.ne_lon >= LON_RANGE) {
+		q.ne_lon -= 2 * LON_RANGE;
+		scan_wrapped(grid, &q);
+		return q.n;
+	}
+	scan(grid, &q);
+	return q.n;
+}
+
+#undef METERS_PER_UNIT
+#undef MIN_CELLSIZE
+#undef LAT_RANGE
+#undef LON_RANGE
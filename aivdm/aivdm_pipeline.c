@@ -0,0 +1,464 @@
+/* aivdm_pipeline.c - sentences dealt out to decoding threads by vessel
+ *
+ * The feeding thread copies each sentence into the batch being filled
+ * for the worker it belongs to, prefixed by its source and length.  A
+ * full batch is queued on the worker and a fresh one taken from a pool
+ * shared by all workers; the pool holds AIVDM_PIPELINE_DEPTH batches
+ * per worker and is what makes a fast feeder wait for slow workers.
+ * One lock covers the pool, the queues and the totals, and is taken
+ * once per batch rather than once per sentence.
+ *
+ * A first fragment carries the MMSI, later ones do not, so the worker
+ * chosen for a first fragment is remembered under its source, channel
+ * and sequence id in route[] until the last fragment comes by.  route[]
+ * is set-associative; a first fragment finding its set full of
+ * messages in flight pushes out the oldest, whose later fragments can
+ * then no longer be routed, and that message is counted as dropped.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "aivdm.h"
+#include "aivdm_thread.h"
+
+#define ROUTE_SLOTS	4096	/* a power of two */
+#define ROUTE_WAYS	4	/* slots per set, a power of two */
+#define LINE_HEADER	5	/* source, 4 bytes, then length, 1 byte */
+
+struct batch_t {
+	struct batch_t *next;
+	size_t used;
+	char data[AIVDM_PIPELINE_BATCH];
+};
+
+struct route_t {
+	unsigned long tick;	/* first fragments routed before this one */
+	unsigned int source;
+	unsigned char channel, seqid;
+	unsigned char worker;
+	unsigned char used;
+};
+
+struct worker_t {
+	struct aivdm_pipeline_t *pipeline;
+	unsigned int index;
+	aivdm_thread_t thread;
+	aivdm_cond_t ready;		/* queue gained a batch, or stopping */
+	struct batch_t *head, *tail;	/* queued, under the lock */
+	struct batch_t *filling;	/* feeder's batch, not yet queued */
+	unsigned long status[AIVDM_STATUS_COUNT];	/* totals, under the lock */
+	unsigned long dropped;
+	struct aivdm_type24_cache_t *type24;
+	struct aivdm_reasm_t reasm;
+	struct ais_t out[AIVDM_PIPELINE_RECORDS];
+};
+
+struct aivdm_pipeline_t {
+	struct aivdm_pipeline_opts_t opts;
+	unsigned int nworkers;
+	struct worker_t *worker[AIVDM_PIPELINE_MAXWORKERS];
+	aivdm_mutex_t lock;
+	aivdm_cond_t freed;		/* pool gained a batch */
+	struct batch_t *pool;		/* free batches, under the lock */
+	unsigned int nfree, nbatches;
+	int stopping;
+	/* the rest belongs to the feeding thread */
+	unsigned long sentences;
+	unsigned long status[AIVDM_STATUS_COUNT];	/* lines turned away before dealing */
+	struct route_t route[ROUTE_SLOTS];
+	unsigned long routed;		/* first fragments of multipart messages */
+	unsigned long misrouted;	/* routes pushed out while in flight */
+	char carry[AIVDM_LINE_MAX];
+	size_t carrylen;
+	int overlong;
+};
+
+void aivdm_pipeline_opts_init(struct aivdm_pipeline_opts_t *opts)
+{
+	(void)memset(opts, '\0', sizeof(*opts));
+}
+
+static void worker_decode(struct worker_t *w, const struct batch_t *batch,
+			  unsigned long *status)
+/* decode one batch, handing records to the sink as they pile up */
+{
+	const struct aivdm_pipeline_opts_t *opts = &w->pipeline->opts;
+	const char *p = batch->data, *end = batch->data + batch->used;
+	unsigned int source;
+	size_t len, nout = 0;
+	int st;
+
+	while (p < end) {
+		(void)memcpy(&source, p, sizeof(source));
+		len = (unsigned char)p[4];
+		p += LINE_HEADER;
+		st = aivdm_reasm_decode(&w->reasm, source, 0, p, len, &w->out[nout]);
+		p += len;
+		status[st]++;
+		if (st == AIVDM_STATUS_DECODED && ++nout == AIVDM_PIPELINE_RECORDS) {
+			if (opts->sink != NULL)
+				opts->sink(opts->arg, w->index, w->out, nout);
+			nout = 0;
+		}
+	}
+	if (nout > 0 && opts->sink != NULL)
+		opts->sink(opts->arg, w->index, w->out, nout);
+}
+
+static void worker_main(void *arg)
+{
+	struct worker_t *w = (struct worker_t *)arg;
+	struct aivdm_pipeline_t *pl = w->pipeline;
+	struct batch_t *batch;
+	unsigned long status[AIVDM_STATUS_COUNT];
+	int i;
+
+	aivdm_mutex_lock(&pl->lock);
+	for (;;) {
+		while (w->head == NULL && !pl->stopping)
+			aivdm_cond_wait(&w->ready, &pl->lock);
+		if (w->head == NULL)
+			break;
+		batch = w->head;
+		w->head = batch->next;
+		aivdm_mutex_unlock(&pl->lock);
+
+		(void)memset(status, '\0', sizeof(status));
+		worker_decode(w, batch, status);
+
+		aivdm_mutex_lock(&pl->lock);
+		for (i = 0; i < AIVDM_STATUS_COUNT; i++)
+			w->status[i] += status[i];
+		w->dropped = w->reasm.dropped;
+		batch->next = pl->pool;
+		pl->pool = batch;
+		pl->nfree++;
+		aivdm_cond_signal(&pl->freed);
+	}
+	aivdm_mutex_unlock(&pl->lock);
+}
+
+static void hand_over(struct aivdm_pipeline_t *pl, struct worker_t *w)
+{
+	struct batch_t *batch = w->filling;
+
+	w->filling = NULL;
+	batch->next = NULL;
+	aivdm_mutex_lock(&pl->lock);
+	if (w->head == NULL)
+		w->head = batch;
+	else
+		w->tail->next = batch;
+	w->tail = batch;
+	aivdm_cond_signal(&w->ready);
+	aivdm_mutex_unlock(&pl->lock);
+}
+
+static struct batch_t *take_batch(struct aivdm_pipeline_t *pl)
+{
+	struct batch_t *batch;
+
+	aivdm_mutex_lock(&pl->lock);
+	while (pl->pool == NULL)
+		aivdm_cond_wait(&pl->freed, &pl->lock);
+	batch = pl->pool;
+	pl->pool = batch->next;
+	pl->nfree--;
+	aivdm_mutex_unlock(&pl->lock);
+	batch->used = 0;
+	return batch;
+}
+
+static unsigned int route_hash(unsigned int source, unsigned char channel,
+			       unsigned char seqid)
+{
+	unsigned int h = source * 0x9e3779b1U;
+
+	h ^= ((unsigned int)channel << 8) | seqid;
+	h ^= h >> 15;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	return h;
+}
+
+static unsigned int choose_worker(struct aivdm_pipeline_t *pl,
+				  unsigned int source,
+				  const struct aivdm_peek_t *peek)
+{
+	unsigned char seqid = peek->seqid < 0 ? 0xff : (unsigned char)peek->seqid;
+	unsigned char channel = (unsigned char)peek->channel;
+	unsigned int h, i, k;
+	struct route_t *set, *r = NULL;
+
+	if (peek->await == 1)
+		return (peek->mmsi * 0x9e3779b1U >> 8) % pl->nworkers;
+	h = route_hash(source, channel, seqid);
+	set = &pl->route[h & (ROUTE_SLOTS - ROUTE_WAYS)];
+	for (i = 0; i < ROUTE_WAYS; i++)
+		if (set[i].used && set[i].source == source
+				&& set[i].channel == channel && set[i].seqid == seqid) {
+			r = &set[i];
+			break;
+		}
+	if (peek->part == 1) {
+		/* a reused key restarts its message; else a free way or the oldest */
+		if (r == NULL) {
+			r = &set[0];
+			for (i = 0; i < ROUTE_WAYS && r->used; i++)
+				if (!set[i].used || set[i].tick < r->tick)
+					r = &set[i];
+			if (r->used)
+				pl->misrouted++;
+		}
+		k = peek->header ? (peek->mmsi * 0x9e3779b1U >> 8) % pl->nworkers
+				 : (h >> 8) % pl->nworkers;
+		r->tick = pl->routed++;
+		r->source = source;
+		r->channel = channel;
+		r->seqid = seqid;
+		r->worker = (unsigned char)k;
+		r->used = 1;
+		return k;
+	}
+	if (r != NULL) {
+		if (peek->part >= peek->await)
+			r->used = 0;
+		return r->worker;
+	}
+	/* the first fragment was lost or pushed out; it cannot complete */
+	return (h >> 8) % pl->nworkers;
+}
+
+static void deal_line(struct aivdm_pipeline_t *pl, unsigned int source,
+		      const char *line, size_t len)
+{
+	struct aivdm_peek_t peek;
+	struct worker_t *w;
+	char *p;
+
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+	if (len == 0)
+		return;
+	pl->sentences++;
+	if (len < 7 || line[0] != '!' || line[3] != 'V' || line[4] != 'D'
+			|| (line[5] != 'M' && line[5] != 'O') || line[6] != ',') {
+		pl->status[AIVDM_STATUS_IGNORED]++;
+		return;
+	}
+	/* the worker checks the checksum, which is why it is skipped here */
+	if (len > AIVDM_LINE_MAX
+			|| !aivdm_peek(line, len, AIVDM_DECODE_NOCHECKSUM, &peek)) {
+		pl->status[AIVDM_STATUS_REJECTED]++;
+		return;
+	}
+
+	w = pl->worker[choose_worker(pl, source, &peek)];
+	if (w->filling != NULL
+			&& w->filling->used + LINE_HEADER + len > AIVDM_PIPELINE_BATCH)
+		hand_over(pl, w);
+	if (w->filling == NULL)
+		w->filling = take_batch(pl);
+	p = w->filling->data + w->filling->used;
+	(void)memcpy(p, &source, sizeof(source));
+	p[4] = (char)len;
+	(void)memcpy(p + LINE_HEADER, line, len);
+	w->filling->used += LINE_HEADER + len;
+}
+
+static void carry_append(struct aivdm_pipeline_t *pl, const char *p, size_t len)
+{
+	if (pl->overlong)
+		return;
+	if (pl->carrylen + len > sizeof(pl->carry)) {
+		pl->overlong = 1;
+		pl->carrylen = 0;
+		return;
+	}
+	(void)memcpy(pl->carry + pl->carrylen, p, len);
+	pl->carrylen += len;
+}
+
+void aivdm_pipeline_feed(struct aivdm_pipeline_t *pl,
+			 unsigned int source, const char *buf, size_t buflen)
+{
+	const char *p = buf, *end = buf + buflen, *nl;
+
+	if (pl->carrylen > 0 || pl->overlong) {
+		nl = (const char *)memchr(p, '\n', buflen);
+		if (nl == NULL) {
+			carry_append(pl, p, buflen);
+			return;
+		}
+		carry_append(pl, p, (size_t)(nl - p));
+		if (!pl->overlong)
+			deal_line(pl, source, pl->carry, pl->carrylen);
+		pl->carrylen = 0;
+		pl->overlong = 0;
+		p = nl + 1;
+	}
+	while (p < end) {
+		nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+		if (nl == NULL) {
+			carry_append(pl, p, (size_t)(end - p));
+			break;
+		}
+		deal_line(pl, source, p, (size_t)(nl - p));
+		p = nl + 1;
+	}
+}
+
+void aivdm_pipeline_flush(struct aivdm_pipeline_t *pl)
+{
+	unsigned int i;
+
+	for (i = 0; i < pl->nworkers; i++)
+		if (pl->worker[i]->filling != NULL)
+			hand_over(pl, pl->worker[i]);
+	aivdm_mutex_lock(&pl->lock);
+	while (pl->nfree < pl->nbatches)
+		aivdm_cond_wait(&pl->freed, &pl->lock);
+	aivdm_mutex_unlock(&pl->lock);
+}
+
+void aivdm_pipeline_stats(struct aivdm_pipeline_t *pl,
+			  struct aivdm_pipeline_stats_t *stats)
+{
+	unsigned int i, k;
+
+	stats->sentences = pl->sentences;
+	for (k = 0; k < AIVDM_STATUS_COUNT; k++)
+		stats->status[k] = pl->status[k];
+	stats->dropped = pl->misrouted;
+	aivdm_mutex_lock(&pl->lock);
+	for (i = 0; i < pl->nworkers; i++) {
+		for (k = 0; k < AIVDM_STATUS_COUNT; k++)
+			stats->status[k] += pl->worker[i]->status[k];
+		stats->dropped += pl->worker[i]->dropped;
+	}
+	aivdm_mutex_unlock(&pl->lock);
+}
+
+static void pipeline_free(struct aivdm_pipeline_t *pl)
+/* everything create() got, once no worker runs any more */
+{
+	struct batch_t *batch;
+	unsigned int i;
+
+	while ((batch = pl->pool) != NULL) {
+		pl->pool = batch->next;
+		free(batch);
+	}
+	for (i = 0; i < pl->nworkers; i++) {
+		aivdm_cond_destroy(&pl->worker[i]->ready);
+		free(pl->worker[i]->type24);
+		free(pl->worker[i]);
+	}
+	aivdm_cond_destroy(&pl->freed);
+	aivdm_mutex_destroy(&pl->lock);
+	free(pl);
+}
+
+static void stop_workers(struct aivdm_pipeline_t *pl, unsigned int running)
+{
+	unsigned int i;
+
+	aivdm_mutex_lock(&pl->lock);
+	pl->stopping = 1;
+	for (i = 0; i < running; i++)
+		aivdm_cond_signal(&pl->worker[i]->ready);
+	aivdm_mutex_unlock(&pl->lock);
+	for (i = 0; i < running; i++)
+		aivdm_thread_join(pl->worker[i]->thread);
+}
+
+struct aivdm_pipeline_t *aivdm_pipeline_create(
+			const struct aivdm_pipeline_opts_t *opts)
+{
+	struct aivdm_pipeline_t *pl;
+	struct worker_t *w;
+	struct batch_t *batch;
+	struct aivdm_context_t warmup;
+	struct ais_t ais;
+	static const char sample[] = "!AIVDM,1,1,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0*4A";
+	unsigned int i, n = opts->workers;
+	int ok = 1;
+
+	if (n == 0)
+		n = aivdm_cpu_count();
+	if (n > AIVDM_PIPELINE_MAXWORKERS)
+		n = AIVDM_PIPELINE_MAXWORKERS;
+	pl = (struct aivdm_pipeline_t *)calloc(1, sizeof(*pl));
+	if (pl == NULL)
+		return NULL;
+	pl->opts = *opts;
+	aivdm_mutex_init(&pl->lock);
+	aivdm_cond_init(&pl->freed);
+	/* let the kernels get picked here rather than by racing workers */
+	aivdm_context_init(&warmup);
+	(void)aivdm_decode(sample, strlen(sample), &warmup, &ais);
+
+	for (i = 0; i < n; i++) {
+		w = (struct worker_t *)calloc(1, sizeof(*w));
+		if (w == NULL)
+			ok = 0;
+		else {
+			pl->worker[pl->nworkers++] = w;
+			aivdm_cond_init(&w->ready);
+			w->pipeline = pl;
+			w->index = i;
+			aivdm_reasm_init(&w->reasm, 0, opts->maxage);
+			w->reasm.flags = opts->flags;
+			w->reasm.filter = opts->filter;
+			w->reasm.projection = opts->projection;
+			if (opts->type24) {
+				w->type24 = (struct aivdm_type24_cache_t *)
+					malloc(sizeof(*w->type24));
+				if (w->type24 == NULL)
+					ok = 0;
+				else
+					aivdm_type24_cache_init(w->type24);
+				w->reasm.type24 = w->type24;
+			}
+		}
+		if (!ok)
+			break;
+	}
+	for (i = 0; ok && i < AIVDM_PIPELINE_DEPTH * n; i++) {
+		batch = (struct batch_t *)malloc(sizeof(*batch));
+		if (batch == NULL)
+			ok = 0;
+		else {
+			batch->next = pl->pool;
+			pl->pool = batch;
+			pl->nbatches++;
+		}
+	}
+	pl->nfree = pl->nbatches;
+	if (!ok) {
+		pipeline_free(pl);
+		return NULL;
+	}
+
+	for (i = 0; i < n; i++)
+		if (aivdm_thread_start(&pl->worker[i]->thread,
+				worker_main, pl->worker[i]) != 0) {
+			stop_workers(pl, i);
+			pipeline_free(pl);
+			return NULL;
+		}
+	return pl;
+}
+
+void aivdm_pipeline_destroy(struct aivdm_pipeline_t *pl)
+{
+	aivdm_pipeline_flush(pl);
+	stop_workers(pl, pl->nworkers);
+	pipeline_free(pl);
+}
+
+#undef LINE_HEADER
+#undef ROUTE_SLOTS
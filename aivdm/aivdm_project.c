@@ -0,0 +1,153 @@
+/* aivdm_project.c - decode only the fields a consumer asked for
+ *
+ * A projection is compiled into one flat row table, sliced by message
+ * type, so applying it is a walk over the few rows of one type with a
+ * direct extraction each.  Members that are not asked for are never
+ * read from the bits nor written to the struct.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <string.h>
+
+#include "aivdm.h"
+#include "bits.h"
+#include "sixbit.h"
+
+static int name_known(const char *name)
+{
+	const struct aivdm_layout_t *layout;
+	const unsigned short *id;
+	unsigned int type, header;
+
+	for (header = AIS_FIELD_type; header <= AIS_FIELD_mmsi; header++)
+		if (strcmp(aivdm_fields[header].name, name) == 0)
+			return 1;
+	for (type = 1; type < 28; type++)
+		for (layout = aivdm_layouts[type]; layout->fields != NULL; layout++)
+			for (id = layout->fields; *id != AIS_FIELD_COUNT; id++)
+				if (strcmp(aivdm_fields[*id].name, name) == 0)
+					return 1;
+	return 0;
+}
+
+int aivdm_projection_compile(struct aivdm_projection_t *proj,
+			     const char *const *names, size_t n)
+{
+	const struct aivdm_layout_t *layout;
+	const unsigned short *id;
+	struct aivdm_projection_row_t *row;
+	unsigned int type, nrows = 0;
+	size_t k;
+
+	for (k = 0; k < n; k++)
+		if (!name_known(names[k]))
+			return (int)k;
+	proj->first[0] = 0;
+	for (type = 1; type < 28; type++) {
+		proj->first[type] = (unsigned short)nrows;
+		for (layout = aivdm_layouts[type]; layout->fields != NULL; layout++)
+			for (id = layout->fields; *id != AIS_FIELD_COUNT; id++)
+				for (k = 0; k < n; k++)
+					if (strcmp(aivdm_fields[*id].name, names[k]) == 0) {
+						if (nrows == AIVDM_PROJECTION_ROWS)
+							break;
+						row = &proj->row[nrows++];
+						row->id = *id;
+						row->guard_start = layout->guard_start;
+						row->guard_width = layout->guard_width;
+						row->guard_value = layout->guard_value;
+						break;
+					}
+	}
+	proj->first[28] = (unsigned short)nrows;
+	return -1;
+}
+
+static int row_present(const struct aivdm_projection_row_t *row,
+		       const struct aivdm_field_t *field,
+		       const unsigned char *bits, size_t bitlen)
+{
+	unsigned int nbits = field->kind == AIS_KIND_TEXT
+		? 6 * (unsigned int)field->width : field->width;
+
+	if ((size_t)field->start + nbits > bitlen)
+		return 0;
+	return row->guard_width == 0
+	    || ubits_fast(bits, row->guard_start, row->guard_width)
+	       == row->guard_value;
+}
+
+void aivdm_project(const struct aivdm_projection_t *proj,
+		   const unsigned char *bits, size_t bitlen, struct ais_t *ais)
+{
+	const struct aivdm_projection_row_t *row, *end;
+	const struct aivdm_field_t *field;
+	char *member;
+
+	ais->type = (unsigned int)ubits_fast(bits, 0, 6);
+	ais->repeat = (unsigned int)ubits_fast(bits, 6, 2);
+	ais->mmsi = (unsigned int)ubits_fast(bits, 8, 30);
+	if (ais->type >= 28)
+		return;
+	end = proj->row + proj->first[ais->type + 1];
+	for (row = proj->row + proj->first[ais->type]; row < end; row++) {
+		field = &aivdm_fields[row->id];
+		if (!row_present(row, field, bits, bitlen))
+			continue;
+		member = (char *)ais + field->offset;
+		switch (field->kind) {
+		case AIS_KIND_UINT:
+			*(unsigned int *)member =
+				(unsigned int)ubits_fast(bits, field->start, field->width);
+			break;
+		case AIS_KIND_SINT:
+			*(int *)member = (int)sbits_fast(bits, field->start, field->width);
+			break;
+		case AIS_KIND_FLAG:
+			*(int *)member = ubits_fast(bits, field->start, field->width) != 0;
+			break;
+		case AIS_KIND_TEXT:
+			(void)sixbit_get_text(bits, field->start, field->width, member);
+			break;
+		}
+	}
+}
+
+void aivdm_visit(const struct aivdm_projection_t *proj,
+		 const unsigned char *bits, size_t bitlen,
+		 aivdm_visitor_t visitor, void *arg)
+{
+	const struct aivdm_projection_row_t *row, *end;
+	const struct aivdm_field_t *field;
+	char text[AIS_SHIPNAME_MAXLEN + 1];	/* names are the widest text rows */
+	unsigned int type = (unsigned int)ubits_fast(bits, 0, 6);
+
+	visitor(arg, AIS_FIELD_type, (long)type, NULL);
+	visitor(arg, AIS_FIELD_repeat, (long)ubits_fast(bits, 6, 2), NULL);
+	visitor(arg, AIS_FIELD_mmsi, (long)ubits_fast(bits, 8, 30), NULL);
+	if (type >= 28)
+		return;
+	end = proj->row + proj->first[type + 1];
+	for (row = proj->row + proj->first[type]; row < end; row++) {
+		field = &aivdm_fields[row->id];
+		if (!row_present(row, field, bits, bitlen))
+			continue;
+		switch (field->kind) {
+		case AIS_KIND_UINT:
+		case AIS_KIND_FLAG:
+			visitor(arg, row->id,
+				(long)ubits_fast(bits, field->start, field->width), NULL);
+			break;
+		case AIS_KIND_SINT:
+			visitor(arg, row->id,
+				(long)sbits_fast(bits, field->start, field->width), NULL);
+			break;
+		case AIS_KIND_TEXT:
+			visitor(arg, row->id,
+				(long)sixbit_get_text(bits, field->start, field->width, text),
+				text);
+			break;
+		}
+	}
+}
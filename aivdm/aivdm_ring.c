@@ -0,0 +1,342 @@
+/* aivdm_ring.c - lock-free rings for sentences and decoded records
+ *
+ * A ring record is an 8-byte header holding its length, then the data
+ * rounded up to 8 bytes.  A record never wraps: when it will not fit
+ * before the end of the buffer a SKIP header sends the consumer back
+ * to the start.  Positions are unsigned 32-bit counters that are
+ * allowed to wrap, so rings and queues are limited to 2^31 bytes or
+ * cells.
+ *
+ * The MPMC queue is Vyukov's bounded queue with batches: each cell has
+ * a sequence word that says which lap may write or read it next, and
+ * a batch is as many cells in a row as are ready, claimed at once.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <string.h>
+
+#include "aivdm.h"
+#include "aivdm_atomic.h"
+
+#define RECORD_HEADER	8
+#define ROUND8(n)	(((n) + 7) & ~(size_t)7)
+#define SKIP		0xffffffffU
+
+int aivdm_ring_init(struct aivdm_ring_t *ring, void *buf, size_t size)
+{
+	if (size < 2 * RECORD_HEADER || (size & (size - 1)) != 0
+			|| size > 0x80000000U)
+		return -1;
+	(void)memset(ring, '\0', sizeof(*ring));
+	ring->buf = (unsigned char *)buf;
+	ring->mask = (unsigned int)(size - 1);
+	return 0;
+}
+
+static int record_fits(const struct aivdm_ring_t *ring, size_t len)
+/* half the ring at most, so one can always follow a skip to the start */
+{
+	return RECORD_HEADER + ROUND8(len) <= (ring->mask + 1) / 2;
+}
+
+static int ring_room(struct aivdm_ring_t *ring, unsigned int end)
+/* can the producer run up to end without overwriting unreleased records? */
+{
+	if (end - ring->headcache <= ring->mask + 1)
+		return 1;
+	ring->headcache = aivdm_load_acquire(&ring->head);
+	return end - ring->headcache <= ring->mask + 1;
+}
+
+static unsigned int ring_gap(const struct aivdm_ring_t *ring,
+			     unsigned int pos, unsigned int need)
+/* bytes to skip at pos so a record of need bytes does not wrap */
+{
+	unsigned int left = ring->mask + 1 - (pos & ring->mask);
+
+	return left < need ? left : 0;
+}
+
+void *aivdm_ring_reserve(struct aivdm_ring_t *ring, size_t maxlen)
+{
+	unsigned int need, gap;
+
+	if (!record_fits(ring, maxlen))
+		return NULL;
+	need = (unsigned int)(RECORD_HEADER + ROUND8(maxlen));
+	gap = ring_gap(ring, ring->ptail, need);
+	if (!ring_room(ring, ring->ptail + gap + need))
+		return NULL;
+	if (gap != 0) {
+		*(unsigned int *)(ring->buf + (ring->ptail & ring->mask)) = SKIP;
+		ring->ptail += gap;
+	}
+	return ring->buf + (ring->ptail & ring->mask) + RECORD_HEADER;
+}
+
+void aivdm_ring_produce(struct aivdm_ring_t *ring, size_t len)
+{
+	*(unsigned int *)(ring->buf + (ring->ptail & ring->mask)) = (unsigned int)len;
+	ring->ptail += (unsigned int)(RECORD_HEADER + ROUND8(len));
+}
+
+void aivdm_ring_publish(struct aivdm_ring_t *ring)
+{
+	aivdm_store_release(&ring->tail, ring->ptail);
+}
+
+const void *aivdm_ring_peek(struct aivdm_ring_t *ring, size_t *len)
+{
+	unsigned int header;
+
+	for (;;) {
+		if (ring->chead == ring->tailcache) {
+			ring->tailcache = aivdm_load_acquire(&ring->tail);
+			if (ring->chead == ring->tailcache)
+				return NULL;
+		}
+		header = *(const unsigned int *)(ring->buf + (ring->chead & ring->mask));
+		if (header != SKIP)
+			break;
+		ring->chead += ring->mask + 1 - (ring->chead & ring->mask);
+	}
+	*len = header;
+	return ring->buf + (ring->chead & ring->mask) + RECORD_HEADER;
+}
+
+void aivdm_ring_consume(struct aivdm_ring_t *ring)
+{
+	size_t len = *(const unsigned int *)(ring->buf + (ring->chead & ring->mask));
+
+	ring->chead += (unsigned int)(RECORD_HEADER + ROUND8(len));
+}
+
+void aivdm_ring_release(struct aivdm_ring_t *ring)
+{
+	aivdm_store_release(&ring->head, ring->chead);
+}
+
+size_t aivdm_ring_push(struct aivdm_ring_t *ring, const void *const *data,
+		       const size_t *lens, size_t n)
+{
+	void *p;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if ((p = aivdm_ring_reserve(ring, lens[i])) == NULL)
+			break;
+		(void)memcpy(p, data[i], lens[i]);
+		aivdm_ring_produce(ring, lens[i]);
+	}
+	if (i > 0)
+		aivdm_ring_publish(ring);
+	return i;
+}
+
+size_t aivdm_ring_pop(struct aivdm_ring_t *ring, void *out, size_t stride,
+		      size_t *lens, size_t n)
+{
+	const void *p;
+	size_t i, len;
+
+	for (i = 0; i < n; i++) {
+		if ((p = aivdm_ring_peek(ring, &len)) == NULL)
+			break;
+		(void)memcpy((char *)out + i * stride, p, len < stride ? len : stride);
+		lens[i] = len;
+		aivdm_ring_consume(ring);
+	}
+	if (i > 0)
+		aivdm_ring_release(ring);
+	return i;
+}
+
+/* a cell is its sequence word, its length word, then the record */
+#define CELL(q, pos)	((q)->cells + (size_t)((pos) & (q)->mask) * (q)->stride)
+#define CELL_SEQ(c)	((volatile unsigned int *)(c))
+#define CELL_LEN(c)	(((unsigned int *)(c))[1])
+
+size_t aivdm_mpmc_bufsize(size_t ncells, size_t cellsize)
+{
+	return ncells * (RECORD_HEADER + ROUND8(cellsize));
+}
+
+int aivdm_mpmc_init(struct aivdm_mpmc_t *q, void *buf,
+		    size_t ncells, size_t cellsize)
+{
+	unsigned int i;
+
+	if (ncells == 0 || (ncells & (ncells - 1)) != 0 || ncells > 0x80000000U)
+		return -1;
+	(void)memset(q, '\0', sizeof(*q));
+	q->cells = (unsigned char *)buf;
+	q->cellsize = cellsize;
+	q->stride = RECORD_HEADER + ROUND8(cellsize);
+	q->mask = (unsigned int)(ncells - 1);
+	for (i = 0; i <= q->mask; i++)
+		*CELL_SEQ(CELL(q, i)) = i;
+	return 0;
+}
+
+size_t aivdm_mpmc_push(struct aivdm_mpmc_t *q, const void *const *data,
+		       const size_t *lens, size_t n)
+{
+	unsigned int pos, seq, k;
+	unsigned char *c;
+	size_t len;
+
+	if (n == 0)
+		return 0;
+	for (;;) {
+		pos = aivdm_load_acquire(&q->tail);
+		/* a cell is free for this lap when its sequence is its position */
+		for (k = 0; k < n && k <= q->mask; k++)
+			if (aivdm_load_acquire(CELL_SEQ(CELL(q, pos + k))) != pos + k)
+				break;
+		if (k == 0) {
+			seq = aivdm_load_acquire(CELL_SEQ(CELL(q, pos)));
+			if ((int)(seq - pos) < 0)
+				return 0;	/* still holds last lap's record */
+			continue;		/* another producer got there first */
+		}
+		if (aivdm_compare_swap(&q->tail, pos, pos + k))
+			break;
+	}
+	for (n = 0; n < k; n++) {
+		c = CELL(q, pos + n);
+		len = lens[n] < q->cellsize ? lens[n] : q->cellsize;
+		(void)memcpy(c + RECORD_HEADER, data[n], len);
+		CELL_LEN(c) = (unsigned int)len;
+		aivdm_store_release(CELL_SEQ(c), pos + (unsigned int)n + 1);
+	}
+	return k;
+}
+
+size_t aivdm_mpmc_pop(struct aivdm_mpmc_t *q, void *out, size_t stride,
+		      size_t *lens, size_t n)
+{
+	unsigned int pos, seq, k;
+	unsigned char *c;
+	size_t len;
+
+	if (n == 0)
+		return 0;
+	for (;;) {
+		pos = aivdm_load_acquire(&q->head);
+		/* a cell is full for this lap when its sequence is one ahead */
+		for (k = 0; k < n && k <= q->mask; k++)
+			if (aivdm_load_acquire(CELL_SEQ(CELL(q, pos + k))) != pos + k + 1)
+				break;
+		if (k == 0) {
+			seq = aivdm_load_acquire(CELL_SEQ(CELL(q, pos)));
+			if ((int)(seq - (pos + 1)) < 0)
+				return 0;	/* not written yet */
+			continue;		/* another consumer got there first */
+		}
+		if (aivdm_compare_swap(&q->head, pos, pos + k))
+			break;
+	}
+	for (n = 0; n < k; n++) {
+		c = CELL(q, pos + n);
+		len = CELL_LEN(c);
+		(void)memcpy((char *)out + n * stride, c + RECORD_HEADER,
+			     len < stride ? len : stride);
+		lens[n] = len;
+		aivdm_store_release(CELL_SEQ(c), pos + (unsigned int)n + q->mask + 1);
+	}
+	return k;
+}
+
+#undef CELL_LEN
+#undef CELL_SEQ
+#undef CELL
+
+size_t aivdm_reasm_decode_ring(struct aivdm_reasm_t *reasm,
+			       unsigned int source, unsigned long now,
+			       struct aivdm_ring_t *sentences,
+			       struct aivdm_ring_t *records)
+{
+	struct ais_t *ais;
+	const char *line;
+	size_t len, n = 0;
+
+	/* decoded in place; a record that does not decode is not produced */
+	while ((ais = (struct ais_t *)aivdm_ring_reserve(records,
+				sizeof(*ais))) != NULL
+			&& (line = (const char *)aivdm_ring_peek(sentences,
+				&len)) != NULL) {
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			len--;
+		if (aivdm_reasm_decode(reasm, source, now, line, len, ais)
+				== AIVDM_STATUS_DECODED)
+			aivdm_ring_produce(records, sizeof(*ais));
+		aivdm_ring_consume(sentences);
+		n++;
+	}
+	if (n > 0) {
+		aivdm_ring_release(sentences);
+		aivdm_ring_publish(records);
+	}
+	return n;
+}
+
+static int ring_fits(struct aivdm_ring_t *ring, const size_t *lens, int n)
+/* would n records of these lengths all go in right now? */
+{
+	unsigned int pos = ring->ptail, need;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (!record_fits(ring, lens[i]))
+			return 0;
+		need = (unsigned int)(RECORD_HEADER + ROUND8(lens[i]));
+		pos += ring_gap(ring, pos, need) + need;
+	}
+	return ring_room(ring, pos);
+}
+
+size_t aivdm_encode_ring(struct aivdm_ring_t *records,
+			 struct aivdm_sentence_opts_t *opts,
+			 struct aivdm_ring_t *sentences)
+{
+	struct aivdm_sentence_opts_t defaults, saved;
+	char text[AIVDM_MAX_FRAGMENTS * AIVDM_SENTENCE_MAX];
+	size_t lens[AIVDM_MAX_FRAGMENTS], len, off, n = 0;
+	const struct ais_t *ais;
+	int nfrags, i;
+	void *p;
+
+	if (opts == NULL) {
+		aivdm_sentence_opts_init(&defaults);
+		opts = &defaults;
+	}
+	while ((ais = (const struct ais_t *)aivdm_ring_peek(records, &len))
+			!= NULL) {
+		saved = *opts;
+		nfrags = 0;
+		if (len == sizeof(*ais))
+			nfrags = aivdm_encode_sentences(ais, opts, text, sizeof(text),
+							lens, AIVDM_MAX_FRAGMENTS);
+		if (nfrags > 0 && !ring_fits(sentences, lens, nfrags)) {
+			*opts = saved;	/* sent again next time */
+			break;
+		}
+		for (off = 0, i = 0; i < nfrags; off += lens[i++]) {
+			p = aivdm_ring_reserve(sentences, lens[i]);
+			(void)memcpy(p, text + off, lens[i]);
+			aivdm_ring_produce(sentences, lens[i]);
+		}
+		aivdm_ring_consume(records);
+		n++;
+	}
+	if (n > 0) {
+		aivdm_ring_release(records);
+		aivdm_ring_publish(sentences);
+	}
+	return n;
+}
+
+#undef SKIP
+#undef ROUND8
+#undef RECORD_HEADER
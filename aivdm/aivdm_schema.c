@@ -0,0 +1,201 @@
+/* aivdm_schema.c - tables expanded from the message layouts in aivdm_schema.h
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <stddef.h>
+
+#include "aivdm.h"
+
+#define AIS_DESC(arm, member, start, width, kind) \
+	{#member, start, width, AIS_KIND_##kind, \
+	 (unsigned short)offsetof(struct ais_t, AIS_ARM_##arm.member)},
+#define AIS_DESC_UINT(arm, member, start, width)	AIS_DESC(arm, member, start, width, UINT)
+#define AIS_DESC_SINT(arm, member, start, width)	AIS_DESC(arm, member, start, width, SINT)
+#define AIS_DESC_FLAG(arm, member, start, width)	AIS_DESC(arm, member, start, width, FLAG)
+#define AIS_DESC_TEXT(arm, member, start, width)	AIS_DESC(arm, member, start, width, TEXT)
+#define AIS_DESC_SPARE(arm, member, start, width)
+#define AIS_FIELD_DESC(arm, member, start, width, kind) \
+	AIS_DESC_##kind(arm, member, start, width)
+
+const struct aivdm_field_t aivdm_fields[AIS_FIELD_COUNT] = {
+	{"type", 0, 6, AIS_KIND_UINT, (unsigned short)offsetof(struct ais_t, type)},
+	{"repeat", 6, 2, AIS_KIND_UINT, (unsigned short)offsetof(struct ais_t, repeat)},
+	{"mmsi", 8, 30, AIS_KIND_UINT, (unsigned short)offsetof(struct ais_t, mmsi)},
+	AIS_ALL_FIELDS(AIS_FIELD_DESC)
+	{"payload", 0, 0, AIS_KIND_SPARE, 0},	/* position varies by type */
+};
+
+/*
+ * Compile-time checks that the rows of each layout add up to the
+ * message lengths of ITU-R M.1371; a mistyped width breaks the build.
+ */
+#define AIS_LAYOUT_CHECK(name, bits) \
+	typedef char ais_layout_check_##name[(bits) ? 1 : -1]
+
+AIS_LAYOUT_CHECK(type1, 38 + AIS_FIELDS_BITS(AIS_TYPE1_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type4, 38 + AIS_FIELDS_BITS(AIS_TYPE4_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type5, 38 + AIS_FIELDS_BITS(AIS_TYPE5_FIELDS) == 424);
+AIS_LAYOUT_CHECK(type6, 38 + AIS_FIELDS_BITS(AIS_TYPE6_FIELDS) == 88);
+AIS_LAYOUT_CHECK(type7, 38 + AIS_FIELDS_BITS(AIS_TYPE7_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE7_ACK2_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE7_ACK3_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE7_ACK4_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type8, 38 + AIS_FIELDS_BITS(AIS_TYPE8_FIELDS) == 56);
+AIS_LAYOUT_CHECK(type9, 38 + AIS_FIELDS_BITS(AIS_TYPE9_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type10, 38 + AIS_FIELDS_BITS(AIS_TYPE10_FIELDS) == 72);
+AIS_LAYOUT_CHECK(type12, 38 + AIS_FIELDS_BITS(AIS_TYPE12_FIELDS) == 72);
+AIS_LAYOUT_CHECK(type14, 38 + AIS_FIELDS_BITS(AIS_TYPE14_FIELDS) == 40);
+AIS_LAYOUT_CHECK(type15, 38 + AIS_FIELDS_BITS(AIS_TYPE15_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE15_REQ2_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE15_STATION2_FIELDS) == 160);
+AIS_LAYOUT_CHECK(type16a, 38 + AIS_FIELDS_BITS(AIS_TYPE16_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE16_PAD_FIELDS) == 96);
+AIS_LAYOUT_CHECK(type16b, 38 + AIS_FIELDS_BITS(AIS_TYPE16_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE16_STATION2_FIELDS) == 144);
+AIS_LAYOUT_CHECK(type17, 38 + AIS_FIELDS_BITS(AIS_TYPE17_FIELDS) == 80);
+AIS_LAYOUT_CHECK(type18, 38 + AIS_FIELDS_BITS(AIS_TYPE18_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type19, 38 + AIS_FIELDS_BITS(AIS_TYPE19_FIELDS) == 312);
+AIS_LAYOUT_CHECK(type20, 38 + AIS_FIELDS_BITS(AIS_TYPE20_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE20_BLOCK2_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE20_BLOCK3_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE20_BLOCK4_FIELDS) == 160);
+AIS_LAYOUT_CHECK(type21, 38 + AIS_FIELDS_BITS(AIS_TYPE21_FIELDS) == 272);
+AIS_LAYOUT_CHECK(type22a, 38 + AIS_FIELDS_BITS(AIS_TYPE22_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE22_AREA_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE22_TAIL_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type22b, 38 + AIS_FIELDS_BITS(AIS_TYPE22_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE22_DEST_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE22_TAIL_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type23, 38 + AIS_FIELDS_BITS(AIS_TYPE23_FIELDS) == 160);
+AIS_LAYOUT_CHECK(type24a, 38 + AIS_FIELDS_BITS(AIS_TYPE24_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE24A_FIELDS) == 160);
+AIS_LAYOUT_CHECK(type24b, 38 + AIS_FIELDS_BITS(AIS_TYPE24_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE24B_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE24B_DIM_FIELDS)
+		 + AIS_FIELDS_BITS(AIS_TYPE24B_TAIL_FIELDS) == 168);
+AIS_LAYOUT_CHECK(type24c, AIS_FIELDS_BITS(AIS_TYPE24B_DIM_FIELDS)
+		 == AIS_FIELDS_BITS(AIS_TYPE24B_MOTHERSHIP_FIELDS));
+AIS_LAYOUT_CHECK(type27, 38 + AIS_FIELDS_BITS(AIS_TYPE27_FIELDS) == 96);
+
+/* field id lists of each layout */
+#define AIS_ROWS(name, lists) \
+	static const unsigned short rows_##name[] = {lists AIS_FIELD_COUNT}
+#define ID	AIS_FIELD_ID
+
+AIS_ROWS(type1, AIS_TYPE1_FIELDS(ID));
+AIS_ROWS(type4, AIS_TYPE4_FIELDS(ID));
+AIS_ROWS(type5, AIS_TYPE5_FIELDS(ID));
+AIS_ROWS(type6, AIS_TYPE6_FIELDS(ID));
+AIS_ROWS(type7, AIS_TYPE7_FIELDS(ID) AIS_TYPE7_ACK2_FIELDS(ID)
+	 AIS_TYPE7_ACK3_FIELDS(ID) AIS_TYPE7_ACK4_FIELDS(ID));
+AIS_ROWS(type8, AIS_TYPE8_FIELDS(ID));
+AIS_ROWS(type9, AIS_TYPE9_FIELDS(ID));
+AIS_ROWS(type10, AIS_TYPE10_FIELDS(ID));
+AIS_ROWS(type12, AIS_TYPE12_FIELDS(ID));
+AIS_ROWS(type14, AIS_TYPE14_FIELDS(ID));
+AIS_ROWS(type15, AIS_TYPE15_FIELDS(ID) AIS_TYPE15_REQ2_FIELDS(ID)
+	 AIS_TYPE15_STATION2_FIELDS(ID));
+AIS_ROWS(type16, AIS_TYPE16_FIELDS(ID) AIS_TYPE16_STATION2_FIELDS(ID));
+AIS_ROWS(type17, AIS_TYPE17_FIELDS(ID));
+AIS_ROWS(type18, AIS_TYPE18_FIELDS(ID));
+AIS_ROWS(type19, AIS_TYPE19_FIELDS(ID));
+AIS_ROWS(type20, AIS_TYPE20_FIELDS(ID) AIS_TYPE20_BLOCK2_FIELDS(ID)
+	 AIS_TYPE20_BLOCK3_FIELDS(ID) AIS_TYPE20_BLOCK4_FIELDS(ID));
+AIS_ROWS(type21, AIS_TYPE21_FIELDS(ID));
+AIS_ROWS(type22, AIS_TYPE22_FIELDS(ID) AIS_TYPE22_TAIL_FIELDS(ID));
+AIS_ROWS(type22_area, AIS_TYPE22_AREA_FIELDS(ID));
+AIS_ROWS(type22_dest, AIS_TYPE22_DEST_FIELDS(ID));
+AIS_ROWS(type23, AIS_TYPE23_FIELDS(ID));
+AIS_ROWS(type24, AIS_TYPE24_FIELDS(ID));
+AIS_ROWS(type24a, AIS_TYPE24A_FIELDS(ID));
+/* an auxiliary craft's mothership MMSI sits where the dimensions do */
+AIS_ROWS(type24b, AIS_TYPE24B_FIELDS(ID) AIS_TYPE24B_DIM_FIELDS(ID));
+AIS_ROWS(type25, AIS_TYPE25_FIELDS(ID));
+AIS_ROWS(type25_dest, AIS_TYPE25_DEST_FIELDS(ID));
+AIS_ROWS(type26, AIS_TYPE26_FIELDS(ID));
+AIS_ROWS(type26_dest, AIS_TYPE26_DEST_FIELDS(ID));
+AIS_ROWS(type27, AIS_TYPE27_FIELDS(ID));
+
+#undef ID
+#undef AIS_ROWS
+
+#define AIS_LAYOUT(name)	{rows_##name, 0, 0, 0}
+#define AIS_LAYOUT_IF(name, start, width, value)	{rows_##name, start, width, value}
+#define AIS_LAYOUT_END		{NULL, 0, 0, 0}
+
+static const struct aivdm_layout_t layouts_type1[] = {AIS_LAYOUT(type1), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type4[] = {AIS_LAYOUT(type4), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type5[] = {AIS_LAYOUT(type5), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type6[] = {AIS_LAYOUT(type6), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type7[] = {AIS_LAYOUT(type7), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type8[] = {AIS_LAYOUT(type8), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type9[] = {AIS_LAYOUT(type9), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type10[] = {AIS_LAYOUT(type10), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type12[] = {AIS_LAYOUT(type12), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type14[] = {AIS_LAYOUT(type14), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type15[] = {AIS_LAYOUT(type15), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type16[] = {AIS_LAYOUT(type16), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type17[] = {AIS_LAYOUT(type17), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type18[] = {AIS_LAYOUT(type18), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type19[] = {AIS_LAYOUT(type19), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type20[] = {AIS_LAYOUT(type20), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type21[] = {AIS_LAYOUT(type21), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type22[] = {
+	AIS_LAYOUT(type22),
+	AIS_LAYOUT_IF(type22_area, 139, 1, 0),	/* broadcast: a region */
+	AIS_LAYOUT_IF(type22_dest, 139, 1, 1),	/* addressed: two stations */
+	AIS_LAYOUT_END
+};
+static const struct aivdm_layout_t layouts_type23[] = {AIS_LAYOUT(type23), AIS_LAYOUT_END};
+static const struct aivdm_layout_t layouts_type24[] = {
+	AIS_LAYOUT(type24),
+	AIS_LAYOUT_IF(type24a, 38, 2, AIS_TYPE24_PART_A),
+	AIS_LAYOUT_IF(type24b, 38, 2, AIS_TYPE24_PART_B),
+	AIS_LAYOUT_END
+};
+static const struct aivdm_layout_t layouts_type25[] = {
+	AIS_LAYOUT(type25),
+	AIS_LAYOUT_IF(type25_dest, 38, 1, 1),
+	AIS_LAYOUT_END
+};
+static const struct aivdm_layout_t layouts_type26[] = {
+	AIS_LAYOUT(type26),
+	AIS_LAYOUT_IF(type26_dest, 38, 1, 1),
+	AIS_LAYOUT_END
+};
+static const struct aivdm_layout_t layouts_type27[] = {AIS_LAYOUT(type27), AIS_LAYOUT_END};
+
+#undef AIS_LAYOUT_END
+#undef AIS_LAYOUT_IF
+#undef AIS_LAYOUT
+
+const struct aivdm_layout_t *const aivdm_layouts[28] = {
+	NULL,
+	layouts_type1, layouts_type1, layouts_type1,
+	layouts_type4, layouts_type5, layouts_type6,
+	layouts_type7, layouts_type8, layouts_type9,
+	layouts_type10, layouts_type4, layouts_type12,
+	layouts_type7, layouts_type14, layouts_type15,
+	layouts_type16, layouts_type17, layouts_type18,
+	layouts_type19, layouts_type20, layouts_type21,
+	layouts_type22, layouts_type23, layouts_type24,
+	layouts_type25, layouts_type26, layouts_type27,
+};
+
+static const struct {
+	unsigned short min, max;
+} ais_message_bits[28] = {
+	{0, 0},
+#define AIS_BITS_ENTRY(type, min, max)	{min, max},
+	AIS_MESSAGE_BITS(AIS_BITS_ENTRY)
+#undef AIS_BITS_ENTRY
+};
+
+int aivdm_bitlen_ok(unsigned int type, size_t bitlen)
+{
+	if (type == 0 || type >= sizeof(ais_message_bits) / sizeof(ais_message_bits[0]))
+		return 0;
+	return bitlen >= ais_message_bits[type].min
+	    && bitlen <= ais_message_bits[type].max;
+}
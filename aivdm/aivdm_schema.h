@@ -0,0 +1,610 @@
+/*
+ * aivdm_schema.h - the AIS message bit layouts, written down once
+ *
+ * Every fixed-position field of every message type is one row here:
+ *
+ *	X(arm, member, start, width, kind)
+ *
+ * arm names the struct ais_t union member (nested ones through the
+ * AIS_ARM_* aliases below), start is the bit offset from the start of
+ * the payload, width is in bits, or in characters for TEXT rows.  The
+ * decoder, the encoder, the field id enum and the field descriptor
+ * table are all expanded from these lists, so a layout can no longer
+ * be right in one place and wrong in another.
+ *
+ * Rows must be listed in transmission order and without gaps, spares
+ * included: the encoder emits them one after the other.  Parts of a
+ * message that are present or not depending on its length or on a flag
+ * get their own list; what cannot be expressed as fixed rows (binary
+ * payloads, free text, the type 21 name extension) stays hand-written.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_AIVDM_SCHEMA_H_
+#define _GPSD_AIVDM_SCHEMA_H_
+
+/* field kinds */
+#define AIS_KIND_UINT	0	/* unsigned integer */
+#define AIS_KIND_SINT	1	/* two's complement integer */
+#define AIS_KIND_FLAG	2	/* one-bit boolean, stored as int */
+#define AIS_KIND_TEXT	3	/* six-bit characters, width counts characters */
+#define AIS_KIND_SPARE	4	/* reserved, zero on transmit, not stored */
+
+/* bits a row occupies */
+#define AIS_ROW_BITS_UINT(width)	(width)
+#define AIS_ROW_BITS_SINT(width)	(width)
+#define AIS_ROW_BITS_FLAG(width)	(width)
+#define AIS_ROW_BITS_TEXT(width)	((width) * 6)
+#define AIS_ROW_BITS_SPARE(width)	(width)
+
+/* arm tokens to member paths in struct ais_t */
+#define AIS_ARM_type1		type1
+#define AIS_ARM_type4		type4
+#define AIS_ARM_type5		type5
+#define AIS_ARM_type6		type6
+#define AIS_ARM_type7		type7
+#define AIS_ARM_type8		type8
+#define AIS_ARM_type9		type9
+#define AIS_ARM_type10		type10
+#define AIS_ARM_type12		type12
+#define AIS_ARM_type14		type14
+#define AIS_ARM_type15		type15
+#define AIS_ARM_type16		type16
+#define AIS_ARM_type17		type17
+#define AIS_ARM_type18		type18
+#define AIS_ARM_type19		type19
+#define AIS_ARM_type20		type20
+#define AIS_ARM_type21		type21
+#define AIS_ARM_type22		type22
+#define AIS_ARM_type22_area	type22.area
+#define AIS_ARM_type22_mmsi	type22.mmsi
+#define AIS_ARM_type23		type23
+#define AIS_ARM_type24		type24
+#define AIS_ARM_type24_dim	type24.dim
+#define AIS_ARM_type25		type25
+#define AIS_ARM_type26		type26
+#define AIS_ARM_type27		type27
+
+/* Types 1, 2, 3 - Position Report Class A */
+#define AIS_TYPE1_FIELDS(X) \
+	X(type1, status,	38,	4,	UINT) \
+	X(type1, turn,		42,	8,	SINT) \
+	X(type1, speed,		50,	10,	UINT) \
+	X(type1, accuracy,	60,	1,	FLAG) \
+	X(type1, lon,		61,	28,	SINT) \
+	X(type1, lat,		89,	27,	SINT) \
+	X(type1, course,	116,	12,	UINT) \
+	X(type1, heading,	128,	9,	UINT) \
+	X(type1, second,	137,	6,	UINT) \
+	X(type1, maneuver,	143,	2,	UINT) \
+	X(type1, spare,		145,	3,	SPARE) \
+	X(type1, raim,		148,	1,	FLAG) \
+	X(type1, radio,		149,	19,	UINT)
+
+/* Types 4, 11 - Base Station Report, UTC/Date Response */
+#define AIS_TYPE4_FIELDS(X) \
+	X(type4, year,		38,	14,	UINT) \
+	X(type4, month,		52,	4,	UINT) \
+	X(type4, day,		56,	5,	UINT) \
+	X(type4, hour,		61,	5,	UINT) \
+	X(type4, minute,	66,	6,	UINT) \
+	X(type4, second,	72,	6,	UINT) \
+	X(type4, accuracy,	78,	1,	FLAG) \
+	X(type4, lon,		79,	28,	SINT) \
+	X(type4, lat,		107,	27,	SINT) \
+	X(type4, epfd,		134,	4,	UINT) \
+	X(type4, spare,		138,	10,	SPARE) \
+	X(type4, raim,		148,	1,	FLAG) \
+	X(type4, radio,		149,	19,	UINT)
+
+/* Type 5 - Ship static and voyage related data */
+#define AIS_TYPE5_FIELDS(X) \
+	X(type5, ais_version,	38,	2,	UINT) \
+	X(type5, imo,		40,	30,	UINT) \
+	X(type5, callsign,	70,	7,	TEXT) \
+	X(type5, shipname,	112,	20,	TEXT) \
+	X(type5, shiptype,	232,	8,	UINT) \
+	X(type5, to_bow,	240,	9,	UINT) \
+	X(type5, to_stern,	249,	9,	UINT) \
+	X(type5, to_port,	258,	6,	UINT) \
+	X(type5, to_starboard,	264,	6,	UINT) \
+	X(type5, epfd,		270,	4,	UINT) \
+	X(type5, month,		274,	4,	UINT) \
+	X(type5, day,		278,	5,	UINT) \
+	X(type5, hour,		283,	5,	UINT) \
+	X(type5, minute,	288,	6,	UINT) \
+	X(type5, draught,	294,	8,	UINT) \
+	X(type5, destination,	302,	20,	TEXT) \
+	X(type5, dte,		422,	1,	UINT) \
+	X(type5, spare,		423,	1,	SPARE)
+
+/* Type 6 - Addressed Binary Message, payload follows */
+#define AIS_TYPE6_FIELDS(X) \
+	X(type6, seqno,		38,	2,	UINT) \
+	X(type6, dest_mmsi,	40,	30,	UINT) \
+	X(type6, retransmit,	70,	1,	FLAG) \
+	X(type6, spare,		71,	1,	SPARE) \
+	X(type6, app_id,	72,	16,	UINT)
+
+/* Types 7, 13 - Binary and Safety Related Acknowledge, 1 to 4 stations */
+#define AIS_TYPE7_FIELDS(X) \
+	X(type7, spare,		38,	2,	SPARE) \
+	X(type7, mmsi1,		40,	30,	UINT) \
+	X(type7, spare,		70,	2,	SPARE)
+#define AIS_TYPE7_ACK2_FIELDS(X) \
+	X(type7, mmsi2,		72,	30,	UINT) \
+	X(type7, spare,		102,	2,	SPARE)
+#define AIS_TYPE7_ACK3_FIELDS(X) \
+	X(type7, mmsi3,		104,	30,	UINT) \
+	X(type7, spare,		134,	2,	SPARE)
+#define AIS_TYPE7_ACK4_FIELDS(X) \
+	X(type7, mmsi4,		136,	30,	UINT) \
+	X(type7, spare,		166,	2,	SPARE)
+
+/* Type 8 - Binary Broadcast Message, payload follows */
+#define AIS_TYPE8_FIELDS(X) \
+	X(type8, spare,		38,	2,	SPARE) \
+	X(type8, app_id,	40,	16,	UINT)
+
+/* Type 9 - Standard SAR Aircraft Position Report */
+#define AIS_TYPE9_FIELDS(X) \
+	X(type9, alt,		38,	12,	UINT) \
+	X(type9, speed,		50,	10,	UINT) \
+	X(type9, accuracy,	60,	1,	FLAG) \
+	X(type9, lon,		61,	28,	SINT) \
+	X(type9, lat,		89,	27,	SINT) \
+	X(type9, course,	116,	12,	UINT) \
+	X(type9, second,	128,	6,	UINT) \
+	X(type9, regional,	134,	8,	UINT) \
+	X(type9, dte,		142,	1,	UINT) \
+	X(type9, spare,		143,	3,	SPARE) \
+	X(type9, assigned,	146,	1,	FLAG) \
+	X(type9, raim,		147,	1,	FLAG) \
+	X(type9, radio,		148,	20,	UINT)
+
+/* Type 10 - UTC/Date Inquiry */
+#define AIS_TYPE10_FIELDS(X) \
+	X(type10, spare,	38,	2,	SPARE) \
+	X(type10, dest_mmsi,	40,	30,	UINT) \
+	X(type10, spare,	70,	2,	SPARE)
+
+/* Type 12 - Safety Related Message, text follows */
+#define AIS_TYPE12_FIELDS(X) \
+	X(type12, seqno,	38,	2,	UINT) \
+	X(type12, dest_mmsi,	40,	30,	UINT) \
+	X(type12, retransmit,	70,	1,	FLAG) \
+	X(type12, spare,	71,	1,	SPARE)
+
+/* Type 14 - Safety Related Broadcast Message, text follows */
+#define AIS_TYPE14_FIELDS(X) \
+	X(type14, spare,	38,	2,	SPARE)
+
+/* Type 15 - Interrogation, with an optional second request and station */
+#define AIS_TYPE15_FIELDS(X) \
+	X(type15, spare,	38,	2,	SPARE) \
+	X(type15, mmsi1,	40,	30,	UINT) \
+	X(type15, type1_1,	70,	6,	UINT) \
+	X(type15, offset1_1,	76,	12,	UINT)
+#define AIS_TYPE15_REQ2_FIELDS(X) \
+	X(type15, spare,	88,	2,	SPARE) \
+	X(type15, type1_2,	90,	6,	UINT) \
+	X(type15, offset1_2,	96,	12,	UINT) \
+	X(type15, spare,	108,	2,	SPARE)
+#define AIS_TYPE15_STATION2_FIELDS(X) \
+	X(type15, mmsi2,	110,	30,	UINT) \
+	X(type15, type2_1,	140,	6,	UINT) \
+	X(type15, offset2_1,	146,	12,	UINT) \
+	X(type15, spare,	158,	2,	SPARE)
+
+/* Type 16 - Assigned Mode Command, one or two stations */
+#define AIS_TYPE16_FIELDS(X) \
+	X(type16, spare,	38,	2,	SPARE) \
+	X(type16, mmsi1,	40,	30,	UINT) \
+	X(type16, offset1,	70,	12,	UINT) \
+	X(type16, increment1,	82,	10,	UINT)
+#define AIS_TYPE16_STATION2_FIELDS(X) \
+	X(type16, mmsi2,	92,	30,	UINT) \
+	X(type16, offset2,	122,	12,	UINT) \
+	X(type16, increment2,	134,	10,	UINT)
+#define AIS_TYPE16_PAD_FIELDS(X) \
+	X(type16, spare,	92,	4,	SPARE)
+
+/* Type 17 - GNSS Broadcast Binary Message, payload follows */
+#define AIS_TYPE17_FIELDS(X) \
+	X(type17, spare,	38,	2,	SPARE) \
+	X(type17, lon,		40,	18,	SINT) \
+	X(type17, lat,		58,	17,	SINT) \
+	X(type17, spare,	75,	5,	SPARE)
+
+/* Type 18 - Standard Class B CS Position Report */
+#define AIS_TYPE18_FIELDS(X) \
+	X(type18, reserved,	38,	8,	UINT) \
+	X(type18, speed,	46,	10,	UINT) \
+	X(type18, accuracy,	56,	1,	FLAG) \
+	X(type18, lon,		57,	28,	SINT) \
+	X(type18, lat,		85,	27,	SINT) \
+	X(type18, course,	112,	12,	UINT) \
+	X(type18, heading,	124,	9,	UINT) \
+	X(type18, second,	133,	6,	UINT) \
+	X(type18, regional,	139,	2,	UINT) \
+	X(type18, cs,		141,	1,	FLAG) \
+	X(type18, display,	142,	1,	FLAG) \
+	X(type18, dsc,		143,	1,	FLAG) \
+	X(type18, band,		144,	1,	FLAG) \
+	X(type18, msg22,	145,	1,	FLAG) \
+	X(type18, assigned,	146,	1,	FLAG) \
+	X(type18, raim,		147,	1,	FLAG) \
+	X(type18, radio,	148,	20,	UINT)
+
+/* Type 19 - Extended Class B CS Position Report */
+#define AIS_TYPE19_FIELDS(X) \
+	X(type19, reserved,	38,	8,	UINT) \
+	X(type19, speed,	46,	10,	UINT) \
+	X(type19, accuracy,	56,	1,	FLAG) \
+	X(type19, lon,		57,	28,	SINT) \
+	X(type19, lat,		85,	27,	SINT) \
+	X(type19, course,	112,	12,	UINT) \
+	X(type19, heading,	124,	9,	UINT) \
+	X(type19, second,	133,	6,	UINT) \
+	X(type19, regional,	139,	4,	UINT) \
+	X(type19, shipname,	143,	20,	TEXT) \
+	X(type19, shiptype,	263,	8,	UINT) \
+	X(type19, to_bow,	271,	9,	UINT) \
+	X(type19, to_stern,	280,	9,	UINT) \
+	X(type19, to_port,	289,	6,	UINT) \
+	X(type19, to_starboard,	295,	6,	UINT) \
+	X(type19, epfd,		301,	4,	UINT) \
+	X(type19, raim,		305,	1,	FLAG) \
+	X(type19, dte,		306,	1,	UINT) \
+	X(type19, assigned,	307,	1,	FLAG) \
+	X(type19, spare,	308,	4,	SPARE)
+
+/* Type 20 - Data Link Management Message, 1 to 4 reservation blocks */
+#define AIS_TYPE20_FIELDS(X) \
+	X(type20, spare,	38,	2,	SPARE) \
+	X(type20, offset1,	40,	12,	UINT) \
+	X(type20, number1,	52,	4,	UINT) \
+	X(type20, timeout1,	56,	3,	UINT) \
+	X(type20, increment1,	59,	11,	UINT)
+#define AIS_TYPE20_BLOCK2_FIELDS(X) \
+	X(type20, offset2,	70,	12,	UINT) \
+	X(type20, number2,	82,	4,	UINT) \
+	X(type20, timeout2,	86,	3,	UINT) \
+	X(type20, increment2,	89,	11,	UINT)
+#define AIS_TYPE20_BLOCK3_FIELDS(X) \
+	X(type20, offset3,	100,	12,	UINT) \
+	X(type20, number3,	112,	4,	UINT) \
+	X(type20, timeout3,	116,	3,	UINT) \
+	X(type20, increment3,	119,	11,	UINT)
+#define AIS_TYPE20_BLOCK4_FIELDS(X) \
+	X(type20, offset4,	130,	12,	UINT) \
+	X(type20, number4,	142,	4,	UINT) \
+	X(type20, timeout4,	146,	3,	UINT) \
+	X(type20, increment4,	149,	11,	UINT)
+
+/* Type 21 - Aid-to-Navigation Report, optional name extension follows */
+#define AIS_TYPE21_FIELDS(X) \
+	X(type21, aid_type,	38,	5,	UINT) \
+	X(type21, name,		43,	20,	TEXT) \
+	X(type21, accuracy,	163,	1,	FLAG) \
+	X(type21, lon,		164,	28,	SINT) \
+	X(type21, lat,		192,	27,	SINT) \
+	X(type21, to_bow,	219,	9,	UINT) \
+	X(type21, to_stern,	228,	9,	UINT) \
+	X(type21, to_port,	237,	6,	UINT) \
+	X(type21, to_starboard,	243,	6,	UINT) \
+	X(type21, epfd,		249,	4,	UINT) \
+	X(type21, second,	253,	6,	UINT) \
+	X(type21, off_position,	259,	1,	FLAG) \
+	X(type21, regional,	260,	8,	UINT) \
+	X(type21, raim,		268,	1,	FLAG) \
+	X(type21, virtual_aid,	269,	1,	FLAG) \
+	X(type21, assigned,	270,	1,	FLAG) \
+	X(type21, spare,	271,	1,	SPARE)
+
+/* Type 22 - Channel Management, area or addressed form */
+#define AIS_TYPE22_FIELDS(X) \
+	X(type22, spare,	38,	2,	SPARE) \
+	X(type22, channel_a,	40,	12,	UINT) \
+	X(type22, channel_b,	52,	12,	UINT) \
+	X(type22, txrx,		64,	4,	UINT) \
+	X(type22, power,	68,	1,	FLAG)
+#define AIS_TYPE22_AREA_FIELDS(X) \
+	X(type22_area, ne_lon,	69,	18,	SINT) \
+	X(type22_area, ne_lat,	87,	17,	SINT) \
+	X(type22_area, sw_lon,	104,	18,	SINT) \
+	X(type22_area, sw_lat,	122,	17,	SINT)
+#define AIS_TYPE22_DEST_FIELDS(X) \
+	X(type22_mmsi, dest1,	69,	30,	UINT) \
+	X(type22_mmsi, spare,	99,	5,	SPARE) \
+	X(type22_mmsi, dest2,	104,	30,	UINT) \
+	X(type22_mmsi, spare,	134,	5,	SPARE)
+#define AIS_TYPE22_TAIL_FIELDS(X) \
+	X(type22, addressed,	139,	1,	FLAG) \
+	X(type22, band_a,	140,	1,	FLAG) \
+	X(type22, band_b,	141,	1,	FLAG) \
+	X(type22, zonesize,	142,	3,	UINT) \
+	X(type22, spare,	145,	23,	SPARE)
+
+/* Type 23 - Group Assignment Command */
+#define AIS_TYPE23_FIELDS(X) \
+	X(type23, spare,	38,	2,	SPARE) \
+	X(type23, ne_lon,	40,	18,	SINT) \
+	X(type23, ne_lat,	58,	17,	SINT) \
+	X(type23, sw_lon,	75,	18,	SINT) \
+	X(type23, sw_lat,	93,	17,	SINT) \
+	X(type23, stationtype,	110,	4,	UINT) \
+	X(type23, shiptype,	114,	8,	UINT) \
+	X(type23, spare,	122,	22,	SPARE) \
+	X(type23, txrx,		144,	2,	UINT) \
+	X(type23, interval,	146,	4,	UINT) \
+	X(type23, quiet,	150,	4,	UINT) \
+	X(type23, spare,	154,	6,	SPARE)
+
+/* Type 24 - Class B CS Static Data Report, part A or part B */
+#define AIS_TYPE24_FIELDS(X) \
+	X(type24, part,		38,	2,	UINT)
+#define AIS_TYPE24A_FIELDS(X) \
+	X(type24, shipname,	40,	20,	TEXT)
+#define AIS_TYPE24B_FIELDS(X) \
+	X(type24, shiptype,	40,	8,	UINT) \
+	X(type24, vendorid,	48,	7,	TEXT) \
+	X(type24, callsign,	90,	7,	TEXT)
+#define AIS_TYPE24B_DIM_FIELDS(X) \
+	X(type24_dim, to_bow,	132,	9,	UINT) \
+	X(type24_dim, to_stern,	141,	9,	UINT) \
+	X(type24_dim, to_port,	150,	6,	UINT) \
+	X(type24_dim, to_starboard,	156,	6,	UINT)
+#define AIS_TYPE24B_MOTHERSHIP_FIELDS(X) \
+	X(type24, mothership_mmsi,	132,	30,	UINT)
+#define AIS_TYPE24B_TAIL_FIELDS(X) \
+	X(type24, spare,	162,	6,	SPARE)
+
+/*
+ * Types 25, 26 - Single and Multiple Slot Binary Message.  Destination
+ * and application id are present only when flagged; the application id
+ * moves 30 bits down when a destination precedes it, and the type 26
+ * radio status is the last 20 bits whatever the payload length.  Those
+ * starts are relative, the decoder adds the displacement.
+ */
+#define AIS_TYPE25_FIELDS(X) \
+	X(type25, addressed,	38,	1,	FLAG) \
+	X(type25, structured,	39,	1,	FLAG)
+#define AIS_TYPE25_DEST_FIELDS(X) \
+	X(type25, dest_mmsi,	40,	30,	UINT)
+#define AIS_TYPE25_APP_FIELDS(X) \
+	X(type25, app_id,	40,	16,	UINT)
+#define AIS_TYPE26_FIELDS(X) \
+	X(type26, addressed,	38,	1,	FLAG) \
+	X(type26, structured,	39,	1,	FLAG)
+#define AIS_TYPE26_DEST_FIELDS(X) \
+	X(type26, dest_mmsi,	40,	30,	UINT)
+#define AIS_TYPE26_APP_FIELDS(X) \
+	X(type26, app_id,	40,	16,	UINT)
+#define AIS_TYPE26_RADIO_FIELDS(X) \
+	X(type26, radio,	0,	20,	UINT)
+
+/* Type 27 - Long Range AIS Broadcast message */
+#define AIS_TYPE27_FIELDS(X) \
+	X(type27, accuracy,	38,	1,	FLAG) \
+	X(type27, raim,		39,	1,	FLAG) \
+	X(type27, status,	40,	4,	UINT) \
+	X(type27, lon,		44,	18,	SINT) \
+	X(type27, lat,		62,	17,	SINT) \
+	X(type27, speed,	79,	6,	UINT) \
+	X(type27, course,	85,	9,	UINT) \
+	X(type27, gnss,		94,	1,	FLAG) \
+	X(type27, spare,	95,	1,	SPARE)
+
+/* every list above, for expansions that want all rows */
+#define AIS_ALL_FIELDS(X) \
+	AIS_TYPE1_FIELDS(X) AIS_TYPE4_FIELDS(X) AIS_TYPE5_FIELDS(X) \
+	AIS_TYPE6_FIELDS(X) AIS_TYPE7_FIELDS(X) AIS_TYPE7_ACK2_FIELDS(X) \
+	AIS_TYPE7_ACK3_FIELDS(X) AIS_TYPE7_ACK4_FIELDS(X) AIS_TYPE8_FIELDS(X) \
+	AIS_TYPE9_FIELDS(X) AIS_TYPE10_FIELDS(X) AIS_TYPE12_FIELDS(X) \
+	AIS_TYPE14_FIELDS(X) AIS_TYPE15_FIELDS(X) AIS_TYPE15_REQ2_FIELDS(X) \
+	AIS_TYPE15_STATION2_FIELDS(X) AIS_TYPE16_FIELDS(X) \
+	AIS_TYPE16_STATION2_FIELDS(X) AIS_TYPE16_PAD_FIELDS(X) \
+	AIS_TYPE17_FIELDS(X) AIS_TYPE18_FIELDS(X) AIS_TYPE19_FIELDS(X) \
+	AIS_TYPE20_FIELDS(X) AIS_TYPE20_BLOCK2_FIELDS(X) \
+	AIS_TYPE20_BLOCK3_FIELDS(X) AIS_TYPE20_BLOCK4_FIELDS(X) \
+	AIS_TYPE21_FIELDS(X) AIS_TYPE22_FIELDS(X) AIS_TYPE22_AREA_FIELDS(X) \
+	AIS_TYPE22_DEST_FIELDS(X) AIS_TYPE22_TAIL_FIELDS(X) \
+	AIS_TYPE23_FIELDS(X) AIS_TYPE24_FIELDS(X) AIS_TYPE24A_FIELDS(X) \
+	AIS_TYPE24B_FIELDS(X) AIS_TYPE24B_DIM_FIELDS(X) \
+	AIS_TYPE24B_MOTHERSHIP_FIELDS(X) AIS_TYPE24B_TAIL_FIELDS(X) \
+	AIS_TYPE25_FIELDS(X) AIS_TYPE25_DEST_FIELDS(X) AIS_TYPE25_APP_FIELDS(X) \
+	AIS_TYPE26_FIELDS(X) AIS_TYPE26_DEST_FIELDS(X) AIS_TYPE26_APP_FIELDS(X) \
+	AIS_TYPE26_RADIO_FIELDS(X) AIS_TYPE27_FIELDS(X)
+
+/* bits covered by one list, as a constant expression */
+#define AIS_ROW_BITS(arm, member, start, width, kind)	+ AIS_ROW_BITS_##kind(width)
+#define AIS_FIELDS_BITS(list)	(0 list(AIS_ROW_BITS))
+
+/*
+ * Payload length limits in bits by message type: X(type, min, max).
+ * Layout-dependent checks (type 16 station count, type 24 part, the
+ * type 25 mode) are made by the decoder on top of these.
+ */
+#define AIS_MESSAGE_BITS(X) \
+	X(1, 168, 168)	X(2, 168, 168)	X(3, 168, 168) \
+	X(4, 168, 168)	X(5, 424, 424)	X(6, 88, 1008) \
+	X(7, 72, 168)	X(8, 56, 1008)	X(9, 168, 168) \
+	X(10, 72, 72)	X(11, 168, 168)	X(12, 72, 1008) \
+	X(13, 72, 168)	X(14, 40, 1008)	X(15, 88, 168) \
+	X(16, 96, 144)	X(17, 80, 816)	X(18, 168, 168) \
+	X(19, 312, 312)	X(20, 72, 160)	X(21, 272, 360) \
+	X(22, 168, 168)	X(23, 160, 160)	X(24, 160, 168) \
+	X(25, 40, 168)	X(26, 60, 1004)	X(27, 96, 96)
+
+/*
+ * Field ids: AIS_FIELD_<arm>_<member> for every stored row, after the
+ * three header fields common to all messages.
+ */
+#define AIS_FIELD_ID_UINT(arm, member)	AIS_FIELD_##arm##_##member,
+#define AIS_FIELD_ID_SINT(arm, member)	AIS_FIELD_##arm##_##member,
+#define AIS_FIELD_ID_FLAG(arm, member)	AIS_FIELD_##arm##_##member,
+#define AIS_FIELD_ID_TEXT(arm, member)	AIS_FIELD_##arm##_##member,
+#define AIS_FIELD_ID_SPARE(arm, member)
+#define AIS_FIELD_ID(arm, member, start, width, kind) \
+	AIS_FIELD_ID_##kind(arm, member)
+
+enum aivdm_field_id {
+	AIS_FIELD_type,
+	AIS_FIELD_repeat,
+	AIS_FIELD_mmsi,
+	AIS_ALL_FIELDS(AIS_FIELD_ID)
+	AIS_FIELD_PAYLOAD,	/* binary data or free text of the message */
+	AIS_FIELD_COUNT
+};
+
+/* run-time description of a field, indexed by enum aivdm_field_id */
+struct aivdm_field_t {
+	const char *name;	/* member name, e.g. "lon" */
+	unsigned short start;	/* bit offset in the payload */
+	unsigned char width;	/* bits, or characters for text */
+	unsigned char kind;	/* AIS_KIND_* */
+	unsigned short offset;	/* offsetof() the member in struct ais_t */
+};
+
+extern const struct aivdm_field_t aivdm_fields[AIS_FIELD_COUNT];
+
+/*
+ * Which rows make up each message type, for code that walks raw bits
+ * instead of going through the decoder.  A layout lists field ids and
+ * ends in AIS_FIELD_COUNT; the three header fields are implied.  When
+ * guard_width is nonzero the layout applies only if the guard_width
+ * bits at guard_start hold guard_value (type 22 addressing, type 24
+ * part, type 25/26 addressing).  Rows that run past the end of a
+ * shorter message are not present in it.  Rows placed by anything
+ * else (shifted type 25/26 application ids, the type 26 radio field)
+ * are left out.  Type 24 part B always lists the dimensions: the guard
+ * cannot test the MMSI, so an auxiliary craft's mothership MMSI is read
+ * as dimensions and mothership_mmsi is in no layout.
+ */
+struct aivdm_layout_t {
+	const unsigned short *fields;
+	unsigned short guard_start;
+	unsigned char guard_width;
+	unsigned char guard_value;
+};
+
+/* by message type, each a list of layouts ending in NULL fields */
+extern const struct aivdm_layout_t *const aivdm_layouts[28];
+
+/*
+ * Application-specific payloads of types 6 and 8 (IMO SN.1/Circ.289
+ * and regional DACs), decoded on demand by aivdm_app_decode().  Same
+ * row shape, but start counts from the first bit after the application
+ * id, wherever the carrying message puts it.
+ */
+
+/* DAC 1 FI 31 - Meteorological and Hydrographic data */
+#define AIS_APP_DAC1FI31_FIELDS(X) \
+	X(dac1fi31, lon,		0,	25,	SINT) \
+	X(dac1fi31, lat,		25,	24,	SINT) \
+	X(dac1fi31, accuracy,	49,	1,	FLAG) \
+	X(dac1fi31, day,		50,	5,	UINT) \
+	X(dac1fi31, hour,		55,	5,	UINT) \
+	X(dac1fi31, minute,	60,	6,	UINT) \
+	X(dac1fi31, wspeed,	66,	7,	UINT) \
+	X(dac1fi31, wgust,		73,	7,	UINT) \
+	X(dac1fi31, wdir,		80,	9,	UINT) \
+	X(dac1fi31, wgustdir,	89,	9,	UINT) \
+	X(dac1fi31, airtemp,	98,	11,	SINT) \
+	X(dac1fi31, humidity,	109,	7,	UINT) \
+	X(dac1fi31, dewpoint,	116,	10,	SINT) \
+	X(dac1fi31, pressure,	126,	9,	UINT) \
+	X(dac1fi31, pressuretend,	135,	2,	UINT) \
+	X(dac1fi31, visgreater,	137,	1,	FLAG) \
+	X(dac1fi31, visibility,	138,	7,	UINT) \
+	X(dac1fi31, waterlevel,	145,	12,	UINT) \
+	X(dac1fi31, leveltrend,	157,	2,	UINT) \
+	X(dac1fi31, cspeed,	159,	8,	UINT) \
+	X(dac1fi31, cdir,		167,	9,	UINT) \
+	X(dac1fi31, cspeed2,	176,	8,	UINT) \
+	X(dac1fi31, cdir2,		184,	9,	UINT) \
+	X(dac1fi31, cdepth2,	193,	5,	UINT) \
+	X(dac1fi31, cspeed3,	198,	8,	UINT) \
+	X(dac1fi31, cdir3,		206,	9,	UINT) \
+	X(dac1fi31, cdepth3,	215,	5,	UINT) \
+	X(dac1fi31, waveheight,	220,	8,	UINT) \
+	X(dac1fi31, waveperiod,	228,	6,	UINT) \
+	X(dac1fi31, wavedir,	234,	9,	UINT) \
+	X(dac1fi31, swellheight,	243,	8,	UINT) \
+	X(dac1fi31, swellperiod,	251,	6,	UINT) \
+	X(dac1fi31, swelldir,	257,	9,	UINT) \
+	X(dac1fi31, seastate,	266,	4,	UINT) \
+	X(dac1fi31, watertemp,	270,	10,	SINT) \
+	X(dac1fi31, preciptype,	280,	3,	UINT) \
+	X(dac1fi31, salinity,	283,	9,	UINT) \
+	X(dac1fi31, ice,		292,	2,	UINT) \
+	X(dac1fi31, spare,		294,	10,	SPARE)
+
+/*
+ * DAC 1 FI 22 (broadcast) and FI 23 (addressed) - Area Notice: a header
+ * and then up to AIS_APP_AREA_SUBAREAS subareas of 87 bits, each a
+ * 3-bit shape and one of the shape lists, whose starts are relative to
+ * the subarea.
+ */
+#define AIS_APP_AREA_FIELDS(X) \
+	X(dac1fi22, linkage,	0,	10,	UINT) \
+	X(dac1fi22, notice,	10,	7,	UINT) \
+	X(dac1fi22, month,		17,	4,	UINT) \
+	X(dac1fi22, day,		21,	5,	UINT) \
+	X(dac1fi22, hour,		26,	5,	UINT) \
+	X(dac1fi22, minute,	31,	6,	UINT) \
+	X(dac1fi22, duration,	37,	18,	UINT)
+#define AIS_APP_AREA_SUBAREA_BITS	87
+#define AIS_APP_AREA_SHAPE_FIELDS(X) \
+	X(subarea, shape,		0,	3,	UINT)
+/* circle or point (radius 0), rectangle, sector */
+#define AIS_APP_AREA_ORIGIN_FIELDS(X) \
+	X(subarea, scale,		3,	2,	UINT) \
+	X(subarea, lon,		5,	25,	SINT) \
+	X(subarea, lat,		30,	24,	SINT) \
+	X(subarea, precision,	54,	3,	UINT)
+#define AIS_APP_AREA_CIRCLE_FIELDS(X) \
+	X(subarea, radius,		57,	12,	UINT) \
+	X(subarea, spare,		69,	18,	SPARE)
+#define AIS_APP_AREA_RECT_FIELDS(X) \
+	X(subarea, e_dim,		57,	8,	UINT) \
+	X(subarea, n_dim,		65,	8,	UINT) \
+	X(subarea, orient,		73,	9,	UINT) \
+	X(subarea, spare,		82,	5,	SPARE)
+#define AIS_APP_AREA_SECTOR_FIELDS(X) \
+	X(subarea, radius,		57,	12,	UINT) \
+	X(subarea, left,		69,	9,	UINT) \
+	X(subarea, right,		78,	9,	UINT)
+/* polyline and polygon: four more points, as bearing and distance */
+#define AIS_APP_AREA_POLY_FIELDS(X) \
+	X(subarea, scale,		3,	2,	UINT) \
+	X(subarea, angle1,		5,	10,	UINT) \
+	X(subarea, dist1,		15,	10,	UINT) \
+	X(subarea, angle2,		25,	10,	UINT) \
+	X(subarea, dist2,		35,	10,	UINT) \
+	X(subarea, angle3,		45,	10,	UINT) \
+	X(subarea, dist3,		55,	10,	UINT) \
+	X(subarea, angle4,		65,	10,	UINT) \
+	X(subarea, dist4,		75,	10,	UINT) \
+	X(subarea, spare,		85,	2,	SPARE)
+#define AIS_APP_AREA_TEXT_FIELDS(X) \
+	X(subarea, text,		3,	14,	TEXT)
+
+/* DAC 235 and 250 FI 10 - AtoN monitoring data (UK and Ireland), type 6 */
+#define AIS_APP_ATON_FIELDS(X) \
+	X(dac235fi10, ana_int,	0,	10,	UINT) \
+	X(dac235fi10, ana_ext1,	10,	10,	UINT) \
+	X(dac235fi10, ana_ext2,	20,	10,	UINT) \
+	X(dac235fi10, racon,	30,	2,	UINT) \
+	X(dac235fi10, light,	32,	2,	UINT) \
+	X(dac235fi10, alarm,	34,	1,	FLAG) \
+	X(dac235fi10, stat_ext,	35,	8,	UINT) \
+	X(dac235fi10, off_pos,	43,	1,	FLAG) \
+	X(dac235fi10, spare,	44,	4,	SPARE)
+
+/* nonzero if bitlen is a plausible payload length for message type */
+extern int aivdm_bitlen_ok(unsigned int type, size_t bitlen);
+
+#endif /* _GPSD_AIVDM_SCHEMA_H_ */
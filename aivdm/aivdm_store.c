@@ -0,0 +1,382 @@
+/* aivdm_store.c - latest state per vessel, open addressing on the MMSI
+ *
+ * Linear probing over hot[], which doubles as the index: a lookup
+ * walks a few adjacent 32-byte slots, usually within one cache line,
+ * and only touches cold[] when the static data is asked for.  Vessels
+ * are only ever removed by aivdm_store_expire(), which closes up probe
+ * runs by shifting slots back, so there are no tombstones.
+ *
+ * Readers copy a slot between two reads of its version and start over
+ * if it was odd or changed; the writer makes it odd, writes, and makes
+ * it even again.  Moving slots about is fenced off the same way by
+ * the store's generation.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <string.h>
+
+#include "aivdm.h"
+#include "aivdm_atomic.h"
+
+static unsigned int mmsi_hash(const struct aivdm_store_t *store,
+			      unsigned int mmsi)
+{
+	mmsi *= 0x9e3779b1U;
+	return (mmsi ^ (mmsi >> 16)) & store->mask;
+}
+
+size_t aivdm_store_bufsize(size_t slots)
+{
+	return slots * (sizeof(struct aivdm_vessel_t)
+			+ sizeof(struct aivdm_vessel_static_t));
+}
+
+int aivdm_store_init(struct aivdm_store_t *store, void *buf, size_t slots)
+{
+	if (slots < 4 || (slots & (slots - 1)) != 0 || slots > 0x80000000U)
+		return -1;
+	(void)memset(buf, '\0', aivdm_store_bufsize(slots));
+	store->hot = (struct aivdm_vessel_t *)buf;
+	store->cold = (struct aivdm_vessel_static_t *)(store->hot + slots);
+	store->mask = (unsigned int)(slots - 1);
+	store->count = 0;
+	store->limit = (unsigned int)(slots - slots / 4);
+	store->generation = 0;
+	return 0;
+}
+
+static unsigned int find_slot(const struct aivdm_store_t *store,
+			      unsigned int mmsi)
+/* the slot holding mmsi, or the empty one where it belongs */
+{
+	unsigned int i, m;
+
+	for (i = mmsi_hash(store, mmsi);; i = (i + 1) & store->mask) {
+		m = aivdm_load_acquire(&store->hot[i].mmsi);
+		if (m == 0 || m == mmsi)
+			return i;
+	}
+}
+
+static void copy_text(char *to, const char *from, size_t size)
+{
+	(void)memcpy(to, from, size - 1);
+	to[size - 1] = '\0';
+}
+
+static void set_position(struct aivdm_vessel_t *v, unsigned int type,
+			 int lon, int lat, unsigned int speed,
+			 unsigned int course, unsigned int second,
+			 int accuracy, int raim)
+{
+	v->type = (unsigned char)type;
+	v->lon = lon;
+	v->lat = lat;
+	v->speed = (unsigned short)speed;
+	v->course = (unsigned short)course;
+	v->second = (unsigned char)second;
+	v->flags = AIVDM_VESSEL_POSITION
+		| (accuracy ? AIVDM_VESSEL_ACCURACY : 0)
+		| (raim ? AIVDM_VESSEL_RAIM : 0);
+}
+
+static void set_dimensions(struct aivdm_vessel_static_t *c,
+			   unsigned int to_bow, unsigned int to_stern,
+			   unsigned int to_port, unsigned int to_starboard)
+{
+	c->to_bow = (unsigned short)to_bow;
+	c->to_stern = (unsigned short)to_stern;
+	c->to_port = (unsigned char)to_port;
+	c->to_starboard = (unsigned char)to_starboard;
+}
+
+static void apply(struct aivdm_vessel_t *v, struct aivdm_vessel_static_t *c,
+		  const struct ais_t *ais, unsigned int now)
+/* write what ais says into the slot; positions also stamp hot[] */
+{
+	switch (ais->type) {
+	case 1:
+	case 2:
+	case 3:
+		set_position(v, ais->type, ais->type1.lon, ais->type1.lat,
+			     ais->type1.speed, ais->type1.course,
+			     ais->type1.second, ais->type1.accuracy,
+			     ais->type1.raim);
+		v->heading = (unsigned short)ais->type1.heading;
+		v->turn = (short)ais->type1.turn;
+		v->status = (unsigned char)ais->type1.status;
+		break;
+	case 9:
+		set_position(v, ais->type, ais->type9.lon, ais->type9.lat,
+			     ais->type9.speed, ais->type9.course,
+			     ais->type9.second, ais->type9.accuracy,
+			     ais->type9.raim);
+		v->heading = AIS_HEADING_NOT_AVAILABLE;
+		break;
+	case 18:
+		set_position(v, ais->type, ais->type18.lon, ais->type18.lat,
+			     ais->type18.speed, ais->type18.course,
+			     ais->type18.second, ais->type18.accuracy,
+			     ais->type18.raim);
+		v->heading = (unsigned short)ais->type18.heading;
+		break;
+	case 19:
+		set_position(v, ais->type, ais->type19.lon, ais->type19.lat,
+			     ais->type19.speed, ais->type19.course,
+			     ais->type19.second, ais->type19.accuracy,
+			     ais->type19.raim);
+		v->heading = (unsigned short)ais->type19.heading;
+		copy_text(c->shipname, ais->type19.shipname, sizeof(c->shipname));
+		c->shiptype = (unsigned char)ais->type19.shiptype;
+		c->epfd = (unsigned char)ais->type19.epfd;
+		set_dimensions(c, ais->type19.to_bow, ais->type19.to_stern,
+			       ais->type19.to_port, ais->type19.to_starboard);
+		c->have |= AIVDM_STATIC_NAME | AIVDM_STATIC_SHIP;
+		c->updated = now;
+		break;
+	case 21:
+		set_position(v, ais->type, ais->type21.lon, ais->type21.lat,
+			     AIS_SPEED_NOT_AVAILABLE, AIS_COURSE_NOT_AVAILABLE,
+			     ais->type21.second, ais->type21.accuracy,
+			     ais->type21.raim);
+		v->heading = AIS_HEADING_NOT_AVAILABLE;
+		/* the first 20 characters; the extension rarely matters */
+		copy_text(c->shipname, ais->type21.name, sizeof(c->shipname));
+		c->epfd = (unsigned char)ais->type21.epfd;
+		set_dimensions(c, ais->type21.to_bow, ais->type21.to_stern,
+			       ais->type21.to_port, ais->type21.to_starboard);
+		c->have |= AIVDM_STATIC_NAME;
+		c->updated = now;
+		break;
+	case 27:
+		/* long-range reports are coarser; bring them to the common units */
+		set_position(v, ais->type,
+			     ais->type27.lon == AIS_LONGRANGE_LON_NOT_AVAILABLE
+				? AIS_LON_NOT_AVAILABLE : ais->type27.lon * 1000,
+			     ais->type27.lat == AIS_LONGRANGE_LAT_NOT_AVAILABLE
+				? AIS_LAT_NOT_AVAILABLE : ais->type27.lat * 1000,
+			     ais->type27.speed == AIS_LONGRANGE_SPEED_NOT_AVAILABLE
+				? AIS_SPEED_NOT_AVAILABLE : ais->type27.speed * 10,
+			     ais->type27.course == AIS_LONGRANGE_COURSE_NOT_AVAILABLE
+				? AIS_COURSE_NOT_AVAILABLE : ais->type27.course * 10,
+			     AIS_SEC_NOT_AVAILABLE, ais->type27.accuracy,
+			     ais->type27.raim);
+		v->heading = AIS_HEADING_NOT_AVAILABLE;
+		v->status = (unsigned char)ais->type27.status;
+		break;
+	case 5:
+		c->imo = ais->type5.imo;
+		copy_text(c->callsign, ais->type5.callsign, sizeof(c->callsign));
+		copy_text(c->shipname, ais->type5.shipname, sizeof(c->shipname));
+		copy_text(c->destination, ais->type5.destination,
+			  sizeof(c->destination));
+		c->shiptype = (unsigned char)ais->type5.shiptype;
+		c->epfd = (unsigned char)ais->type5.epfd;
+		c->draught = (unsigned char)ais->type5.draught;
+		c->month = (unsigned char)ais->type5.month;
+		c->day = (unsigned char)ais->type5.day;
+		c->hour = (unsigned char)ais->type5.hour;
+		c->minute = (unsigned char)ais->type5.minute;
+		set_dimensions(c, ais->type5.to_bow, ais->type5.to_stern,
+			       ais->type5.to_port, ais->type5.to_starboard);
+		c->have |= AIVDM_STATIC_VOYAGE;
+		c->updated = now;
+		return;
+	case 24:
+		if (ais->type24.part != AIS_TYPE24_PART_B) {
+			copy_text(c->shipname, ais->type24.shipname,
+				  sizeof(c->shipname));
+			c->have |= AIVDM_STATIC_NAME;
+		}
+		if (ais->type24.part != AIS_TYPE24_PART_A) {
+			c->shiptype = (unsigned char)ais->type24.shiptype;
+			copy_text(c->vendorid, ais->type24.vendorid,
+				  sizeof(c->vendorid));
+			copy_text(c->callsign, ais->type24.callsign,
+				  sizeof(c->callsign));
+			if (AIS_AUXILIARY_MMSI(ais->mmsi))
+				c->mothership_mmsi = ais->type24.mothership_mmsi;
+			else
+				set_dimensions(c, ais->type24.dim.to_bow,
+					       ais->type24.dim.to_stern,
+					       ais->type24.dim.to_port,
+					       ais->type24.dim.to_starboard);
+			c->have |= AIVDM_STATIC_SHIP;
+		}
+		c->updated = now;
+		return;
+	}
+	v->updated = now;
+}
+
+static int carries_state(unsigned int type)
+/* the types apply() knows */
+{
+	switch (type) {
+	case 1: case 2: case 3: case 5: case 9:
+	case 18: case 19: case 21: case 24: case 27:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+int aivdm_store_update(struct aivdm_store_t *store,
+		       const struct ais_t *ais, unsigned long now)
+{
+	unsigned int i, version;
+	struct aivdm_vessel_t *v;
+
+	if (!carries_state(ais->type) || ais->mmsi == 0)
+		return 0;
+	i = find_slot(store, ais->mmsi);
+	v = &store->hot[i];
+	version = v->version + 1;
+	if (v->mmsi == 0) {
+		if (store->count >= store->limit)
+			return -1;
+		store->count++;
+		aivdm_store_release(&v->version, version);
+		aivdm_fence_release();
+		(void)memset((char *)v + 2 * sizeof(unsigned int), '\0',
+			     sizeof(*v) - 2 * sizeof(unsigned int));
+		(void)memset(&store->cold[i], '\0', sizeof(store->cold[i]));
+		v->status = 15;		/* not defined */
+		v->turn = -AIS_TURN_NOT_AVAILABLE;	/* as the wire has it */
+		v->speed = AIS_SPEED_NOT_AVAILABLE;
+		v->course = AIS_COURSE_NOT_AVAILABLE;
+		v->heading = AIS_HEADING_NOT_AVAILABLE;
+		v->lon = AIS_LON_NOT_AVAILABLE;
+		v->lat = AIS_LAT_NOT_AVAILABLE;
+		v->second = AIS_SEC_NOT_AVAILABLE;
+		/* the key goes in last, readers probe by it */
+		aivdm_store_release(&v->mmsi, ais->mmsi);
+	} else {
+		aivdm_store_release(&v->version, version);
+		aivdm_fence_release();
+	}
+	apply(v, &store->cold[i], ais, (unsigned int)now);
+	aivdm_store_release(&v->version, version + 1);
+	return 1;
+}
+
+static int read_slot(const struct aivdm_store_t *store, unsigned int i,
+		     struct aivdm_vessel_t *hot,
+		     struct aivdm_vessel_static_t *cold)
+/* copy a consistent slot; 0 if it is empty */
+{
+	const struct aivdm_vessel_t *v = &store->hot[i];
+	unsigned int version;
+
+	for (;;) {
+		version = aivdm_load_acquire(&v->version);
+		if (version & 1)
+			continue;
+		(void)memcpy(hot, (const void *)v, sizeof(*hot));
+		if (cold != NULL)
+			(void)memcpy(cold, &store->cold[i], sizeof(*cold));
+		aivdm_fence_acquire();
+		if (aivdm_load_acquire(&v->version) == version)
+			return hot->mmsi != 0;
+	}
+}
+
+int aivdm_store_get(const struct aivdm_store_t *store, unsigned int mmsi,
+		    struct aivdm_vessel_t *hot,
+		    struct aivdm_vessel_static_t *cold)
+{
+	unsigned int generation;
+	int found;
+
+	if (mmsi == 0)
+		return 0;
+	for (;;) {
+		generation = aivdm_load_acquire(&store->generation);
+		if (generation & 1)
+			continue;
+		found = read_slot(store, find_slot(store, mmsi), hot, cold)
+			&& hot->mmsi == mmsi;
+		aivdm_fence_acquire();
+		if (aivdm_load_acquire(&store->generation) == generation)
+			return found;
+	}
+}
+
+int aivdm_store_next(const struct aivdm_store_t *store, unsigned int *cursor,
+		     struct aivdm_vessel_t *hot,
+		     struct aivdm_vessel_static_t *cold)
+{
+	unsigned int generation;
+	int found;
+
+	while (*cursor <= store->mask) {
+		generation = aivdm_load_acquire(&store->generation);
+		if (generation & 1)
+			continue;
+		found = aivdm_load_acquire(&store->hot[*cursor].mmsi) != 0
+			&& read_slot(store, *cursor, hot, cold);
+		aivdm_fence_acquire();
+		if (aivdm_load_acquire(&store->generation) != generation)
+			continue;
+		(*cursor)++;
+		if (found)
+			return 1;
+	}
+	return 0;
+}
+
+static void remove_slot(struct aivdm_store_t *store, unsigned int i)
+/* empty slot i and shift the rest of its probe run back */
+{
+	unsigned int j = i, home;
+
+	for (;;) {
+		store->hot[i].mmsi = 0;
+		for (;;) {
+			j = (j + 1) & store->mask;
+			if (store->hot[j].mmsi == 0)
+				return;
+			home = mmsi_hash(store, store->hot[j].mmsi);
+			/* it stays put if its home lies cyclically in (i, j] */
+			if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+				continue;
+			break;
+		}
+		store->hot[i] = store->hot[j];
+		store->cold[i] = store->cold[j];
+		i = j;
+	}
+}
+
+static unsigned int last_heard(const struct aivdm_vessel_t *v,
+			       const struct aivdm_vessel_static_t *c)
+{
+	if ((v->flags & AIVDM_VESSEL_POSITION) == 0)
+		return c->updated;
+	if (c->have != 0 && (int)(c->updated - v->updated) > 0)
+		return c->updated;
+	return v->updated;
+}
+
+size_t aivdm_store_expire(struct aivdm_store_t *store,
+			  unsigned long now, unsigned long maxage)
+{
+	unsigned int i = 0;
+	size_t gone = 0;
+
+	aivdm_store_release(&store->generation, store->generation + 1);
+	aivdm_fence_release();
+	while (i <= store->mask) {
+		if (store->hot[i].mmsi != 0 && (unsigned int)now
+				- last_heard(&store->hot[i], &store->cold[i]) > maxage) {
+			remove_slot(store, i);
+			store->count--;
+			gone++;
+			continue;	/* look again at what moved in */
+		}
+		i++;
+	}
+	aivdm_store_release(&store->generation, store->generation + 1);
+	return gone;
+}
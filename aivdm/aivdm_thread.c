@@ -0,0 +1,130 @@
+/* aivdm_thread.c - Win32 and POSIX versions of the threading primitives
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <stdlib.h>
+
+#include "aivdm_thread.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/* carries the caller's function across the native entry point */
+struct start_t {
+	aivdm_thread_fn_t fn;
+	void *arg;
+};
+
+#ifdef _WIN32
+static unsigned __stdcall trampoline(void *p)
+#else
+static void *trampoline(void *p)
+#endif
+{
+	struct start_t start = *(struct start_t *)p;
+
+	free(p);
+	start.fn(start.arg);
+	return 0;
+}
+
+int aivdm_thread_start(aivdm_thread_t *thread, aivdm_thread_fn_t fn, void *arg)
+{
+	struct start_t *start = (struct start_t *)malloc(sizeof(*start));
+
+	if (start == NULL)
+		return -1;
+	start->fn = fn;
+	start->arg = arg;
+#ifdef _WIN32
+	*thread = (HANDLE)_beginthreadex(NULL, 0, trampoline, start, 0, NULL);
+	if (*thread != 0)
+		return 0;
+#else
+	if (pthread_create(thread, NULL, trampoline, start) == 0)
+		return 0;
+#endif
+	free(start);
+	return -1;
+}
+
+#ifdef _WIN32
+void aivdm_thread_join(aivdm_thread_t thread)
+{
+	(void)WaitForSingleObject(thread, INFINITE);
+	(void)CloseHandle(thread);
+}
+
+void aivdm_mutex_init(aivdm_mutex_t *mutex)	{ InitializeCriticalSection(mutex); }
+void aivdm_mutex_destroy(aivdm_mutex_t *mutex)	{ DeleteCriticalSection(mutex); }
+void aivdm_mutex_lock(aivdm_mutex_t *mutex)	{ EnterCriticalSection(mutex); }
+void aivdm_mutex_unlock(aivdm_mutex_t *mutex)	{ LeaveCriticalSection(mutex); }
+
+void aivdm_cond_init(aivdm_cond_t *cond)	{ InitializeConditionVariable(cond); }
+void aivdm_cond_destroy(aivdm_cond_t *cond)	{ (void)cond; }
+void aivdm_cond_signal(aivdm_cond_t *cond)	{ WakeConditionVariable(cond); }
+void aivdm_cond_broadcast(aivdm_cond_t *cond)	{ WakeAllConditionVariable(cond); }
+
+void aivdm_cond_wait(aivdm_cond_t *cond, aivdm_mutex_t *mutex)
+{
+	(void)SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+unsigned int aivdm_cpu_count(void)
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0
+		? (unsigned int)info.dwNumberOfProcessors : 1;
+}
+
+double aivdm_clock(void)
+{
+	LARGE_INTEGER count, freq;
+
+	(void)QueryPerformanceCounter(&count);
+	(void)QueryPerformanceFrequency(&freq);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+}
+#else
+void aivdm_thread_join(aivdm_thread_t thread)
+{
+	(void)pthread_join(thread, NULL);
+}
+
+void aivdm_mutex_init(aivdm_mutex_t *mutex)	{ (void)pthread_mutex_init(mutex, NULL); }
+void aivdm_mutex_destroy(aivdm_mutex_t *mutex)	{ (void)pthread_mutex_destroy(mutex); }
+void aivdm_mutex_lock(aivdm_mutex_t *mutex)	{ (void)pthread_mutex_lock(mutex); }
+void aivdm_mutex_unlock(aivdm_mutex_t *mutex)	{ (void)pthread_mutex_unlock(mutex); }
+
+void aivdm_cond_init(aivdm_cond_t *cond)	{ (void)pthread_cond_init(cond, NULL); }
+void aivdm_cond_destroy(aivdm_cond_t *cond)	{ (void)pthread_cond_destroy(cond); }
+void aivdm_cond_signal(aivdm_cond_t *cond)	{ (void)pthread_cond_signal(cond); }
+void aivdm_cond_broadcast(aivdm_cond_t *cond)	{ (void)pthread_cond_broadcast(cond); }
+
+void aivdm_cond_wait(aivdm_cond_t *cond, aivdm_mutex_t *mutex)
+{
+	(void)pthread_cond_wait(cond, mutex);
+}
+
+unsigned int aivdm_cpu_count(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (unsigned int)n : 1;
+}
+
+double aivdm_clock(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif /* _WIN32 */
@@ -0,0 +1,59 @@
+/*
+ * aivdm_thread.h - the little threading the pipeline needs
+ *
+ * Threads, a mutex and a condition variable, mapped onto Win32 (Vista
+ * and later, for CONDITION_VARIABLE) or POSIX threads, plus a
+ * monotonic wall clock for timing runs.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_AIVDM_THREAD_H_
+#define _GPSD_AIVDM_THREAD_H_
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE aivdm_thread_t;
+typedef CRITICAL_SECTION aivdm_mutex_t;
+typedef CONDITION_VARIABLE aivdm_cond_t;
+#else
+#include <pthread.h>
+typedef pthread_t aivdm_thread_t;
+typedef pthread_mutex_t aivdm_mutex_t;
+typedef pthread_cond_t aivdm_cond_t;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*aivdm_thread_fn_t)(void *arg);
+
+/* run fn(arg) on a new thread; returns 0 on success */
+extern int aivdm_thread_start(aivdm_thread_t *thread,
+			      aivdm_thread_fn_t fn, void *arg);
+extern void aivdm_thread_join(aivdm_thread_t thread);
+
+extern void aivdm_mutex_init(aivdm_mutex_t *mutex);
+extern void aivdm_mutex_destroy(aivdm_mutex_t *mutex);
+extern void aivdm_mutex_lock(aivdm_mutex_t *mutex);
+extern void aivdm_mutex_unlock(aivdm_mutex_t *mutex);
+
+extern void aivdm_cond_init(aivdm_cond_t *cond);
+extern void aivdm_cond_destroy(aivdm_cond_t *cond);
+/* mutex must be held; it is released while waiting */
+extern void aivdm_cond_wait(aivdm_cond_t *cond, aivdm_mutex_t *mutex);
+extern void aivdm_cond_signal(aivdm_cond_t *cond);
+extern void aivdm_cond_broadcast(aivdm_cond_t *cond);
+
+/* logical processors on this host, at least 1 */
+extern unsigned int aivdm_cpu_count(void);
+
+/* seconds on a monotonic clock with an arbitrary origin */
+extern double aivdm_clock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GPSD_AIVDM_THREAD_H_ */
@@ -0,0 +1,189 @@
+/* aivdm_type24.c - pair the two halves of type 24 reports by MMSI
+ *
+ * Entries are allocated in order until the cache is full and then
+ * recycled least recently heard first.  index[] is open addressing
+ * with linear probing over twice as many slots as there are entries,
+ * so probe runs stay short; deletion shifts the rest of a run back
+ * instead of leaving tombstones.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include <string.h>
+
+#include "aivdm.h"
+
+#define INDEX_MASK	(2 * AIVDM_TYPE24_CACHE - 1)
+#define NONE		0xffff	/* end of the LRU list */
+
+static unsigned int mmsi_hash(unsigned int mmsi)
+{
+	mmsi *= 0x9e3779b1U;
+	return (mmsi ^ (mmsi >> 16)) & INDEX_MASK;
+}
+
+static unsigned int find_slot(const struct aivdm_type24_cache_t *cache,
+			      unsigned int mmsi)
+/* the index slot holding mmsi, or the free one where it belongs */
+{
+	unsigned int i;
+
+	for (i = mmsi_hash(mmsi); cache->index[i] != 0; i = (i + 1) & INDEX_MASK)
+		if (cache->entry[cache->index[i] - 1].mmsi == mmsi)
+			break;
+	return i;
+}
+
+static void unindex(struct aivdm_type24_cache_t *cache, unsigned int i)
+{
+	unsigned int j = i, home;
+
+	for (;;) {
+		cache->index[i] = 0;
+		/* find a later slot of the run that may move into the hole */
+		for (;;) {
+			j = (j + 1) & INDEX_MASK;
+			if (cache->index[j] == 0)
+				return;
+			home = mmsi_hash(cache->entry[cache->index[j] - 1].mmsi);
+			/* it stays put if its home lies cyclically in (i, j] */
+			if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+				continue;
+			break;
+		}
+		cache->index[i] = cache->index[j];
+		i = j;
+	}
+}
+
+static void lru_unlink(struct aivdm_type24_cache_t *cache, unsigned short e)
+{
+	struct aivdm_type24_entry_t *p = &cache->entry[e];
+
+	if (p->newer != NONE)
+		cache->entry[p->newer].older = p->older;
+	else
+		cache->newest = p->older;
+	if (p->older != NONE)
+		cache->entry[p->older].newer = p->newer;
+	else
+		cache->oldest = p->newer;
+}
+
+static void lru_push(struct aivdm_type24_cache_t *cache, unsigned short e)
+{
+	struct aivdm_type24_entry_t *p = &cache->entry[e];
+
+	p->newer = NONE;
+	p->older = cache->newest;
+	if (cache->newest != NONE)
+		cache->entry[cache->newest].newer = e;
+	else
+		cache->oldest = e;
+	cache->newest = e;
+}
+
+static void fill_a(struct ais_t *ais, const struct aivdm_type24_entry_t *p)
+{
+	(void)memcpy(ais->type24.shipname, p->shipname, sizeof(p->shipname));
+}
+
+static void fill_b(struct ais_t *ais, const struct aivdm_type24_entry_t *p)
+{
+	ais->type24.shiptype = p->shiptype;
+	(void)memcpy(ais->type24.vendorid, p->vendorid, sizeof(p->vendorid));
+	(void)memcpy(ais->type24.callsign, p->callsign, sizeof(p->callsign));
+	/* copies the mothership MMSI as well, they share storage */
+	(void)memcpy(&ais->type24.dim, p->dim, sizeof(p->dim));
+}
+
+void aivdm_type24_cache_init(struct aivdm_type24_cache_t *cache)
+{
+	(void)memset(cache, '\0', sizeof(*cache));
+}
+
+int aivdm_type24_merge(struct aivdm_type24_cache_t *cache, struct ais_t *ais)
+{
+	unsigned int i = find_slot(cache, ais->mmsi);
+	unsigned short e;
+	struct aivdm_type24_entry_t *p;
+
+	if (ais->type24.part != AIS_TYPE24_PART_A
+			&& ais->type24.part != AIS_TYPE24_PART_B)
+		return AIVDM_STATUS_REJECTED;
+	if (cache->index[i] != 0) {
+		e = (unsigned short)(cache->index[i] - 1);
+		lru_unlink(cache, e);
+	} else {
+		if (cache->count < AIVDM_TYPE24_CACHE) {
+			if (cache->count == 0)
+				cache->newest = cache->oldest = NONE;
+			e = (unsigned short)cache->count++;
+		} else {
+			/* forget the vessel heard from least recently */
+			e = cache->oldest;
+			lru_unlink(cache, e);
+			unindex(cache, find_slot(cache, cache->entry[e].mmsi));
+			/* the shift may have filled the slot found above */
+			i = find_slot(cache, ais->mmsi);
+		}
+		cache->index[i] = (unsigned short)(e + 1);
+		cache->entry[e].mmsi = ais->mmsi;
+		cache->entry[e].have = 0;
+	}
+	lru_push(cache, e);
+	p = &cache->entry[e];
+
+	switch (ais->type24.part) {
+	case AIS_TYPE24_PART_A:
+		(void)memcpy(p->shipname, ais->type24.shipname, sizeof(p->shipname));
+		p->have |= AIVDM_TYPE24_HAVE_A;
+		if ((p->have & AIVDM_TYPE24_HAVE_B) == 0)
+			return AIVDM_STATUS_PENDING;	/* data only partially decoded */
+		fill_b(ais, p);
+		break;
+	case AIS_TYPE24_PART_B:
+		p->shiptype = ais->type24.shiptype;
+		(void)memcpy(p->vendorid, ais->type24.vendorid, sizeof(p->vendorid));
+		(void)memcpy(p->callsign, ais->type24.callsign, sizeof(p->callsign));
+		(void)memcpy(p->dim, &ais->type24.dim, sizeof(p->dim));
+		p->have |= AIVDM_TYPE24_HAVE_B;
+		if ((p->have & AIVDM_TYPE24_HAVE_A) == 0) {
+			ais->type24.shipname[0] = '\0';	/* not heard yet */
+			return AIVDM_STATUS_DECODED;
+		}
+		fill_a(ais, p);
+		break;
+	}
+	ais->type24.part = AIS_TYPE24_PART_AB;
+	return AIVDM_STATUS_DECODED;
+}
+
+int aivdm_type24_lookup(const struct aivdm_type24_cache_t *cache,
+			unsigned int mmsi, struct ais_t *ais)
+{
+	unsigned int i = find_slot(cache, mmsi);
+	const struct aivdm_type24_entry_t *p;
+
+	if (cache->index[i] == 0)
+		return 0;
+	p = &cache->entry[cache->index[i] - 1];
+	(void)memset(&ais->type24, '\0', sizeof(ais->type24));
+	ais->type = 24;
+	ais->repeat = 0;
+	ais->mmsi = mmsi;
+	if (p->have & AIVDM_TYPE24_HAVE_A)
+		fill_a(ais, p);
+	if (p->have & AIVDM_TYPE24_HAVE_B)
+		fill_b(ais, p);
+	if (p->have == (AIVDM_TYPE24_HAVE_A | AIVDM_TYPE24_HAVE_B))
+		ais->type24.part = AIS_TYPE24_PART_AB;
+	else if (p->have & AIVDM_TYPE24_HAVE_B)
+		ais->type24.part = AIS_TYPE24_PART_B;
+	else
+		ais->type24.part = AIS_TYPE24_PART_A;
+	return p->have;
+}
+
+#undef NONE
+#undef INDEX_MASK
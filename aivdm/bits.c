@@ -14,6 +14,8 @@
 #include <string.h>
 
 #include "bits.h"
+#include "sixbit.h"
+#include "simd.h"
 #ifdef DEBUG
 #include <stdio.h>
 #include "gpsd.h"
@@ -29,6 +31,9 @@ unsigned long long ubits(char buf[], unsigned int start, unsigned int width)
 	unsigned end;
 
 	/*@i1@*/ assert(width <= sizeof(long long) * BITS_PER_BYTE);
+	if (width > 56)		/* may span 9 bytes; split so nothing shifts out */
+		return (ubits(buf, start, width - 32) << 32)
+			| ubits(buf, start + width - 32, 32);
 	for (i = start / BITS_PER_BYTE;
 			i < (start + width + BITS_PER_BYTE - 1) / BITS_PER_BYTE; i++) {
 		fld <<= BITS_PER_BYTE;
@@ -52,7 +57,7 @@ signed long long sbits(char buf[], unsigned int start, unsigned int width)
 {
 	unsigned long long fld = ubits(buf, start, width);
 
-	if (fld & (1 << (width - 1))) {
+	if (fld & (1ULL << (width - 1))) {
 		/*@ -shiftimplementation @*/
 		fld |= (-1LL << (width - 1));
 		/*@ +shiftimplementation @*/
@@ -60,70 +65,166 @@ signed long long sbits(char buf[], unsigned int start, unsigned int width)
 	return (signed long long)fld;
 }
 
-// clear subdue signed bits
-void setbyte(char * dest, int off, char * src){
-	char tmp = *dest;
-	unsigned char clearChar = 0xFF >> (off%BITS_PER_BYTE);
-	tmp |= clearChar;	
-	*dest |= *src; 
-	*dest &= tmp;
+unsigned long long ubits_safe(const unsigned char *buf, size_t buflen,
+			      unsigned int start, unsigned int width)
+/* word-wise extraction with a byte-wise tail near the end of the buffer */
+{
+	if (start / BITS_PER_BYTE + 9 <= buflen)
+		return ubits_fast(buf, start, width);
+	return ubits((char *)buf, start, width);
 }
-int get6bitcode(char c)
+
+void ubits_batch(const unsigned char *buf,
+		 const struct bitfield_t *fields, unsigned int nfields,
+		 int64_t *out)
+/* extract a field layout, reusing each loaded 64-bit window while it covers */
 {
-	int rt=-1;
-	const char sixchr[64] =
-		"@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^- !\"#$%&`()*+,-./0123456789:;<=>?";
-	for(rt=0;rt<64;rt++)
-	{
-		if(sixchr[rt] == c)
-			break;
+	uint64_t w = 0, fld, sign;
+	unsigned int wstart = 0, wend = 0;	/* bit span held in w */
+	unsigned int i, start, width;
+
+	for (i = 0; i < nfields; i++) {
+		start = fields[i].start;
+		width = fields[i].width;
+		if (start < wstart || start + width > wend) {
+			wstart = start & ~(BITS_PER_BYTE - 1);
+			wend = wstart + 64;
+			w = getbeu64(buf + wstart / BITS_PER_BYTE);
+		}
+		if (start + width <= wend)
+			fld = (w << (start - wstart)) >> (64 - width);
+		else
+			fld = ubits_fast(buf, start, width);
+		if (fields[i].sign) {
+			sign = (uint64_t)1 << (width - 1);
+			fld = (fld ^ sign) - sign;
+		}
+		out[i] = (int64_t)fld;
 	}
-	return rt;
+}
+
+BITS_INLINE unsigned int funnel_byte(const unsigned char *s, size_t i,
+				     unsigned int sh, size_t avail)
+/* byte i of a copy shifted left by sh bits out of avail source bytes */
+{
+	unsigned int b = (unsigned int)s[i] << sh;
 
+	if (sh != 0 && i + 1 < avail)
+		b |= s[i + 1] >> (BITS_PER_BYTE - sh);
+	return b & 0xff;
 }
 
-void put6bitschars(char *buf, unsigned int start, unsigned int length, char * str)
+#ifdef AIVDM_HAVE_SSE2
+AIVDM_TARGET_SSE2
+static size_t copy_bits_sse2(unsigned char *dst, const unsigned char *s,
+			     unsigned int sh, size_t nbytes, size_t avail)
+/* sixteen bytes per iteration; returns how many were done */
 {
-	int i;
-	int l_len = strlen(str);
-	if(l_len>length)
-	{
-		//		printf("put6bitschars(): buffer over flow!\n");
-		return;
+	const __m128i count = _mm_cvtsi32_si128((int)sh);
+	size_t i;
+
+	for (i = 0; i + 16 <= nbytes && i + 17 <= avail; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + i + 1));
+		/* 16-bit lanes of s[j] over s[j+1], shifted; the top byte is out[j] */
+		__m128i lo = _mm_srli_epi16(_mm_sll_epi16(_mm_unpacklo_epi8(b, a), count), 8);
+		__m128i hi = _mm_srli_epi16(_mm_sll_epi16(_mm_unpackhi_epi8(b, a), count), 8);
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
 	}
-	for(i=0;i<l_len;++i)	
-		putbits(buf, start+i*6, 6, (long long)get6bitcode(str[i]));	
-	for(i=l_len;i<length;++i)
-		putbits(buf, start+i*6, 6, (long long)get6bitcode(' '));
-	// or
-	//putbits(buf, start+i*6, 6, (long long)get6bitcode('@'));
+	return i;
 }
+#endif /* AIVDM_HAVE_SSE2 */
 
-void putbits(char *buf, unsigned int start, unsigned int width, long long value)
-/* extract a (zero-origin) bitfield from the buffer as an unsigned big-endian long long */
+void copy_bits(unsigned char *dst, const unsigned char *src,
+	       size_t src_bit_offset, size_t nbits)
 {
-	int offset;
-	char * cPtr;
-	int startByte;
-	int i;
-	int startI;
+	const unsigned char *s = src + src_bit_offset / BITS_PER_BYTE;
+	unsigned int sh = (unsigned int)(src_bit_offset % BITS_PER_BYTE);
+	size_t nbytes = (nbits + 7) / BITS_PER_BYTE;
+	size_t avail = (sh + nbits + 7) / BITS_PER_BYTE;	/* source bytes */
+	size_t i = 0;
 
-	offset= BITS_PER_BYTE - 1 - (start + width - 1)%BITS_PER_BYTE ;
+	if (nbytes == 0)
+		return;
+	if (sh == 0)
+		(void)memcpy(dst, s, nbytes);
+	else {
+#ifdef AIVDM_HAVE_SSE2
+		if (nbytes >= 16 && (aivdm_cpu_features() & AIVDM_CPU_SSE2))
+			i = copy_bits_sse2(dst, s, sh, nbytes, avail);
+#endif
+		/* whole words while a ninth byte is there to shift in from */
+		for (; i + 8 <= nbytes && i + 9 <= avail; i += 8)
+			putbeu64(dst + i, (getbeu64(s + i) << sh)
+				 | (s[i + 8] >> (BITS_PER_BYTE - sh)));
+		for (; i < nbytes; i++)
+			dst[i] = (unsigned char)funnel_byte(s, i, sh, avail);
+	}
+	if (nbits % BITS_PER_BYTE != 0)
+		dst[nbytes - 1] &= (unsigned char)(0xff00 >> (nbits % BITS_PER_BYTE));
+}
 
-	value = value << offset;
+void bw_put_bits(struct bitwriter_t *bw, const unsigned char *src,
+		 size_t src_bit_offset, size_t nbits)
+{
+	const unsigned char *s = src + src_bit_offset / BITS_PER_BYTE;
+	unsigned int sh = (unsigned int)(src_bit_offset % BITS_PER_BYTE);
+	size_t avail = (sh + nbits + 7) / BITS_PER_BYTE;
+	size_t i = 0;
+	uint64_t w;
+
+	for (; nbits >= 64 && i + 8 + (sh != 0) <= avail; nbits -= 64, i += 8) {
+		w = getbeu64(s + i);
+		if (sh != 0)
+			w = (w << sh) | (s[i + 8] >> (BITS_PER_BYTE - sh));
+		bw_put(bw, 64, w);
+	}
+	for (; nbits >= BITS_PER_BYTE; nbits -= BITS_PER_BYTE, i++)
+		bw_put(bw, BITS_PER_BYTE, funnel_byte(s, i, sh, avail));
+	if (nbits > 0)
+		bw_put(bw, (unsigned int)nbits,
+		       funnel_byte(s, i, sh, avail) >> (BITS_PER_BYTE - nbits));
+}
 
-	cPtr = (char *) &value;
+int get6bitcode(char c)
+{
+	return sixbit_from_ascii[(unsigned char)c];
+}
 
-	startByte = start/BITS_PER_BYTE;
+void put6bitschars(char *buf, unsigned int start, unsigned int length, char * str)
+{
+	unsigned int i;
 
-	startI = (width+offset-1)/BITS_PER_BYTE;
+	for (i = 0; i < length && str[i] != '\0'; ++i)
+		putbits(buf, start+i*6, 6, (long long)get6bitcode(str[i]));
+	for (; i < length; ++i)
+		putbits(buf, start+i*6, 6, (long long)get6bitcode(' '));
+}
 
-	//big endian, so put lsb first with ptr
-	for(i=startI;i>=0;i--)
-	{
-		if(i!=0)
-			buf[startByte+i] = *(cPtr++);
-		else
-			setbyte(&buf[startByte], start, cPtr);
-	}	
+void putbits(char *buf, unsigned int start, unsigned int width, long long value)
+/* store a (zero-origin) bitfield of 1..64 bits big-endian, independent of host byte order */
+{
+	unsigned char *out = (unsigned char *)buf;
+	unsigned int first = start / BITS_PER_BYTE;
+	unsigned int last = (start + width - 1) / BITS_PER_BYTE;
+	/* unused low bits of the last byte */
+	unsigned int sh = BITS_PER_BYTE - 1 - (start + width - 1) % BITS_PER_BYTE;
+	unsigned long long v = (unsigned long long)value;
+	unsigned int i;
+	unsigned char mask;
+
+	if (width < 64)
+		v &= (1ULL << width) - 1;
+	/* walk from the least significant end, merging only the edge bytes */
+	for (i = last;; i--) {
+		mask = (unsigned char)(0xFF << sh);
+		if (i == first)
+			mask &= 0xFF >> (start % BITS_PER_BYTE);
+		out[i] = (unsigned char)((out[i] & ~mask) | ((v << sh) & mask));
+		v >>= BITS_PER_BYTE - sh;
+		sh = 0;
+		if (i == first)
+			break;
+	}
 }
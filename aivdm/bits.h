@@ -21,6 +21,11 @@
 #ifndef _GPSD_BITS_H_
 #define _GPSD_BITS_H_
 
+#include <stddef.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
 #include "stdint.h"
 
 union int_float {
@@ -89,4 +94,175 @@ extern unsigned long long ubits(char buf[], unsigned int, unsigned int);
 extern signed long long sbits(char buf[], unsigned int, unsigned int);
 extern void putbits(char buf[], unsigned int start, unsigned int width, long long value);
 
+/*
+ * Word-at-a-time bitfield extraction.  These do one unaligned 64-bit
+ * big-endian load, a shift and a mask per field, so they may read up
+ * to 9 bytes starting at byte start/8.  Use them only on buffers with
+ * that much readable slack past the last field (the AIVDM context
+ * keeps AIVDM_BITS_SLACK zeroed bytes after the payload); ubits_safe()
+ * falls back to byte reads near the end of a buffer of known length,
+ * and plain ubits()/sbits() never read past the field.
+ */
+#if defined(_MSC_VER)
+#define BITS_INLINE	static __inline
+#else
+#define BITS_INLINE	static __inline__
+#endif
+
+BITS_INLINE uint64_t getbeu64(const unsigned char *p)
+/* unaligned big-endian 64-bit load */
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	uint64_t v;
+	(void)memcpy(&v, p, sizeof(v));
+	return _byteswap_uint64(v);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	uint64_t v;
+	(void)memcpy(&v, p, sizeof(v));
+	return __builtin_bswap64(v);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	uint64_t v;
+	(void)memcpy(&v, p, sizeof(v));
+	return v;
+#else
+	return getbeuL(p, 0);
+#endif
+}
+
+BITS_INLINE uint64_t ubits_fast(const unsigned char *buf, unsigned int start, unsigned int width)
+/* extract an unsigned bitfield of 1..64 bits; needs read slack, see above */
+{
+	const unsigned char *p = buf + start / 8;
+	unsigned int shift = start % 8;
+	uint64_t w = getbeu64(p) << shift;
+
+	if (shift + width > 64)		/* only fields wider than 56 bits */
+		w |= p[8] >> (8 - shift);
+	return w >> (64 - width);
+}
+
+BITS_INLINE int64_t sbits_fast(const unsigned char *buf, unsigned int start, unsigned int width)
+/* extract a twos-complement bitfield of 1..64 bits; needs read slack */
+{
+	uint64_t sign = (uint64_t)1 << (width - 1);
+	uint64_t fld = ubits_fast(buf, start, width);
+
+	return (int64_t)((fld ^ sign) - sign);
+}
+
+extern unsigned long long ubits_safe(const unsigned char *buf, size_t buflen,
+				     unsigned int start, unsigned int width);
+
+/*
+ * Batched extraction of a known field layout.  Fields sorted by start
+ * share 64-bit windows, so a whole position report costs a handful of
+ * loads; out[i] receives field i, sign-extended when sign is set.
+ * Same read-slack rule as ubits_fast().
+ */
+struct bitfield_t {
+	unsigned short start;
+	unsigned char width;
+	unsigned char sign;
+};
+
+extern void ubits_batch(const unsigned char *buf,
+			const struct bitfield_t *fields, unsigned int nfields,
+			int64_t *out);
+
+BITS_INLINE void putbeu64(unsigned char *p, uint64_t v)
+/* unaligned big-endian 64-bit store */
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	v = _byteswap_uint64(v);
+	(void)memcpy(p, &v, sizeof(v));
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	v = __builtin_bswap64(v);
+	(void)memcpy(p, &v, sizeof(v));
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	(void)memcpy(p, &v, sizeof(v));
+#else
+	putbelong(p, 0, (uint32_t)(v >> 32));
+	putbelong(p, 4, (uint32_t)v);
+#endif
+}
+
+/*
+ * Append-style bit writer.  Fields are shifted into a 64-bit
+ * accumulator and whole words are stored big-endian as it fills, so
+ * the output is the same on any host byte order and no byte is ever
+ * read back.  bw_finish() stores the last partial word whole, zero
+ * padded: the output buffer needs 8 bytes of room past the last bit.
+ */
+struct bitwriter_t {
+	unsigned char *out;	/* next word goes here */
+	unsigned char *start;
+	uint64_t acc;		/* pending bits, right-aligned */
+	unsigned int nacc;	/* number of pending bits, < 64 */
+};
+
+BITS_INLINE void bw_init(struct bitwriter_t *bw, unsigned char *buf)
+{
+	bw->out = bw->start = buf;
+	bw->acc = 0;
+	bw->nacc = 0;
+}
+
+BITS_INLINE void bw_put(struct bitwriter_t *bw, unsigned int width, uint64_t value)
+/* append the low width (1..64) bits of value, MSB first */
+{
+	unsigned int room = 64 - bw->nacc;
+
+	if (width < 64)
+		value &= ((uint64_t)1 << width) - 1;
+	if (width < room) {
+		bw->acc = (bw->acc << width) | value;
+		bw->nacc += width;
+	} else {
+		/* top room bits complete the word, the rest start the next */
+		width -= room;
+		if (room < 64)
+			bw->acc = (bw->acc << room) | (value >> width);
+		else
+			bw->acc = value >> width;
+		putbeu64(bw->out, bw->acc);
+		bw->out += 8;
+		bw->acc = value;	/* only the low width bits count */
+		bw->nacc = width;
+	}
+}
+
+BITS_INLINE size_t bw_bitlen(const struct bitwriter_t *bw)
+{
+	return (size_t)(bw->out - bw->start) * 8 + bw->nacc;
+}
+
+BITS_INLINE size_t bw_finish(struct bitwriter_t *bw)
+/* flush pending bits zero-padded; returns the total bit length */
+{
+	size_t bitlen = bw_bitlen(bw);
+
+	if (bw->nacc != 0)
+		putbeu64(bw->out, bw->acc << (64 - bw->nacc));
+	else
+		putbeu64(bw->out, 0);
+	return bitlen;
+}
+
+/*
+ * Bit-aligned bulk copies for binary payloads, which start wherever the
+ * fields before them end.  Both funnel-shift whole 64-bit words out of
+ * the source and read nothing past its last byte holding a copied bit.
+ * copy_bits() writes exactly (nbits + 7) / 8 bytes to dst, MSB first,
+ * with the bits after the last one cleared; bw_put_bits() appends to a
+ * bit writer instead.
+ */
+extern void copy_bits(unsigned char *dst, const unsigned char *src,
+		      size_t src_bit_offset, size_t nbits);
+extern void bw_put_bits(struct bitwriter_t *bw, const unsigned char *src,
+			size_t src_bit_offset, size_t nbits);
+
+/* six-bit text, space padded out to length characters */
+extern int get6bitcode(char c);
+extern void put6bitschars(char *buf, unsigned int start, unsigned int length, char *str);
+
 #endif /* _GPSD_BITS_H_ */
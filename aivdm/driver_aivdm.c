@@ -5,7 +5,7 @@
 *
 * Code for message types 1-15, 18-21, and 24 has been tested against
 * live data with known-good decodings. Code for message types 16-17,
-* 22-23, and 25-26 has not.
+* 22-23, and 25-27 has not.
 *
 * This file is Copyright (c) 2010 by the GPSD project
 * BSD terms apply: see the file COPYING in the distribution root for details.
@@ -21,184 +21,818 @@
 
 #include "aivdm.h"
 #include "bits.h"
+#include "sixbit.h"
+#include "nmea.h"
 
-/**
-* Parse the data from the device
-*/
+static void put_bitdata(struct bitwriter_t *bw, const char *data, size_t bitcount)
+/* append bitcount bits of a binary payload, wherever the writer stands */
+{
+	bw_put_bits(bw, (const unsigned char *)data, 0, bitcount);
+}
 
-static void from_sixbit(char *bitvec, unsigned int start, int count, char *to)
-{
-	/*@ +type @*/
-#ifdef S_SPLINT_S
-	/* the real string causes a splint internal error */
-	const char sixchr[] = "abcd";
-#else
-	const char sixchr[64] =
-		"@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^- !\"#$%&`()*+,-./0123456789:;<=>?";
-#endif /* S_SPLINT_S */
-	int i;
-	char newchar;
-
-	/* six-bit to ASCII */
-	for (i = 0; i < count - 1; i++) {
-		newchar = sixchr[ubits(bitvec, start + 6 * i, 6U)];
-		if (newchar == '@')
-			break;
-		else
-			to[i] = newchar;
-	}
-	to[i] = '\0';
-	/* trim spaces on right end */
-	for (i = count - 2; i >= 0; i--)
-		if (to[i] == ' ' || to[i] == '@')
-			to[i] = '\0';
-		else
-			break;
-	/*@ -type @*/
+static size_t binary_bitlen(int addressed, int structured, size_t bitcount)
+/* type 25/26 message length through the data, as the decoder will see it */
+{
+	return 40 + (addressed ? 30 : 0) + (structured ? 16 : 0) + bitcount;
 }
 
-char calculate_nmea_checksum(char * str, int len)
+static void put_spare(struct bitwriter_t *bw, unsigned int align)
+/* zero-fill up to the next multiple of align bits */
 {
-	char rt = str[1];
-	int i;
-	for(i=2; i<len; i++)
-	{
-		rt ^= str[i];
-	}
-	sprintf(&str[len],"*%02X", rt);
-	return rt;
+	unsigned int rem = (unsigned int)(bw_bitlen(bw) % align);
+
+	if (rem != 0)
+		bw_put(bw, align - rem, 0);
 }
 
-int aivdm_encode(struct ais_t *ais, char * out1, char * out2)
+/*
+ * Schema rows to encoder statements.  Each one range-checks the member
+ * and appends it; the enclosing function returns the id of the first
+ * field that does not fit.
+ */
+#define AIS_ENCODE_UINT(arm, member, start, width) \
+	if ((uint64_t)ais->AIS_ARM_##arm.member >> (width)) \
+		return AIS_FIELD_##arm##_##member; \
+	bw_put(bw, width, ais->AIS_ARM_##arm.member);
+#define AIS_ENCODE_SINT(arm, member, start, width) \
+	if (ais->AIS_ARM_##arm.member < -(1L << ((width) - 1)) \
+	    || ais->AIS_ARM_##arm.member >= (1L << ((width) - 1))) \
+		return AIS_FIELD_##arm##_##member; \
+	bw_put(bw, width, (uint64_t)ais->AIS_ARM_##arm.member);
+#define AIS_ENCODE_FLAG(arm, member, start, width) \
+	bw_put(bw, width, (uint64_t)(ais->AIS_ARM_##arm.member != 0));
+#define AIS_ENCODE_TEXT(arm, member, start, width) \
+	sixbit_put_text(bw, ais->AIS_ARM_##arm.member, width);
+#define AIS_ENCODE_SPARE(arm, member, start, width) \
+	bw_put(bw, width, 0);
+#define AIS_ENCODE(arm, member, start, width, kind) \
+	AIS_ENCODE_##kind(arm, member, start, width)
+
+static int encode_fields(const struct ais_t *ais, struct bitwriter_t *bw)
+/* append the payload of ais; -1 on success, else the id of a bad field */
 {
-	char buf[512],ch;
-	int ci;
-	int k;
-	char msgHead1[14]="!AIVDM,1,1,,A,";
-	char msgHead2[15]="!AIVDM,2,1,1,A,";
-	char msgHead3[15]="!AIVDM,2,2,1,A,";
-	long long lk;
-	memset(buf, 0, 512);
-	memset(out1, 0, 256);
-	memset(out2, 0, 256);
-	putbits(buf,0,6,ais->type);
-	putbits(buf,6,2,ais->repeat);
-	putbits(buf,8,30,ais->mmsi);
-
-	k = -127;
-	lk = (long long)k;
-
-	//#define LUBITS(s, l)	ubits(buf, s, l)
-	//#define LSBITS(s, l)	sbits(buf, s, l)
-	//#define LUCHARS(s, to)	from_sixbit((char *)buf, s, sizeof(to), to)
-
-
-	switch(ais->type)// = UBITS(0, 6);
-	{
-		case 1:
-		case 2:
-		case 3:
-			{
-				putbits(buf,38, 4,(long long)ais->type1.status);
-				putbits(buf,42, 8,(long long)ais->type1.turn);
-				putbits(buf,50, 10,(long long)ais->type1.speed);
-				putbits(buf,60, 1,(long long)ais->type1.accuracy);
-				putbits(buf,61, 28,(long long)ais->type1.lon);
-				putbits(buf,89, 27,(long long)ais->type1.lat);
-				putbits(buf,116, 12,(long long)ais->type1.course);
-				putbits(buf,128, 9,(long long)ais->type1.heading);
-				putbits(buf,137, 6,(long long)ais->type1.second);
-				putbits(buf,143, 2,(long long)ais->type1.maneuver);
-				//ais->type1.spare	= UBITS(145, 3);
-				putbits(buf,148, 1,(long long)ais->type1.raim);
-				putbits(buf,149, 20,(long long)ais->type1.radio);
-
-				memcpy(out1,msgHead1,14);
-
-				for (ci = 0; ci < 28; ++ci) {
-					ch = (char)ubits(buf, 0+ci*6, 6);
-					ch += 48;
-
-					if (ch >= 88)
-						ch += 8;
-
-					out1[14+ci] = ch;
-				}
-				out1[14+ci] = ',';
-				out1[15+ci] = '0';
-
-				calculate_nmea_checksum(out1,strlen(out1));
+	unsigned int n;
+	size_t len;
+
+	if (ais->type >> 6)
+		return AIS_FIELD_type;
+	if (ais->repeat >> 2)
+		return AIS_FIELD_repeat;
+	if (ais->mmsi >> 30)
+		return AIS_FIELD_mmsi;
+	bw_put(bw, 6, ais->type);
+	bw_put(bw, 2, ais->repeat);
+	bw_put(bw, 30, ais->mmsi);
+
+	/* layouts live in aivdm_schema.h, shared with aivdm_decode() below */
+	switch (ais->type) {
+	case 1:	/* Position Report */
+	case 2:
+	case 3:
+		AIS_TYPE1_FIELDS(AIS_ENCODE)
+		break;
+	case 4:	/* Base Station Report */
+	case 11:	/* UTC/Date Response */
+		AIS_TYPE4_FIELDS(AIS_ENCODE)
+		break;
+	case 5: /* Ship static and voyage related data */
+		AIS_TYPE5_FIELDS(AIS_ENCODE)
+		break;
+	case 6: /* Addressed Binary Message */
+		if (ais->type6.bitcount > AIS_TYPE6_BINARY_MAX)
+			return AIS_FIELD_PAYLOAD;
+		AIS_TYPE6_FIELDS(AIS_ENCODE)
+		put_bitdata(bw, ais->type6.bitdata, ais->type6.bitcount);
+		break;
+	case 7: /* Binary acknowledge */
+	case 13: /* Safety Related Acknowledge */
+		/* one to four acknowledged stations */
+		n = ais->type7.mmsi4 ? 4 : ais->type7.mmsi3 ? 3 : ais->type7.mmsi2 ? 2 : 1;
+		AIS_TYPE7_FIELDS(AIS_ENCODE)
+		if (n >= 2) {
+			AIS_TYPE7_ACK2_FIELDS(AIS_ENCODE)
+		}
+		if (n >= 3) {
+			AIS_TYPE7_ACK3_FIELDS(AIS_ENCODE)
+		}
+		if (n >= 4) {
+			AIS_TYPE7_ACK4_FIELDS(AIS_ENCODE)
+		}
+		break;
+	case 8: /* Binary Broadcast Message */
+		if (ais->type8.bitcount > AIS_TYPE8_BINARY_MAX)
+			return AIS_FIELD_PAYLOAD;
+		AIS_TYPE8_FIELDS(AIS_ENCODE)
+		put_bitdata(bw, ais->type8.bitdata, ais->type8.bitcount);
+		break;
+	case 9: /* Standard SAR Aircraft Position Report */
+		AIS_TYPE9_FIELDS(AIS_ENCODE)
+		break;
+	case 10: /* UTC/Date inquiry */
+		AIS_TYPE10_FIELDS(AIS_ENCODE)
+		break;
+	case 12: /* Safety Related Message */
+		AIS_TYPE12_FIELDS(AIS_ENCODE)
+		len = strlen(ais->type12.text);
+		sixbit_put_text(bw, ais->type12.text, (unsigned int)len);
+		break;
+	case 14:	/* Safety Related Broadcast Message */
+		AIS_TYPE14_FIELDS(AIS_ENCODE)
+		len = strlen(ais->type14.text);
+		sixbit_put_text(bw, ais->type14.text, (unsigned int)len);
+		break;
+	case 15:	/* Interrogation */
+		AIS_TYPE15_FIELDS(AIS_ENCODE)
+		if (ais->type15.type1_2 || ais->type15.offset1_2 || ais->type15.mmsi2) {
+			AIS_TYPE15_REQ2_FIELDS(AIS_ENCODE)
+			if (ais->type15.mmsi2) {
+				AIS_TYPE15_STATION2_FIELDS(AIS_ENCODE)
 			}
-			break;
-		case 5:
-			{
-				putbits(buf,38, 2,(long long)ais->type5.ais_version);
-				putbits(buf,40, 30,(long long)ais->type5.imo);
+		}
+		break;
+	case 16:	/* Assigned Mode Command */
+		AIS_TYPE16_FIELDS(AIS_ENCODE)
+		if (ais->type16.mmsi2) {
+			AIS_TYPE16_STATION2_FIELDS(AIS_ENCODE)
+		} else {
+			AIS_TYPE16_PAD_FIELDS(AIS_ENCODE)
+		}
+		break;
+	case 17:	/* GNSS Broadcast Binary Message */
+		if (ais->type17.bitcount > AIS_TYPE17_BINARY_MAX)
+			return AIS_FIELD_PAYLOAD;
+		AIS_TYPE17_FIELDS(AIS_ENCODE)
+		put_bitdata(bw, ais->type17.bitdata, ais->type17.bitcount);
+		break;
+	case 18:	/* Standard Class B CS Position Report */
+		AIS_TYPE18_FIELDS(AIS_ENCODE)
+		break;
+	case 19:	/* Extended Class B CS Position Report */
+		AIS_TYPE19_FIELDS(AIS_ENCODE)
+		break;
+	case 20:	/* Data Link Management Message */
+		/* as many slot blocks as are in use, at least one */
+		n = ais->type20.offset4 || ais->type20.number4 || ais->type20.timeout4 || ais->type20.increment4 ? 4
+		  : ais->type20.offset3 || ais->type20.number3 || ais->type20.timeout3 || ais->type20.increment3 ? 3
+		  : ais->type20.offset2 || ais->type20.number2 || ais->type20.timeout2 || ais->type20.increment2 ? 2
+		  : 1;
+		AIS_TYPE20_FIELDS(AIS_ENCODE)
+		if (n >= 2) {
+			AIS_TYPE20_BLOCK2_FIELDS(AIS_ENCODE)
+		}
+		if (n >= 3) {
+			AIS_TYPE20_BLOCK3_FIELDS(AIS_ENCODE)
+		}
+		if (n >= 4) {
+			AIS_TYPE20_BLOCK4_FIELDS(AIS_ENCODE)
+		}
+		put_spare(bw, 8);
+		break;
+	case 21:	/* Aid-to-Navigation Report */
+		AIS_TYPE21_FIELDS(AIS_ENCODE)
+		/* names longer than 20 characters continue in the extension field */
+		len = strlen(ais->type21.name);
+		if (len > 20) {
+			if (len > 34)
+				len = 34;
+			sixbit_put_text(bw, ais->type21.name + 20, (unsigned int)(len - 20));
+			put_spare(bw, 8);
+		}
+		break;
+	case 22:	/* Channel Management */
+		AIS_TYPE22_FIELDS(AIS_ENCODE)
+		if (ais->type22.addressed) {
+			AIS_TYPE22_DEST_FIELDS(AIS_ENCODE)
+		} else {
+			AIS_TYPE22_AREA_FIELDS(AIS_ENCODE)
+		}
+		AIS_TYPE22_TAIL_FIELDS(AIS_ENCODE)
+		break;
+	case 23:	/* Group Assignment Command */
+		AIS_TYPE23_FIELDS(AIS_ENCODE)
+		break;
+	case 24:	/* Class B CS Static Data Report */
+		AIS_TYPE24_FIELDS(AIS_ENCODE)
+		if (ais->type24.part == AIS_TYPE24_PART_A) {
+			AIS_TYPE24A_FIELDS(AIS_ENCODE)
+		} else if (ais->type24.part == AIS_TYPE24_PART_B) {
+			AIS_TYPE24B_FIELDS(AIS_ENCODE)
+			if (AIS_AUXILIARY_MMSI(ais->mmsi)) {
+				AIS_TYPE24B_MOTHERSHIP_FIELDS(AIS_ENCODE)
+			} else {
+				AIS_TYPE24B_DIM_FIELDS(AIS_ENCODE)
+			}
+			AIS_TYPE24B_TAIL_FIELDS(AIS_ENCODE)
+		} else
+			return AIS_FIELD_type24_part;
+		break;
+	case 25:	/* Binary Message, Single Slot */
+		if (ais->type25.bitcount > AIS_TYPE25_BINARY_MAX
+				|| !aivdm_bitlen_ok(25, binary_bitlen(ais->type25.addressed,
+						ais->type25.structured, ais->type25.bitcount)))
+			return AIS_FIELD_PAYLOAD;
+		AIS_TYPE25_FIELDS(AIS_ENCODE)
+		if (ais->type25.addressed) {
+			AIS_TYPE25_DEST_FIELDS(AIS_ENCODE)
+		}
+		if (ais->type25.structured) {
+			AIS_TYPE25_APP_FIELDS(AIS_ENCODE)
+		}
+		put_bitdata(bw, ais->type25.bitdata, ais->type25.bitcount);
+		break;
+	case 26:	/* Binary Message, Multiple Slot */
+		/* the radio status follows the data */
+		if (ais->type26.bitcount > AIS_TYPE26_BINARY_MAX
+				|| !aivdm_bitlen_ok(26, binary_bitlen(ais->type26.addressed,
+						ais->type26.structured, ais->type26.bitcount) + 20))
+			return AIS_FIELD_PAYLOAD;
+		AIS_TYPE26_FIELDS(AIS_ENCODE)
+		if (ais->type26.addressed) {
+			AIS_TYPE26_DEST_FIELDS(AIS_ENCODE)
+		}
+		if (ais->type26.structured) {
+			AIS_TYPE26_APP_FIELDS(AIS_ENCODE)
+		}
+		put_bitdata(bw, ais->type26.bitdata, ais->type26.bitcount);
+		AIS_TYPE26_RADIO_FIELDS(AIS_ENCODE)
+		break;
+	case 27:	/* Long Range AIS Broadcast message */
+		AIS_TYPE27_FIELDS(AIS_ENCODE)
+		break;
+	default:
+		return AIS_FIELD_type;
+	}
+	return -1;
+}
+
+size_t aivdm_encode_payload(const struct ais_t *ais, unsigned char *bits)
+{
+	struct bitwriter_t bw;
+
+	bw_init(&bw, bits);
+	if (encode_fields(ais, &bw) >= 0)
+		return 0;
+	return bw_finish(&bw);
+}
 
-				put6bitschars(buf,70, 7,(char *)ais->type5.callsign);
-				put6bitschars(buf,112, 20,(char *)ais->type5.shipname);
+int aivdm_validate(const struct ais_t *ais)
+{
+	unsigned char scratch[AIVDM_ENCODE_BUFSIZE];
+	struct bitwriter_t bw;
 
-				putbits(buf,232, 8,(long long)ais->type5.shiptype);
+	bw_init(&bw, scratch);
+	return encode_fields(ais, &bw);
+}
 
-				putbits(buf,240, 9,(long long)ais->type5.to_bow);
-				putbits(buf,249, 9,(long long)ais->type5.to_stern);
-				putbits(buf,258, 6,(long long)ais->type5.to_port);
-				putbits(buf,264, 6,(long long)ais->type5.to_starboard);
+static const char hexdigits[] = "0123456789ABCDEF";
 
-				putbits(buf,270, 4,(long long)ais->type5.epfd);
+static size_t put_sentence(char *out, const char *head, size_t headlen,
+			   unsigned int headsum, const unsigned char *bits,
+			   size_t bitlen, unsigned int nchars)
+/* head, armored bits and ",pad*hh"; the checksum builds up as characters go out */
+{
+	unsigned int sum, pad = (unsigned int)(nchars * 6 - bitlen);
+	size_t n;
 
-				putbits(buf,274, 4,(long long)ais->type5.month);		
-				putbits(buf,278, 5,(long long)ais->type5.day);
-				putbits(buf,283, 5,(long long)ais->type5.hour);
-				putbits(buf,288, 6,(long long)ais->type5.minute);
+	memcpy(out, head, headlen);
+	n = headlen + aivdm_armor_sum(bits, bitlen, out + headlen, &sum);
+	sum ^= headsum ^ ',' ^ ('0' + pad);
+	out[n++] = ',';
+	out[n++] = (char)('0' + pad);
+	out[n++] = '*';
+	out[n++] = hexdigits[sum >> 4];
+	out[n++] = hexdigits[sum & 0x0f];
+	return n;
+}
 
-				putbits(buf,294, 8,(long long)ais->type5.draught);
-				put6bitschars(buf,302, 20,(char *)ais->type5.destination);
+void aivdm_sentence_opts_init(struct aivdm_sentence_opts_t *opts)
+{
+	opts->talker = "AIVDM";
+	opts->channel = 'A';
+	opts->seqid = 1;
+	opts->maxchars = AIVDM_MAX_PAYLOAD_CHARS;
+	opts->flags = 0;
+}
 
-				putbits(buf,422, 1,(long long)ais->type5.dte);
+/* per-call framing state, set up once and reused across a batch */
+struct framing_t {
+	const struct aivdm_sentence_opts_t *opts;
+	size_t maxchars;	/* payload characters per sentence */
+	const char *term;	/* sentence terminator */
+	size_t termlen;
+	char head[16];		/* last header built, and what it was built for */
+	size_t headlen;
+	unsigned int headsum;	/* its checksum without the fragment number */
+	int headfrags, headseq;
+	char headchan;
+	unsigned char buf[AIVDM_ENCODE_BUFSIZE];	/* payload scratch */
+};
 
-				memcpy(out1,msgHead2,15);
+static int framing_init(struct framing_t *fr,
+			const struct aivdm_sentence_opts_t *opts,
+			const char *term, size_t termlen)
+{
+	if (strlen(opts->talker) != 5)
+		return 0;
+	fr->opts = opts;
+	/* whole bytes per fragment, so every fragment armors straight from buf */
+	fr->maxchars = opts->maxchars;
+	if (fr->maxchars == 0 || fr->maxchars > AIVDM_MAX_PAYLOAD_CHARS)
+		fr->maxchars = AIVDM_MAX_PAYLOAD_CHARS;
+	fr->maxchars &= ~(size_t)3;
+	if (fr->maxchars == 0)
+		fr->maxchars = 4;
+	fr->term = term;
+	fr->termlen = termlen;
+	fr->headfrags = 0;
+	return 1;
+}
 
-				for (ci = 0; ci < 60; ++ci) {
-					ch = (char)ubits(buf, ci*6, 6);
-					ch += 48;
+static void build_head(struct framing_t *fr, int nfrags)
+/* "!AIVDM,n,m,s,c," with the fragment number m filled in per sentence */
+{
+	const struct aivdm_sentence_opts_t *opts = fr->opts;
+	char *head = fr->head;
+	size_t n, headlen;
 
-					if (ch >= 88)
-						ch += 8;
+	head[0] = '!';
+	memcpy(head + 1, opts->talker, 5);
+	headlen = 6;
+	head[headlen++] = ',';
+	head[headlen++] = (char)('0' + nfrags);
+	head[headlen++] = ',';
+	head[headlen++] = '\0';
+	head[headlen++] = ',';
+	if (nfrags > 1)
+		head[headlen++] = (char)('0' + opts->seqid);
+	head[headlen++] = ',';
+	if (opts->channel != '\0')
+		head[headlen++] = opts->channel;
+	head[headlen++] = ',';
+	fr->headlen = headlen;
+	fr->headsum = 0;
+	for (n = 1; n < headlen; n++)
+		fr->headsum ^= (unsigned char)head[n];
+	fr->headfrags = nfrags;
+	fr->headseq = opts->seqid;
+	fr->headchan = opts->channel;
+}
 
-					out1[15+ci] = ch;
-				}
-				out1[15+ci] = ',';
-				out1[16+ci] = '0';
+static int encode_frames(struct framing_t *fr, const struct ais_t *ais,
+			 char *out, size_t outlen, size_t *lens, int maxfrags,
+			 size_t *used)
+/*
+ * the sentences of ais, each followed by the terminator; returns how
+ * many, 0 if ais cannot be sent, -1 if outlen is too small
+ */
+{
+	const struct aivdm_sentence_opts_t *opts = fr->opts;
+	size_t bitlen, nchars, maxchars = fr->maxchars, chunk, n, total = 0;
+	int nfrags, frag;
 
-				memcpy(out2,msgHead3,15);
-				for (ci = 0; ci < 11; ++ci) {
-					ch = (char)ubits(buf, (ci+60)*6, 6);
-					ch += 48;
+	bitlen = aivdm_encode_payload(ais, fr->buf);
+	if (bitlen == 0)
+		return 0;
+	nchars = (bitlen + 5) / 6;
+	nfrags = (int)((nchars + maxchars - 1) / maxchars);
+	if (nfrags > maxfrags || nfrags > AIVDM_MAX_FRAGMENTS)
+		return 0;
+	if (nfrags > 1 && (opts->seqid < 0 || opts->seqid > 9))
+		return 0;
+	if (nfrags != fr->headfrags || opts->channel != fr->headchan
+			|| (nfrags > 1 && opts->seqid != fr->headseq))
+		build_head(fr, nfrags);
 
-					if (ch >= 88)
-						ch += 8;
+	for (frag = 0; frag < nfrags; frag++) {
+		chunk = nchars - frag * maxchars;
+		if (chunk > maxchars)
+			chunk = maxchars;
+		/* header, payload, ",p*hh" and terminator */
+		if (total + fr->headlen + chunk + 5 + fr->termlen > outlen)
+			return -1;
+		fr->head[9] = (char)('1' + frag);
+		n = put_sentence(out + total, fr->head, fr->headlen,
+				 fr->headsum ^ (unsigned char)fr->head[9],
+				 fr->buf + frag * maxchars * 6 / 8,
+				 frag == nfrags - 1 ? bitlen - frag * maxchars * 6 : chunk * 6,
+				 (unsigned int)chunk);
+		memcpy(out + total + n, fr->term, fr->termlen);
+		n += fr->termlen;
+		if (lens != NULL)
+			lens[frag] = n;
+		total += n;
+	}
+	*used = total;
+	return nfrags;
+}
+
+static void advance_opts(struct aivdm_sentence_opts_t *opts, int nfrags)
+/* step sequence id and channel for the next message as flagged */
+{
+	if (nfrags > 1 && (opts->flags & AIVDM_OPT_ROTATE_SEQID))
+		opts->seqid = (opts->seqid + 1) % 10;
+	if (opts->flags & AIVDM_OPT_ALTERNATE_CHANNEL) {
+		if (opts->channel == 'A')
+			opts->channel = 'B';
+		else if (opts->channel == 'B')
+			opts->channel = 'A';
+	}
+}
+
+int aivdm_encode_sentences(const struct ais_t *ais,
+			   struct aivdm_sentence_opts_t *opts,
+			   char *out, size_t outlen,
+			   size_t *lens, int maxfrags)
+{
+	struct framing_t fr;
+	size_t used;
+	int nfrags;
+
+	if (!framing_init(&fr, opts, "\r\n", 2))
+		return 0;
+	nfrags = encode_frames(&fr, ais, out, outlen, lens, maxfrags, &used);
+	if (nfrags <= 0)
+		return 0;
+	advance_opts(opts, nfrags);
+	return nfrags;
+}
+
+size_t aivdm_encode_to(const struct ais_t *ais,
+		       struct aivdm_sentence_opts_t *opts,
+		       char *out, size_t outlen)
+{
+	struct aivdm_sentence_opts_t defaults;
+	struct framing_t fr;
+	size_t used;
+	int nfrags;
 
-					out2[15+ci] = ch;
-				}
-				out2[15+ci] = ',';
-				out2[16+ci] = '2';
+	if (opts == NULL) {
+		aivdm_sentence_opts_init(&defaults);
+		opts = &defaults;
+	}
+	if (!framing_init(&fr, opts, "\r\n", 2))
+		return 0;
+	nfrags = encode_frames(&fr, ais, out, outlen, NULL,
+			       AIVDM_MAX_FRAGMENTS, &used);
+	if (nfrags <= 0)
+		return 0;
+	advance_opts(opts, nfrags);
+	return used;
+}
 
-				calculate_nmea_checksum(out1,strlen(out1));
-				calculate_nmea_checksum(out2,strlen(out2));
+size_t aivdm_encode_batch(const struct ais_t *ais, size_t n,
+			  struct aivdm_sentence_opts_t *opts,
+			  char *out, size_t outlen, size_t *offsets)
+{
+	struct aivdm_sentence_opts_t defaults;
+	struct framing_t fr;
+	size_t i, used, total = 0;
+	int nfrags;
+
+	if (opts == NULL) {
+		aivdm_sentence_opts_init(&defaults);
+		opts = &defaults;
+	}
+	offsets[0] = 0;
+	if (!framing_init(&fr, opts, "\r\n", 2))
+		return 0;
+	for (i = 0; i < n; i++) {
+		nfrags = encode_frames(&fr, ais + i, out + total, outlen - total,
+				       NULL, AIVDM_MAX_FRAGMENTS, &used);
+		if (nfrags < 0)
+			break;
+		if (nfrags > 0) {
+			advance_opts(opts, nfrags);
+			total += used;
+		}
+		offsets[i + 1] = total;
+	}
+	return i;
+}
+
+int aivdm_encode(struct ais_t *ais, char * out1, char * out2)
+{
+	struct aivdm_sentence_opts_t opts;
+	struct framing_t fr;
+	char buf[2 * AIVDM_SENTENCE_MAX];
+	size_t lens[2], used;
+
+	/* at most two sentences, channel A, sequence id 1, NUL-terminated */
+	aivdm_sentence_opts_init(&opts);
+	(void)framing_init(&fr, &opts, "", 1);
+	switch (encode_frames(&fr, ais, buf, sizeof(buf), lens, 2, &used)) {
+	case 1:
+		memcpy(out1, buf, lens[0]);
+		out2[0] = '\0';
+		return 1;
+	case 2:
+		memcpy(out1, buf, lens[0]);
+		memcpy(out2, buf + lens[0], lens[1]);
+		return 1;
+	default:
+		out1[0] = out2[0] = '\0';
+		return 0;
+	}
+}
+
+static int decode_payload(const unsigned char *bits, size_t bitlen,
+			  const struct aivdm_filter_t *filter,
+			  const struct aivdm_projection_t *projection,
+			  char *shipname, struct aivdm_type24_cache_t *type24,
+			  struct aivdm_payload_t *payload, struct ais_t *ais)
+/*
+ * A complete payload, with the slack past bitlen zeroed; returns an
+ * AIVDM_STATUS_* code.  Type 24 halves are paired through type24 if
+ * there is one, otherwise through the single shipname buffer.  Binary
+ * data is described in payload, pointing into bits, if that is given,
+ * and otherwise copied into ais.
+ */
+{
+	unsigned int shift;
+
+	/* unwanted messages leave ais untouched */
+	if (filter != NULL && !aivdm_filter_match(filter, bits, bitlen))
+		return AIVDM_STATUS_FILTERED;
+
+#define UBITS(s, l)	ubits_fast(bits, s, l)
+#define SBITS(s, l)	sbits_fast(bits, s, l)
+/* binary data from bit offset on: a view or a copy, see above */
+#define PAYLOAD(arm, offset) \
+	if (payload != NULL) { \
+		payload->bits = bits; \
+		payload->start = (unsigned short)(offset); \
+		payload->bitcount = (unsigned short)ais->arm.bitcount; \
+	} else \
+		copy_bits((unsigned char *)ais->arm.bitdata, bits, \
+				offset, ais->arm.bitcount);
+/* six-bit characters in nbits, limited to what fits in array to */
+#define TEXT_CHARS(nbits, to)	((unsigned int)((nbits) / 6 < sizeof(to) - 1 ? (nbits) / 6 : sizeof(to) - 1))
+/* schema rows to decoder statements */
+#define AIS_DECODE_UINT(arm, member, start, width) \
+	ais->AIS_ARM_##arm.member = (unsigned int)UBITS(start, width);
+#define AIS_DECODE_SINT(arm, member, start, width) \
+	ais->AIS_ARM_##arm.member = (int)SBITS(start, width);
+#define AIS_DECODE_FLAG(arm, member, start, width) \
+	ais->AIS_ARM_##arm.member = UBITS(start, width) != 0;
+#define AIS_DECODE_TEXT(arm, member, start, width) \
+	(void)sixbit_get_text(bits, start, width, ais->AIS_ARM_##arm.member);
+#define AIS_DECODE_SPARE(arm, member, start, width)
+#define AIS_DECODE(arm, member, start, width, kind) \
+	AIS_DECODE_##kind(arm, member, start, width)
+/* the same for rows whose start moves with earlier optional fields */
+#define AIS_DECODE_SHIFTED(arm, member, start, width, kind) \
+	AIS_DECODE_##kind(arm, member, shift + (start), width)
+
+	ais->type = UBITS(0, 6);
+	ais->repeat = UBITS(6, 2);
+	ais->mmsi = UBITS(8, 30);
+	/* the schema bounds every type's length, unknown types included */
+	if (!aivdm_bitlen_ok(ais->type, bitlen)) {
+		//printf("AIVDM message type %d size is out of range (%zd).\n",
+		//	ais->type, bitlen);
+		return AIVDM_STATUS_REJECTED;
+	}
+	if (projection != NULL) {
+		aivdm_project(projection, bits, bitlen, ais);
+		return AIVDM_STATUS_DECODED;
+	}
+	//printf("AIVDM message type %d, MMSI %09d:\n",
+	//	ais->type, ais->mmsi);
+	/*
+	 * Something about the shape of this switch statement confuses
+	 * GNU indent so badly that there is no point in trying to be
+	 * finer-grained than leaving it all alone.
+	 */
+	/* *INDENT-OFF* */
+	switch (ais->type) {
+		case 1:	/* Position Report */
+		case 2:
+		case 3:
+			AIS_TYPE1_FIELDS(AIS_DECODE)
+			break;
+		case 4: 	/* Base Station Report */
+		case 11:	/* UTC/Date Response */
+			AIS_TYPE4_FIELDS(AIS_DECODE)
+			break;
+		case 5: /* Ship static and voyage related data */
+			AIS_TYPE5_FIELDS(AIS_DECODE)
+			break;
+		case 6: /* Addressed Binary Message */
+			AIS_TYPE6_FIELDS(AIS_DECODE)
+			ais->type6.bitcount       = bitlen - 88;
+			PAYLOAD(type6, 88)
+			break;
+		case 7: /* Binary acknowledge */
+		case 13: /* Safety Related Acknowledge */
+			(void)memset(&ais->type7, '\0', sizeof(ais->type7));
+			AIS_TYPE7_FIELDS(AIS_DECODE)
+			if (bitlen >= 104) {
+				AIS_TYPE7_ACK2_FIELDS(AIS_DECODE)
+			}
+			if (bitlen >= 136) {
+				AIS_TYPE7_ACK3_FIELDS(AIS_DECODE)
+			}
+			if (bitlen >= 168) {
+				AIS_TYPE7_ACK4_FIELDS(AIS_DECODE)
 			}
 			break;
+		case 8: /* Binary Broadcast Message */
+			AIS_TYPE8_FIELDS(AIS_DECODE)
+			ais->type8.bitcount       = bitlen - 56;
+			PAYLOAD(type8, 56)
+			break;
+		case 9: /* Standard SAR Aircraft Position Report */
+			AIS_TYPE9_FIELDS(AIS_DECODE)
+			break;
+		case 10: /* UTC/Date inquiry */
+			AIS_TYPE10_FIELDS(AIS_DECODE)
+			break;
+		case 12: /* Safety Related Message */
+			AIS_TYPE12_FIELDS(AIS_DECODE)
+			(void)sixbit_get_text(bits, 72,
+					TEXT_CHARS(bitlen - 72,
+						   ais->type12.text),
+					ais->type12.text);
+			break;
+		case 14:	/* Safety Related Broadcast Message */
+			AIS_TYPE14_FIELDS(AIS_DECODE)
+			(void)sixbit_get_text(bits, 40,
+					TEXT_CHARS(bitlen - 40,
+						   ais->type14.text),
+					ais->type14.text);
+			break;
+		case 15:	/* Interrogation */
+			(void)memset(&ais->type15, '\0', sizeof(ais->type15));
+			AIS_TYPE15_FIELDS(AIS_DECODE)
+			if (bitlen >= 110) {
+				AIS_TYPE15_REQ2_FIELDS(AIS_DECODE)
+			}
+			if (bitlen >= 160) {
+				AIS_TYPE15_STATION2_FIELDS(AIS_DECODE)
+			}
+			break;
+		case 16:	/* Assigned Mode Command */
+			if (bitlen != 96 && bitlen != 144)
+				return AIVDM_STATUS_REJECTED;
+			AIS_TYPE16_FIELDS(AIS_DECODE)
+			if (bitlen == 144) {
+				AIS_TYPE16_STATION2_FIELDS(AIS_DECODE)
+			} else
+				ais->type16.mmsi2=ais->type16.offset2=ais->type16.increment2 = 0;
+			break;
+		case 17:	/* GNSS Broadcast Binary Message */
+			AIS_TYPE17_FIELDS(AIS_DECODE)
+			ais->type17.bitcount        = bitlen - 80;
+			PAYLOAD(type17, 80)
+			break;
+		case 18:	/* Standard Class B CS Position Report */
+			AIS_TYPE18_FIELDS(AIS_DECODE)
+			break;
+		case 19:	/* Extended Class B CS Position Report */
+			AIS_TYPE19_FIELDS(AIS_DECODE)
+			break;
+		case 20:	/* Data Link Management Message */
+			(void)memset(&ais->type20, '\0', sizeof(ais->type20));
+			AIS_TYPE20_FIELDS(AIS_DECODE)
+			if (bitlen >= 100) {
+				AIS_TYPE20_BLOCK2_FIELDS(AIS_DECODE)
+			}
+			if (bitlen >= 130) {
+				AIS_TYPE20_BLOCK3_FIELDS(AIS_DECODE)
+			}
+			if (bitlen >= 160) {
+				AIS_TYPE20_BLOCK4_FIELDS(AIS_DECODE)
+			}
+			break;
+		case 21:	/* Aid-to-Navigation Report */
+			AIS_TYPE21_FIELDS(AIS_DECODE)
+			/* a full-length name may continue past the fixed part */
+			if (strlen(ais->type21.name) == 20 && bitlen > 272)
+				(void)sixbit_get_text(bits, 272,
+						(bitlen - 272)/6,
+						ais->type21.name+20);
+			break;
+		case 22:	/* Channel Management */
+			AIS_TYPE22_FIELDS(AIS_DECODE)
+			AIS_TYPE22_TAIL_FIELDS(AIS_DECODE)
+			if (ais->type22.addressed) {
+				AIS_TYPE22_DEST_FIELDS(AIS_DECODE)
+			} else {
+				AIS_TYPE22_AREA_FIELDS(AIS_DECODE)
+			}
+			break;
+		case 23:	/* Group Assignment Command */
+			AIS_TYPE23_FIELDS(AIS_DECODE)
+			break;
+		case 24:	/* Class B CS Static Data Report */
+			AIS_TYPE24_FIELDS(AIS_DECODE)
+			switch (ais->type24.part) {
+				case AIS_TYPE24_PART_A:
+					if (bitlen != 160)
+						return AIVDM_STATUS_REJECTED;
+					AIS_TYPE24A_FIELDS(AIS_DECODE)
+					if (type24 != NULL)
+						return aivdm_type24_merge(type24, ais);
+					(void)strncpy_s(shipname, AIS_SHIPNAME_MAXLEN + 1,
+							ais->type24.shipname,
+							sizeof(ais->type24.shipname));
+					return AIVDM_STATUS_PENDING;	/* data only partially decoded */
+				case AIS_TYPE24_PART_B:
+					if (bitlen != 168)
+						return AIVDM_STATUS_REJECTED;
+					AIS_TYPE24B_FIELDS(AIS_DECODE)
+					if (AIS_AUXILIARY_MMSI(ais->mmsi)) {
+						AIS_TYPE24B_MOTHERSHIP_FIELDS(AIS_DECODE)
+					} else {
+						AIS_TYPE24B_DIM_FIELDS(AIS_DECODE)
+					}
+					if (type24 != NULL)
+						return aivdm_type24_merge(type24, ais);
+					(void)strncpy_s(ais->type24.shipname, sizeof(ais->type24.shipname),
+							shipname,
+							AIS_SHIPNAME_MAXLEN + 1);
+					break;
+				default:
+					return AIVDM_STATUS_REJECTED;
+			}
+			break;
+		case 25:	/* Binary Message, Single Slot */
+			AIS_TYPE25_FIELDS(AIS_DECODE)
+			/* this check rejects line noise */
+			if (bitlen < (40 + (16*ais->type25.structured) + (30*ais->type25.addressed))) {
+				//printf("AIVDM message type 25 too short for mode.\n");
+				return AIVDM_STATUS_REJECTED;
+			}
+			shift = 30 * ais->type25.addressed;
+			if (ais->type25.addressed) {
+				AIS_TYPE25_DEST_FIELDS(AIS_DECODE)
+			}
+			if (ais->type25.structured) {
+				AIS_TYPE25_APP_FIELDS(AIS_DECODE_SHIFTED)
+			}
+			/* data follows whatever of the two is present, off a byte boundary if addressed */
+			shift = 40 + 30*ais->type25.addressed + 16*ais->type25.structured;
+			ais->type25.bitcount       = bitlen - shift;
+			PAYLOAD(type25, shift)
+			break;
+		case 26:	/* Binary Message, Multiple Slot */
+			AIS_TYPE26_FIELDS(AIS_DECODE)
+			if (bitlen < (60 + (16*ais->type26.structured) + (30*ais->type26.addressed)))
+				return AIVDM_STATUS_REJECTED;
+			shift = 30 * ais->type26.addressed;
+			if (ais->type26.addressed) {
+				AIS_TYPE26_DEST_FIELDS(AIS_DECODE)
+			}
+			if (ais->type26.structured) {
+				AIS_TYPE26_APP_FIELDS(AIS_DECODE_SHIFTED)
+			}
+			/* as for type 25, and the radio status ends it */
+			shift = 40 + 30*ais->type26.addressed + 16*ais->type26.structured;
+			ais->type26.bitcount        = bitlen - 20 - shift;
+			PAYLOAD(type26, shift)
+			shift = (unsigned int)bitlen - 20;
+			AIS_TYPE26_RADIO_FIELDS(AIS_DECODE_SHIFTED)
+			break;
+		case 27:	/* Long Range AIS Broadcast message */
+			AIS_TYPE27_FIELDS(AIS_DECODE)
+			break;
 	}
-	return 1;
+	/* *INDENT-ON* */
+#undef AIS_DECODE_SHIFTED
+#undef AIS_DECODE
+#undef AIS_DECODE_SPARE
+#undef AIS_DECODE_TEXT
+#undef AIS_DECODE_FLAG
+#undef AIS_DECODE_SINT
+#undef AIS_DECODE_UINT
+#undef TEXT_CHARS
+#undef PAYLOAD
+#undef SBITS
+#undef UBITS
+
+	/* data is fully decoded */
+	return AIVDM_STATUS_DECODED;
 }
 
-int aivdm_decode(const char *buf, size_t buflen,
-struct aivdm_context_t *ais_context, struct ais_t *ais)
+/* the fields of one sentence that matter for reassembly, pointing into it */
+struct sentence_t {
+	int await, part;
+	unsigned char channel;	/* '\0' when the field is empty */
+	unsigned char seqid;	/* 0xff when the field is empty */
+	const char *data;
+	size_t datalen;
+	char pad;
+};
+
+static int parse_sentence(const char *buf, size_t buflen, int verify,
+			  struct sentence_t *sentence)
+/*
+ * Locate the packet fields in place, in the same pass that sums the
+ * checksum, so a corrupt sentence is turned away before any decoding.
+ */
 {
-	int nfields = 0;
-	unsigned char *data, *cp = ais_context->fieldcopy;
-	unsigned char ch, pad;
-	int i;
+	struct nmea_scan_t scan;
+	const char *const *field = scan.field;
 
 	if (buflen == 0)
 		return 0;
@@ -206,641 +840,480 @@ struct aivdm_context_t *ais_context, struct ais_t *ais)
 	/* we may need to dump the raw packet */
 	//printf( "AIVDM packet length %d: %s\n", buflen, buf);
 
-	/* extract packet fields */
-	(void)strncpy_s((char *)ais_context->fieldcopy, 91, buf, buflen);
-	ais_context->field[nfields++] = (unsigned char *)buf;
-	for (cp = ais_context->fieldcopy;
-			cp < ais_context->fieldcopy + buflen; cp++)
-		if (*cp == ',') {
-			*cp = '\0';
-			ais_context->field[nfields++] = cp + 1;
-		}
-	ais_context->await = atoi((char *)ais_context->field[1]);
-	ais_context->part = atoi((char *)ais_context->field[2]);
-	data = ais_context->field[5];
-	pad = ais_context->field[6][0];
+	if (nmea_scan(buf, buflen, &scan) < 7)
+		return 0;
+	if (verify && !nmea_checksum_ok(&scan, buf + buflen))
+		return 0;
+	/* atoi() stops at the comma that ends each field */
+	sentence->await = atoi(field[1]);
+	sentence->part = atoi(field[2]);
+	sentence->seqid = (unsigned char)(*field[3] == ',' ? 0xff : atoi(field[3]));
+	sentence->channel = (unsigned char)(*field[4] == ',' ? '\0' : *field[4]);
+	sentence->data = field[5];
+	sentence->datalen = (size_t)(field[6] - 1 - field[5]);
+	sentence->pad = field[6] < buf + buflen ? field[6][0] : '\0';
 	//printf( "await=%d, part=%d, data=%s\n",
-	//	ais_context->await, ais_context->part, data);
+	//	sentence->await, sentence->part, sentence->data);
+	return 1;
+}
+
+static size_t append_payload(unsigned char *bits, size_t bitlen,
+			     const struct sentence_t *sentence)
+/* wacky 6-bit encoding, shades of FIELDATA */
+{
+	bitlen = aivdm_dearmor(bits, bitlen, sentence->data, sentence->datalen);
+	if (isdigit((unsigned char)sentence->pad)
+			&& (size_t)(sentence->pad - '0') <= bitlen)
+		bitlen -= (size_t)(sentence->pad - '0');	/* ASCII assumption */
+	return bitlen;
+}
+
+static int decode_sentence(struct aivdm_context_t *ais_context,
+			   const char *buf, size_t buflen,
+			   struct aivdm_payload_t *payload, struct ais_t *ais)
+/* one sentence, parsed in place; returns an AIVDM_STATUS_* code */
+{
+	struct sentence_t sentence;
+
+	if (!parse_sentence(buf, buflen,
+			(ais_context->flags & AIVDM_DECODE_NOCHECKSUM) == 0, &sentence))
+		return AIVDM_STATUS_REJECTED;
+	ais_context->await = sentence.await;
+	ais_context->part = sentence.part;
 
 	/* assemble the binary data */
-	if (ais_context->part == 1) {
-		(void)memset(ais_context->bits, '\0', sizeof(ais_context->bits));
+	if (ais_context->part == 1)
 		ais_context->bitlen = 0;
+	if (ais_context->bitlen + 6 * sentence.datalen >
+			(sizeof(ais_context->bits) - AIVDM_BITS_SLACK) * 8) {
+		ais_context->bitlen = 0;
+		return AIVDM_STATUS_REJECTED;
 	}
-
-	/* wacky 6-bit encoding, shades of FIELDATA */
-	for (cp = data; cp < data + strlen((char *)data); cp++) {
-		ch = *cp;
-		ch -= 48;
-		if (ch >= 40)
-			ch -= 8;
-		/*@ -shiftnegative @*/
-		for (i = 5; i >= 0; i--) {
-			if ((ch >> i) & 0x01) {
-				ais_context->bits[ais_context->bitlen / 8] |=
-					(1 << (7 - ais_context->bitlen % 8));
-			}
-			ais_context->bitlen++;
-		}
-		/*@ +shiftnegative @*/
-	}
-	if (isdigit(pad))
-		ais_context->bitlen -= (pad - '0');	/* ASCII assumption */
+	ais_context->bitlen = append_payload(ais_context->bits,
+			ais_context->bitlen, &sentence);
 	/*@ -charint @*/
 
 	/* time to pass buffered-up data to where it's actually processed? */
 	if (ais_context->part == ais_context->await) {
-		size_t clen = (ais_context->bitlen + 7) / 8;
-
-#define BITS_PER_BYTE	8
-#define UBITS(s, l)	ubits((char *)ais_context->bits, s, l)
-#define SBITS(s, l)	sbits((char *)ais_context->bits, s, l)
-#define UCHARS(s, to)	from_sixbit((char *)ais_context->bits, s, sizeof(to), to)
-		ais->type = UBITS(0, 6);
-		ais->repeat = UBITS(6, 2);
-		ais->mmsi = UBITS(8, 30);
-		//printf("AIVDM message type %d, MMSI %09d:\n",
-		//	ais->type, ais->mmsi);
-		/*
-		 * Something about the shape of this switch statement confuses
-		 * GNU indent so badly that there is no point in trying to be
-		 * finer-grained than leaving it all alone.
-		 */
-		/* *INDENT-OFF* */
-		switch (ais->type) {
-			case 1:	/* Position Report */
-			case 2:
-			case 3:
-				if (ais_context->bitlen != 168) {
-					//printf("AIVDM message type %d size not 168 bits (%zd).\n",
-					//	ais->type,
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type1.status		= UBITS(38, 4);
-				ais->type1.turn		= SBITS(42, 8);
-				ais->type1.speed		= UBITS(50, 10);
-				ais->type1.accuracy	= (int)UBITS(60, 1);
-				ais->type1.lon		= SBITS(61, 28);
-				ais->type1.lat		= SBITS(89, 27);
-				ais->type1.course		= UBITS(116, 12);
-				ais->type1.heading	= UBITS(128, 9);
-				ais->type1.second		= UBITS(137, 6);
-				ais->type1.maneuver	= UBITS(143, 2);
-				//ais->type1.spare	= UBITS(145, 3);
-				ais->type1.raim		= UBITS(148, 1)!=0;
-				ais->type1.radio		= UBITS(149, 20);
-				//printf(
-				//	"Nav=%d TURN=%d SPEED=%d Q=%d Lon=%f Lat=%f COURSE=%d TH=%d Sec=%d\n",
-				//	ais->type1.status,
-				//	ais->type1.turn,
-				//	ais->type1.speed,
-				//	(unsigned int)ais->type1.accuracy,
-				//	((float)ais->type1.lon)/(10000*60),
-				//	((float)ais->type1.lat)/(10000*60),
-				//	ais->type1.course,
-				//	ais->type1.heading,
-				//	ais->type1.second);
-				break;
-			case 4: 	/* Base Station Report */
-			case 11:	/* UTC/Date Response */
-				if (ais_context->bitlen != 168) {
-					//printf("AIVDM message type %d size not 168 bits (%zd).\n",
-					//	ais->type,
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type4.year		= UBITS(38, 14);
-				ais->type4.month		= UBITS(52, 4);
-				ais->type4.day		= UBITS(56, 5);
-				ais->type4.hour		= UBITS(61, 5);
-				ais->type4.minute		= UBITS(66, 6);
-				ais->type4.second		= UBITS(72, 6);
-				ais->type4.accuracy		= UBITS(78, 1)!=0;
-				ais->type4.lon		= SBITS(79, 28);
-				ais->type4.lat		= SBITS(107, 27);
-				ais->type4.epfd		= UBITS(134, 4);
-				//ais->type4.spare		= UBITS(138, 10);
-				ais->type4.raim		= UBITS(148, 1)!=0;
-				ais->type4.radio		= UBITS(149, 19);
-				//printf(
-				//	"Date: %4d:%02d:%02dT%02d:%02d:%02d Q=%d Lat=%d  Lon=%d epfd=%d\n",
-				//	ais->type4.year,
-				//	ais->type4.month,
-				//	ais->type4.day,
-				//	ais->type4.hour,
-				//	ais->type4.minute,
-				//	ais->type4.second,
-				//	(unsigned int)ais->type4.accuracy,
-				//	ais->type4.lat,
-				//	ais->type4.lon,
-				//	ais->type4.epfd);
-				break;
-			case 5: /* Ship static and voyage related data */
-				if (ais_context->bitlen != 424) {
-					//printf("AIVDM message type 5 size not 424 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type5.ais_version  = UBITS(38, 2);
-				ais->type5.imo          = UBITS(40, 30);
-				UCHARS(70, ais->type5.callsign);
-				UCHARS(112, ais->type5.shipname);
-				ais->type5.shiptype     = UBITS(232, 8);
-				ais->type5.to_bow       = UBITS(240, 9);
-				ais->type5.to_stern     = UBITS(249, 9);
-				ais->type5.to_port      = UBITS(258, 6);
-				ais->type5.to_starboard = UBITS(264, 6);
-				ais->type5.epfd         = UBITS(270, 4);
-				ais->type5.month        = UBITS(274, 4);
-				ais->type5.day          = UBITS(278, 5);
-				ais->type5.hour         = UBITS(283, 5);
-				ais->type5.minute       = UBITS(288, 6);
-				ais->type5.draught      = UBITS(294, 8);
-				UCHARS(302, ais->type5.destination);
-				ais->type5.dte          = UBITS(422, 1);
-				//ais->type5.spare        = UBITS(423, 1);
-				//printf(
-				//	"AIS=%d callsign=%s, name=%s destination=%s\n",
-				//	ais->type5.ais_version,
-				//	ais->type5.callsign,
-				//	ais->type5.shipname,
-				//	ais->type5.destination);
-				break;
-			case 6: /* Addressed Binary Message */
-				if (ais_context->bitlen < 88 || ais_context->bitlen > 1008) {
-					//printf("AIVDM message type 6 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type6.seqno          = UBITS(38, 2);
-				ais->type6.dest_mmsi      = UBITS(40, 30);
-				ais->type6.retransmit     = (int)UBITS(70, 1);
-				//ais->type6.spare        = UBITS(71, 1);
-				ais->type6.app_id         = UBITS(72, 16);
-				ais->type6.bitcount       = ais_context->bitlen - 88;
-				(void)memcpy(ais->type6.bitdata,
-						(char *)ais_context->bits + (88 / BITS_PER_BYTE),
-						(ais->type6.bitcount + 7) / 8);
-				//printf("seqno=%d, dest=%u, id=%u, cnt=%zd\n",
-				//	ais->type6.seqno,
-				//	ais->type6.dest_mmsi,
-				//	ais->type6.app_id,
-				//	ais->type6.bitcount);
-				break;
-			case 7: /* Binary acknowledge */
-			case 13: /* Safety Related Acknowledge */
-				{
-					unsigned int mmsi[4];
-					if (ais_context->bitlen < 72 || ais_context->bitlen > 168) {
-						//printf("AIVDM message type %d size is out of range (%zd).\n",
-						//	ais->type,
-						//	ais_context->bitlen);
-						break;
-					}
-					for (i = 0; i < sizeof(mmsi)/sizeof(mmsi[0]); i++)
-						if (ais_context->bitlen > 40 + 32*i)
-							mmsi[i] = UBITS(40 + 32*i, 30);
-						else
-							mmsi[i] = 0;
-					/*@ -usedef @*/
-					ais->type7.mmsi1 = mmsi[0];
-					ais->type7.mmsi2 = mmsi[1];
-					ais->type7.mmsi3 = mmsi[2];
-					ais->type7.mmsi4 = mmsi[3];
-					/*@ +usedef @*/
-					//printf("\n");
-					break;
-				}
-			case 8: /* Binary Broadcast Message */
-				if (ais_context->bitlen < 56 || ais_context->bitlen > 1008) {
-					//printf("AIVDM message type 8 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				//ais->type8.spare        = UBITS(38, 2);
-				ais->type8.app_id =       UBITS(40, 16);
-				ais->type8.bitcount       = ais_context->bitlen - 56;
-				(void)memcpy(ais->type8.bitdata,
-						(char *)ais_context->bits + (56 / BITS_PER_BYTE),
-						(ais->type8.bitcount + 7) / 8);
-				//printf("id=%u, cnt=%zd\n",
-				//	ais->type8.app_id,
-				//	ais->type8.bitcount);
-				break;
-			case 9: /* Standard SAR Aircraft Position Report */
-				if (ais_context->bitlen != 168) {
-					//printf("AIVDM message type 9 size not 168 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type9.alt		= UBITS(38, 12);
-				ais->type9.speed		= UBITS(50, 10);
-				ais->type9.accuracy		= (int)UBITS(60, 1);
-				ais->type9.lon		= SBITS(61, 28);
-				ais->type9.lat		= SBITS(89, 27);
-				ais->type9.course		= UBITS(116, 12);
-				ais->type9.second		= UBITS(128, 6);
-				ais->type9.regional		= UBITS(134, 8);
-				ais->type9.dte		= UBITS(142, 1);
-				//ais->type9.spare		= UBITS(143, 3);
-				ais->type9.assigned		= UBITS(146, 1)!=0;
-				ais->type9.raim		= UBITS(147, 1)!=0;
-				ais->type9.radio		= UBITS(148, 19);
-				//printf(
-				//	"Alt=%d SPEED=%d Q=%d Lon=%d Lat=%d COURSE=%d Sec=%d\n",
-				//	ais->type9.alt,
-				//	ais->type9.speed,
-				//	(unsigned int)ais->type9.accuracy,
-				//	ais->type9.lon,
-				//	ais->type9.lat,
-				//	ais->type9.course,
-				//	ais->type9.second);
-				break;
-			case 10: /* UTC/Date inquiry */
-				if (ais_context->bitlen != 72) {
-					//printf("AIVDM message type 10 size not 72 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				//ais->type10.spare        = UBITS(38, 2);
-				ais->type10.dest_mmsi      = UBITS(40, 30);
-				//ais->type10.spare2       = UBITS(70, 2);
-				//printf("dest=%u\n", ais->type10.dest_mmsi);
-				break;
-			case 12: /* Safety Related Message */
-				if (ais_context->bitlen < 72 || ais_context->bitlen > 1008) {
-					//printf("AIVDM message type 12 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type12.seqno          = UBITS(38, 2);
-				ais->type12.dest_mmsi      = UBITS(40, 30);
-				ais->type12.retransmit     = (int)UBITS(70, 1);
-				//ais->type12.spare        = UBITS(71, 1);
-				from_sixbit((char *)ais_context->bits,
-						72, ais_context->bitlen-72,
-						ais->type12.text);
-				//printf("seqno=%d, dest=%u\n",
-				//	ais->type12.seqno,
-				//	ais->type12.dest_mmsi);
-				break;
-			case 14:	/* Safety Related Broadcast Message */
-				if (ais_context->bitlen < 40 || ais_context->bitlen > 1008) {
-					//printf("AIVDM message type 14 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				//ais->type14.spare          = UBITS(38, 2);
-				from_sixbit((char *)ais_context->bits,
-						40, ais_context->bitlen-40,
-						ais->type14.text);
-				//printf("\n");
-				break;
-			case 15:	/* Interrogation */
-				if (ais_context->bitlen < 88 || ais_context->bitlen > 168) {
-					//printf("AIVDM message type 15 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				(void)memset(&ais->type15, '\0', sizeof(ais->type15));
-				//ais->type14.spare         = UBITS(38, 2);
-				ais->type15.mmsi1		= UBITS(40, 30);
-				ais->type15.type1_1		= UBITS(70, 6);
-				ais->type15.type1_1		= UBITS(70, 6);
-				ais->type15.offset1_1	= UBITS(76, 12);
-				//ais->type14.spare2        = UBITS(88, 2);
-				if (ais_context->bitlen > 90) {
-					ais->type15.type1_2	= UBITS(90, 6);
-					ais->type15.offset1_2	= UBITS(96, 12);
-					//ais->type14.spare3    = UBITS(108, 2);
-					if (ais_context->bitlen > 110) {
-						ais->type15.type2_1	= UBITS(90, 6);
-						ais->type15.offset2_1	= UBITS(96, 12);
-						//ais->type14.spare4	= UBITS(108, 2);
-					}
-				}
-				//printf("\n");
-				break;
-			case 16:	/* Assigned Mode Command */
-				if (ais_context->bitlen != 96 && ais_context->bitlen != 144) {
-					//printf("AIVDM message type 16 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type16.mmsi1		= UBITS(40, 30);
-				ais->type16.offset1		= UBITS(70, 12);
-				ais->type16.increment1	= UBITS(82, 10);
-				if (ais_context->bitlen < 144)
-					ais->type16.mmsi2=ais->type16.offset2=ais->type16.increment2 = 0;
-				else {
-					ais->type16.mmsi2	= UBITS(92, 30);
-					ais->type16.offset2	= UBITS(122, 12);
-					ais->type16.increment2	= UBITS(134, 10);
-				}
-				//printf("\n");
-				break;
-			case 17:	/* GNSS Broadcast Binary Message */
-				if (ais_context->bitlen < 80 || ais_context->bitlen > 816) {
-					//printf("AIVDM message type 17 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				//ais->type17.spare         = UBITS(38, 2);
-				ais->type17.lon		= UBITS(40, 18);
-				ais->type17.lat		= UBITS(58, 17);
-				//ais->type17.spare	        = UBITS(75, 4);
-				ais->type17.bitcount        = ais_context->bitlen - 80;
-				(void)memcpy(ais->type17.bitdata,
-						(char *)ais_context->bits + (80 / BITS_PER_BYTE),
-						(ais->type17.bitcount + 7) / 8);
-				//printf("\n");
-				break;
-			case 18:	/* Standard Class B CS Position Report */
-				if (ais_context->bitlen != 168) {
-					//printf("AIVDM message type 18 size not 168 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type18.reserved	= UBITS(38, 8);
-				ais->type18.speed		= UBITS(46, 10);
-				ais->type18.accuracy	= UBITS(56, 1)!=0;
-				ais->type18.lon		= SBITS(57, 28);
-				ais->type18.lat		= SBITS(85, 27);
-				ais->type18.course		= UBITS(112, 12);
-				ais->type18.heading		= UBITS(124, 9);
-				ais->type18.second		= UBITS(133, 6);
-				ais->type18.regional	= UBITS(139, 2);
-				ais->type18.cs		= UBITS(141, 1)!=0;
-				ais->type18.display 	= UBITS(142, 1)!=0;
-				ais->type18.dsc     	= UBITS(143, 1)!=0;
-				ais->type18.band    	= UBITS(144, 1)!=0;
-				ais->type18.msg22   	= UBITS(145, 1)!=0;
-				ais->type18.assigned	= UBITS(146, 1)!=0;
-				ais->type18.raim		= UBITS(147, 1)!=0;
-				ais->type18.radio		= UBITS(148, 20);
-				//printf(
-				//	"reserved=%d speed=%d accuracy=%d lon=%d lat=%d course=%d heading=%d sec=%d\n",
-				//	ais->type18.reserved,
-				//	ais->type18.speed,
-				//	(unsigned int)ais->type18.accuracy,
-				//	ais->type18.lon,
-				//	ais->type18.lat,
-				//	ais->type18.course,
-				//	ais->type18.heading,
-				//	ais->type18.second);
-				break;	
-			case 19:	/* Extended Class B CS Position Report */
-				if (ais_context->bitlen != 312) {
-					//printf("AIVDM message type 19 size not 312 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type19.reserved     = UBITS(38, 8);
-				ais->type19.speed        = UBITS(46, 10);
-				ais->type19.accuracy     = UBITS(56, 1)!=0;
-				ais->type19.lon          = SBITS(57, 28);
-				ais->type19.lat          = SBITS(85, 27);
-				ais->type19.course       = UBITS(112, 12);
-				ais->type19.heading      = UBITS(124, 9);
-				ais->type19.second       = UBITS(133, 6);
-				ais->type19.regional     = UBITS(139, 4);
-				UCHARS(143, ais->type19.shipname);
-				ais->type19.shiptype     = UBITS(263, 8);
-				ais->type19.to_bow       = UBITS(271, 9);
-				ais->type19.to_stern     = UBITS(280, 9);
-				ais->type19.to_port      = UBITS(289, 6);
-				ais->type19.to_starboard = UBITS(295, 6);
-				ais->type19.epfd         = UBITS(299, 4);
-				ais->type19.raim         = UBITS(302, 1)!=0;
-				ais->type19.dte          = UBITS(305, 1)!=0;
-				ais->type19.assigned     = UBITS(306, 1)!=0;
-				//ais->type19.spare      = UBITS(307, 5);
-				//printf(
-				//	"reserved=%d speed=%d accuracy=%d lon=%d lat=%d course=%d heading=%d sec=%d name=%s\n",
-				//	ais->type19.reserved,
-				//	ais->type19.speed,
-				//	(unsigned int)ais->type19.accuracy,
-				//	ais->type19.lon,
-				//	ais->type19.lat,
-				//	ais->type19.course,
-				//	ais->type19.heading,
-				//	ais->type19.second,
-				//	ais->type19.shipname);
-				break;
-			case 20:	/* Data Link Management Message */
-				if (ais_context->bitlen < 72 || ais_context->bitlen > 160) {
-					//printf("AIVDM message type 20 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				//ais->type20.spare		= UBITS(38, 2);
-				ais->type20.offset1		= UBITS(40, 12);
-				ais->type20.number1		= UBITS(52, 4);
-				ais->type20.timeout1	= UBITS(56, 3);
-				ais->type20.increment1	= UBITS(59, 11);
-				ais->type20.offset2		= UBITS(70, 12);
-				ais->type20.number2		= UBITS(82, 4);
-				ais->type20.timeout2	= UBITS(86, 3);
-				ais->type20.increment2	= UBITS(89, 11);
-				ais->type20.offset3		= UBITS(100, 12);
-				ais->type20.number3		= UBITS(112, 4);
-				ais->type20.timeout3	= UBITS(116, 3);
-				ais->type20.increment3	= UBITS(119, 11);
-				ais->type20.offset4		= UBITS(130, 12);
-				ais->type20.number4		= UBITS(142, 4);
-				ais->type20.timeout4	= UBITS(146, 3);
-				ais->type20.increment4	= UBITS(149, 11);
-				break;
-			case 21:	/* Aid-to-Navigation Report */
-				if (ais_context->bitlen < 272 || ais_context->bitlen > 360) {
-					//printf("AIVDM message type 21 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type21.aid_type = UBITS(38, 5);
-				from_sixbit((char *)ais_context->bits, 
-						43, 21, ais->type21.name);
-				if (strlen(ais->type21.name) == 20 && ais_context->bitlen > 272)
-					from_sixbit((char *)ais_context->bits, 
-							272, (ais_context->bitlen - 272)/6, 
-							ais->type21.name+20);
-				ais->type21.accuracy     = UBITS(163, 1);
-				ais->type21.lon          = SBITS(164, 28);
-				ais->type21.lat          = SBITS(192, 27);
-				ais->type21.to_bow       = UBITS(219, 9);
-				ais->type21.to_stern     = UBITS(228, 9);
-				ais->type21.to_port      = UBITS(237, 6);
-				ais->type21.to_starboard = UBITS(243, 6);
-				ais->type21.epfd         = UBITS(249, 4);
-				ais->type21.second       = UBITS(253, 6);
-				ais->type21.off_position = UBITS(259, 1)!=0;
-				ais->type21.regional     = UBITS(260, 8);
-				ais->type21.raim         = UBITS(268, 1)!=0;
-				ais->type21.virtual_aid  = UBITS(269, 1)!=0;
-				ais->type21.assigned     = UBITS(270, 1)!=0;
-				//ais->type21.spare      = UBITS(271, 1);
-				//printf(
-				//	"name=%s accuracy=%d lon=%d lat=%d sec=%d\n",
-				//	ais->type21.name,
-				//	(unsigned int)ais->type19.accuracy,
-				//	ais->type19.lon,
-				//	ais->type19.lat,
-				//	ais->type19.second);
-				break;
-			case 22:	/* Channel Management */
-				if (ais_context->bitlen != 168) {
-					//printf("AIVDM message type 22 size not 168 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type22.channel_a    = UBITS(40, 12);
-				ais->type22.channel_b    = UBITS(52, 12);
-				ais->type22.txrx         = UBITS(64, 4);
-				ais->type22.power        = UBITS(68, 1);
-				ais->type22.addressed    = UBITS(139, 1);
-				if (!ais->type22.addressed) {
-					ais->type22.area.ne_lon       = SBITS(69, 18);
-					ais->type22.area.ne_lat       = SBITS(87, 17);
-					ais->type22.area.sw_lon       = SBITS(104, 18);
-					ais->type22.area.sw_lat       = SBITS(122, 17);
-				} else {
-					ais->type22.mmsi.dest1             = SBITS(69, 30);
-					ais->type22.mmsi.dest2             = SBITS(104, 30);
-				}
-				ais->type22.band_a       = UBITS(140, 1);
-				ais->type22.band_b       = UBITS(141, 1);
-				ais->type22.zonesize     = UBITS(142, 3);
-				break;
-			case 23:	/* Group Assignment Command */
-				if (ais_context->bitlen != 160) {
-					//printf("AIVDM message type 23 size not 160 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type23.ne_lon       = SBITS(40, 18);
-				ais->type23.ne_lat       = SBITS(58, 17);
-				ais->type23.sw_lon       = SBITS(75, 18);
-				ais->type23.sw_lat       = SBITS(93, 17);
-				ais->type23.stationtype  = UBITS(110, 4);
-				ais->type23.shiptype     = UBITS(114, 8);
-				ais->type23.txrx         = UBITS(144, 4);
-				ais->type23.interval     = UBITS(146, 4);
-				ais->type23.quiet        = UBITS(150, 4);
-				break;
-			case 24:	/* Class B CS Static Data Report */
-				switch (UBITS(38, 2)) {
-					case 0:
-						if (ais_context->bitlen != 160) {
-							//printf("AIVDM message type 24A size not 160 bits (%zd).\n",
-							//	ais_context->bitlen);
-							break;
-						}
-						UCHARS(40, ais_context->shipname);
-						//ais->type24.a.spare	= UBITS(160, 8);
-						return 0;	/* data only partially decoded */
-					case 1:
-						if (ais_context->bitlen != 168) {
-							//printf("AIVDM message type 24B size not 168 bits (%zd).\n",
-							//	ais_context->bitlen);
-							break;
-						}
-						(void)strncpy_s(ais->type24.shipname, 20,
-								ais_context->shipname,
-								sizeof(ais_context->shipname));
-						ais->type24.shiptype = UBITS(40, 8);
-						UCHARS(48, ais->type24.vendorid);
-						UCHARS(90, ais->type24.callsign);
-						if (AIS_AUXILIARY_MMSI(ais->mmsi))
-							ais->type24.mothership_mmsi   = UBITS(132, 30);
-						else {
-							ais->type24.dim.to_bow        = UBITS(132, 9);
-							ais->type24.dim.to_stern      = UBITS(141, 9);
-							ais->type24.dim.to_port       = UBITS(150, 6);
-							ais->type24.dim.to_starboard  = UBITS(156, 6);
-						}
-						//ais->type24.b.spare	    = UBITS(162, 8);
-						break;
-				}
-				//printf("\n");
-				break;
-			case 25:	/* Binary Message, Single Slot */
-				/* this check and the following one reject line noise */
-				if (ais_context->bitlen < 40 || ais_context->bitlen > 168) {
-					//printf("AIVDM message type 25 size not between 40 to 168 bits (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type25.addressed	= (int)UBITS(38, 1);
-				ais->type25.structured	= (int)UBITS(39, 1);
-				if (ais_context->bitlen < (40 + (16*ais->type25.structured) + (30*ais->type25.addressed))) {
-					//printf("AIVDM message type 25 too short for mode.\n");
-					break;
-				}
-				if (ais->type25.addressed)
-					ais->type25.dest_mmsi   = UBITS(40, 30);
-				if (ais->type25.structured)
-					ais->type25.app_id      = UBITS(40+ais->type25.addressed*30,16);
-				/*
-				 * Not possible to do this right without machinery we
-				 * don't yet have.  The problem is that if the addressed
-				 * bit is on the bitfield start won't be on a byte
-				 * boundary. Thus the formulas below (and in message type 26)
-				 * will work perfectly for brodacst messages, but for addressed
-				 * messages the retrieved data will be led by thr 30 bits of
-				 * the destination MMSI
-				 */
-				ais->type25.bitcount       = ais_context->bitlen - 40 - 16*ais->type25.structured;
-				(void)memcpy(ais->type25.bitdata,
-						(char *)ais_context->bits+5 + 2 * ais->type25.structured,
-						(ais->type25.bitcount + 7) / 8);
-				//printf("addressed=%d, structured=%d, dest=%u, id=%u, cnt=%zd\n",
-				//	ais->type25.addressed,
-				//	ais->type25.structured,
-				//	ais->type25.dest_mmsi,
-				//	ais->type25.app_id,
-				//	ais->type25.bitcount);		
-				break;
-			case 26:	/* Binary Message, Multiple Slot */
-				if (ais_context->bitlen < 60 || ais_context->bitlen > 1004) {
-					//printf("AIVDM message type 26 size is out of range (%zd).\n",
-					//	ais_context->bitlen);
-					break;
-				}
-				ais->type26.addressed	= (int)UBITS(38, 1);
-				ais->type26.structured	= (int)UBITS(39, 1);
-				if (ais->type26.addressed)
-					ais->type26.dest_mmsi   = UBITS(40, 30);
-				if (ais->type26.structured)
-					ais->type26.app_id      = UBITS(40+ais->type26.addressed*30,16);
-				ais->type26.bitcount        = ais_context->bitlen - 60 - 16*ais->type26.structured;
-				(void)memcpy(ais->type26.bitdata,
-						(char *)ais_context->bits+5 + 2 * ais->type26.structured,
-						(ais->type26.bitcount + 7) / 8);
-				//printf("addressed=%d, structured=%d, dest=%u, id=%u, cnt=%zd\n",
-				//	ais->type26.addressed,
-				//	ais->type26.structured,
-				//	ais->type26.dest_mmsi,
-				//	ais->type26.app_id,
-				//	ais->type26.bitcount);
-				break;
-			default:
-				//printf("\n");
-				printf("Unparsed AIVDM message type %d.\n",ais->type);
-				break;
+		/* nothing past the payload may leak into out-of-range reads */
+		(void)memset(ais_context->bits + (ais_context->bitlen + 7) / 8,
+				'\0', AIVDM_BITS_SLACK);
+
+		return decode_payload(ais_context->bits, ais_context->bitlen,
+				ais_context->filter, ais_context->projection,
+				ais_context->shipname, ais_context->type24,
+				payload, ais);
+	}
+
+	/* we're still waiting on another sentence */
+	return AIVDM_STATUS_PENDING;
+}
+
+/*
+ * Multipart reassembly table.  slot[] is open addressing with linear
+ * probing and holds only the keys; payloads live in pool[] so that
+ * probing stays within a few cache lines.  Deletion shifts the rest
+ * of a probe run back instead of leaving tombstones.
+ */
+#define REASM_MASK	(AIVDM_REASM_TABLE - 1)
+#define REASM_PAYLOAD	((AIVDM_REASM_BITS - AIVDM_BITS_SLACK) * 8)
+
+static unsigned int reasm_hash(unsigned int source, unsigned char channel,
+			       unsigned char seqid)
+{
+	unsigned int h = source * 0x9e3779b1U;
+
+	h ^= ((unsigned int)channel << 8) | seqid;
+	h ^= h >> 15;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	return h & REASM_MASK;
+}
+
+static int reasm_stale(const struct aivdm_reasm_t *reasm,
+		       const struct aivdm_reasm_slot_t *slot, unsigned long now)
+{
+	return (reasm->timeout != 0 && now - slot->started > reasm->timeout)
+	    || (reasm->maxage != 0 && reasm->tick - slot->tick > reasm->maxage);
+}
+
+static void reasm_remove(struct aivdm_reasm_t *reasm, unsigned int i)
+{
+	unsigned int j = i, home;
+
+	reasm->freebuf[reasm->nfree++] = reasm->slot[i].buffer;
+	for (;;) {
+		reasm->slot[i].part = 0;
+		/* find a later entry of the run that may move into the hole */
+		for (;;) {
+			j = (j + 1) & REASM_MASK;
+			if (reasm->slot[j].part == 0)
+				return;
+			home = reasm_hash(reasm->slot[j].source,
+					  reasm->slot[j].channel, reasm->slot[j].seqid);
+			/* it stays put if its home lies cyclically in (i, j] */
+			if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+				continue;
+			break;
 		}
-		/* *INDENT-ON* */
-#undef UCHARS
-#undef SBITS
-#undef UBITS
-#undef BITS_PER_BYTE
+		reasm->slot[i] = reasm->slot[j];
+		i = j;
+	}
+}
+
+static size_t reasm_sweep(struct aivdm_reasm_t *reasm, unsigned long now)
+{
+	unsigned int i = 0;
+	size_t n = 0;
+
+	while (i < AIVDM_REASM_TABLE) {
+		if (reasm->slot[i].part != 0 && reasm_stale(reasm, &reasm->slot[i], now)) {
+			/* a later entry may have shifted into i, look again */
+			reasm_remove(reasm, i);
+			n++;
+		} else
+			i++;
+	}
+	reasm->dropped += n;
+	return n;
+}
+
+static void reasm_evict_oldest(struct aivdm_reasm_t *reasm)
+{
+	unsigned int i, oldest = AIVDM_REASM_TABLE;
+
+	for (i = 0; i < AIVDM_REASM_TABLE; i++)
+		if (reasm->slot[i].part != 0 && (oldest == AIVDM_REASM_TABLE
+				|| reasm->tick - reasm->slot[i].tick
+				   > reasm->tick - reasm->slot[oldest].tick))
+			oldest = i;
+	if (oldest != AIVDM_REASM_TABLE) {
+		reasm_remove(reasm, oldest);
+		reasm->dropped++;
+	}
+}
+
+void aivdm_reasm_init(struct aivdm_reasm_t *reasm,
+		      unsigned long timeout, unsigned long maxage)
+{
+	unsigned int i;
 
-		/* data is fully decoded */
+	(void)memset(reasm, '\0', sizeof(*reasm));
+	for (i = 0; i < AIVDM_REASM_SLOTS; i++)
+		reasm->freebuf[i] = (unsigned short)(AIVDM_REASM_SLOTS - 1 - i);
+	reasm->nfree = AIVDM_REASM_SLOTS;
+	reasm->timeout = timeout;
+	reasm->maxage = maxage;
+}
+
+size_t aivdm_reasm_expire(struct aivdm_reasm_t *reasm, unsigned long now)
+{
+	return reasm_sweep(reasm, now);
+}
+
+static int reasm_decode(struct aivdm_reasm_t *reasm, unsigned int source,
+			unsigned long now, const char *buf, size_t buflen,
+			struct aivdm_payload_t *payload, struct ais_t *ais)
+/* aivdm_reasm_decode(), with the payload handled as decode_payload() does */
+{
+	struct sentence_t sentence;
+	struct aivdm_reasm_slot_t *slot;
+	unsigned char *bits;
+	unsigned int i;
+	size_t bitlen;
+
+	if (!parse_sentence(buf, buflen,
+			(reasm->flags & AIVDM_DECODE_NOCHECKSUM) == 0, &sentence)
+			|| sentence.await < 1 || sentence.await > AIVDM_MAX_FRAGMENTS
+			|| sentence.part < 1 || sentence.part > sentence.await
+			|| 6 * sentence.datalen > REASM_PAYLOAD)
+		return AIVDM_STATUS_REJECTED;
+	reasm->tick++;
+
+	/* the common case never touches the table */
+	if (sentence.await == 1) {
+		bitlen = append_payload(reasm->bits, 0, &sentence);
+		(void)memset(reasm->bits + (bitlen + 7) / 8, '\0', AIVDM_BITS_SLACK);
+		return decode_payload(reasm->bits, bitlen, reasm->filter,
+				reasm->projection, reasm->shipname, reasm->type24,
+				payload, ais);
+	}
+
+	for (i = reasm_hash(source, sentence.channel, sentence.seqid);
+			reasm->slot[i].part != 0; i = (i + 1) & REASM_MASK)
+		if (reasm->slot[i].source == source
+				&& reasm->slot[i].channel == sentence.channel
+				&& reasm->slot[i].seqid == sentence.seqid)
+			break;
+	slot = &reasm->slot[i];
+
+	if (slot->part != 0) {
+		/* a repeat of the first part, a gap, or one left too long */
+		if (sentence.part != slot->part + 1 || sentence.await != slot->await
+				|| reasm_stale(reasm, slot, now)
+				|| slot->bitlen + 6 * sentence.datalen > REASM_PAYLOAD) {
+			reasm_remove(reasm, i);
+			reasm->dropped++;
+			if (sentence.part != 1)
+				return AIVDM_STATUS_REJECTED;
+			/* the removal may have reshuffled the run; start over */
+			reasm->tick--;
+			return reasm_decode(reasm, source, now, buf, buflen,
+					    payload, ais);
+		}
+	} else {
+		if (sentence.part != 1)
+			return AIVDM_STATUS_REJECTED;	/* its start went missing */
+		if (reasm->nfree == 0) {
+			if (reasm_sweep(reasm, now) == 0)
+				reasm_evict_oldest(reasm);
+			/* either way slots moved; probe again */
+			reasm->tick--;
+			return reasm_decode(reasm, source, now, buf, buflen,
+					    payload, ais);
+		}
+		slot->source = source;
+		slot->channel = sentence.channel;
+		slot->seqid = sentence.seqid;
+		slot->await = (unsigned char)sentence.await;
+		slot->started = now;
+		slot->tick = reasm->tick;
+		slot->bitlen = 0;
+		slot->buffer = reasm->freebuf[--reasm->nfree];
+	}
+
+	bits = reasm->pool[slot->buffer];
+	slot->bitlen = (unsigned short)append_payload(bits, slot->bitlen, &sentence);
+	slot->part = (unsigned char)sentence.part;
+	if (slot->part != slot->await)
+		return AIVDM_STATUS_PENDING;
+
+	bitlen = slot->bitlen;
+	(void)memset(bits + (bitlen + 7) / 8, '\0', AIVDM_BITS_SLACK);
+	reasm_remove(reasm, i);	/* pool[] entry stays intact until reused */
+	return decode_payload(bits, bitlen, reasm->filter, reasm->projection,
+			reasm->shipname, reasm->type24, payload, ais);
+}
+#undef REASM_PAYLOAD
+#undef REASM_MASK
+
+int aivdm_reasm_decode(struct aivdm_reasm_t *reasm, unsigned int source,
+		       unsigned long now, const char *buf, size_t buflen,
+		       struct ais_t *ais)
+{
+	return reasm_decode(reasm, source, now, buf, buflen, NULL, ais);
+}
+
+static int finish_record(int status, const struct ais_t *ais,
+			 const struct aivdm_payload_t *payload,
+			 struct aivdm_arena_t *arena, unsigned int flags,
+			 union aivdm_record_t *rec)
+/*
+ * Pack a decoded message into rec.  Its payload is left where the
+ * decoder put it only for zero-copy; text and copied payloads go to
+ * the arena, because ais will not outlive the call.
+ */
+{
+	struct aivdm_payload_t *view;
+
+	if (status != AIVDM_STATUS_DECODED)
+		return status;
+	(void)aivdm_compact(ais, rec);
+	view = aivdm_record_payload(rec);
+	if (view != NULL) {
+		*view = *payload;
+		if (view->bitcount == 0)
+			view->bits = NULL;
+		if (flags & AIVDM_DECODE_ZEROCOPY)
+			return status;
+	}
+	if (aivdm_record_keep(arena, rec) != 0)
+		return AIVDM_STATUS_REJECTED;
+	return status;
+}
+
+int aivdm_reasm_decode_record(struct aivdm_reasm_t *reasm,
+			      unsigned int source, unsigned long now,
+			      const char *buf, size_t buflen,
+			      union aivdm_record_t *rec)
+{
+	struct ais_t ais;
+	struct aivdm_payload_t payload;
+	int status;
+
+	payload.bits = NULL;
+	payload.start = 0;
+	payload.bitcount = 0;
+	status = reasm_decode(reasm, source, now, buf, buflen, &payload, &ais);
+	return finish_record(status, &ais, &payload, reasm->arena,
+			     reasm->flags, rec);
+}
+
+void aivdm_context_init(struct aivdm_context_t *ais_context)
+{
+	(void)memset(ais_context, '\0', sizeof(*ais_context));
+}
+
+int aivdm_decode(const char *buf, size_t buflen,
+struct aivdm_context_t *ais_context, struct ais_t *ais)
+{
+	return decode_sentence(ais_context, buf, buflen, NULL, ais) == AIVDM_STATUS_DECODED;
+}
+
+int aivdm_decode_record(struct aivdm_context_t *ais_context,
+			const char *buf, size_t buflen,
+			union aivdm_record_t *rec)
+{
+	struct ais_t ais;
+	struct aivdm_payload_t payload;
+	int status;
+
+	payload.bits = NULL;
+	payload.start = 0;
+	payload.bitcount = 0;
+	status = decode_sentence(ais_context, buf, buflen, &payload, &ais);
+	return finish_record(status, &ais, &payload, ais_context->arena,
+			     ais_context->flags, rec);
+}
+
+int aivdm_peek(const char *buf, size_t buflen, unsigned int flags,
+	       struct aivdm_peek_t *peek)
+{
+	struct sentence_t sentence;
+	const unsigned char *cp;
+	const unsigned char *t = sixbit_dearmor_table;
+
+	/* the fragment checks aivdm_reasm_decode() makes */
+	if (!parse_sentence(buf, buflen,
+			(flags & AIVDM_DECODE_NOCHECKSUM) == 0, &sentence)
+			|| sentence.await < 1 || sentence.await > AIVDM_MAX_FRAGMENTS
+			|| sentence.part < 1 || sentence.part > sentence.await)
+		return 0;
+	peek->await = sentence.await;
+	peek->part = sentence.part;
+	peek->seqid = sentence.seqid == 0xff ? -1 : sentence.seqid;
+	peek->channel = (char)sentence.channel;
+	/* 38 header bits are the first seven characters, less four bits */
+	peek->header = sentence.part == 1 && sentence.datalen >= 7;
+	if (!peek->header)
 		return 1;
+	cp = (const unsigned char *)sentence.data;
+	peek->type = t[cp[0]];
+	peek->repeat = (unsigned int)t[cp[1]] >> 4;
+	peek->mmsi = ((unsigned int)(t[cp[1]] & 0x0f) << 26)
+		   | ((unsigned int)t[cp[2]] << 20)
+		   | ((unsigned int)t[cp[3]] << 14)
+		   | ((unsigned int)t[cp[4]] << 8)
+		   | ((unsigned int)t[cp[5]] << 2)
+		   | ((unsigned int)t[cp[6]] >> 4);
+	return 1;
+}
+
+static void decode_line(struct aivdm_context_t *ais_context,
+			const char *line, size_t len,
+			struct aivdm_block_result_t *result)
+/* one line of a block: classify, decode, record the outcome */
+{
+	struct ais_t ais;
+	struct aivdm_payload_t payload;
+	int status;
+
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+	if (len == 0)
+		return;
+	/* !xxVDM from other stations, !xxVDO from our own */
+	if (len < 7 || line[0] != '!' || line[3] != 'V' || line[4] != 'D'
+			|| (line[5] != 'M' && line[5] != 'O') || line[6] != ',')
+		status = AIVDM_STATUS_IGNORED;
+	else if (result->compact != NULL) {
+		/* the next line reuses bits[], so payloads are always copied */
+		payload.bits = NULL;
+		payload.start = 0;
+		payload.bitcount = 0;
+		status = decode_sentence(ais_context, line, len, &payload, &ais);
+		status = finish_record(status, &ais, &payload, ais_context->arena,
+				ais_context->flags & ~AIVDM_DECODE_ZEROCOPY,
+				&result->compact[result->nrecords]);
+	} else
+		status = decode_sentence(ais_context, line, len, NULL,
+				&result->records[result->nrecords]);
+	if (status == AIVDM_STATUS_DECODED)
+		result->nrecords++;
+	result->status[result->nsentences++] = (unsigned char)status;
+}
+
+static int arena_full(const struct aivdm_context_t *ais_context,
+		      const struct aivdm_block_result_t *result)
+/* too little arena left for whatever the next record might keep there */
+{
+	const struct aivdm_arena_t *arena = ais_context->arena;
+
+	return result->compact != NULL && arena != NULL
+		&& arena->size - arena->used < AIVDM_RECORD_ARENA_MAX;
+}
+
+static void carry_append(struct aivdm_context_t *ais_context,
+			 const char *p, size_t len)
+/* hold on to part of a line that continues in the next block */
+{
+	if (ais_context->overlong)
+		return;
+	if (ais_context->carrylen + len > sizeof(ais_context->carry)) {
+		/* no sentence is this long; drop it through its newline */
+		ais_context->overlong = 1;
+		ais_context->carrylen = 0;
+		return;
 	}
+	(void)memcpy(ais_context->carry + ais_context->carrylen, p, len);
+	ais_context->carrylen += len;
+}
 
-	/* we're still waiting on another sentence */
-	return 0;
+size_t aivdm_decode_block(struct aivdm_context_t *ais_context,
+			  const char *buf, size_t buflen,
+			  struct aivdm_block_result_t *result)
+{
+	const char *p = buf, *end = buf + buflen, *nl;
+
+	result->nrecords = 0;
+	result->nsentences = 0;
+	if (result->maxrecords == 0 || result->maxsentences == 0
+			|| arena_full(ais_context, result))
+		return 0;
+
+	/* finish the line the last block ended in the middle of */
+	if (ais_context->carrylen > 0 || ais_context->overlong) {
+		nl = (const char *)memchr(p, '\n', buflen);
+		if (nl == NULL) {
+			carry_append(ais_context, p, buflen);
+			return buflen;
+		}
+		carry_append(ais_context, p, (size_t)(nl - p));
+		if (!ais_context->overlong)
+			decode_line(ais_context, ais_context->carry,
+				    ais_context->carrylen, result);
+		ais_context->carrylen = 0;
+		ais_context->overlong = 0;
+		p = nl + 1;
+	}
+
+	/* the rest is parsed where it lies; memchr() is vectorized in any libc */
+	while (p < end) {
+		if (result->nrecords == result->maxrecords
+				|| result->nsentences == result->maxsentences)
+			break;
+		if (arena_full(ais_context, result))
+			break;
+		nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+		if (nl == NULL) {
+			carry_append(ais_context, p, (size_t)(end - p));
+			p = end;
+			break;
+		}
+		decode_line(ais_context, p, (size_t)(nl - p), result);
+		p = nl + 1;
+	}
+	return (size_t)(p - buf);
 }
 
 /* driver_aivdm.c ends here */
@@ -0,0 +1,138 @@
+/* nmea.c - NMEA 0183 sentence scanning with a fused checksum
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ *
+ * The scanner XORs the sentence into an accumulator while it looks for
+ * commas and the '*'.  The SSE2 kernel handles sixteen characters per
+ * step: two compares and two movemasks give bitmasks of the commas and
+ * stars, and the characters after a star are masked off before they
+ * reach the accumulator.  A short final piece is copied to a zeroed
+ * block so that nothing is read past the end of the sentence.
+ */
+#include <string.h>
+
+#include "nmea.h"
+#include "simd.h"
+
+typedef int (*scan_kernel_t)(const char *, size_t, struct nmea_scan_t *);
+
+static int scan_scalar(const char *buf, size_t len, struct nmea_scan_t *scan)
+{
+	const char *cp, *end = buf + len;
+	unsigned int sum = 0;
+
+	scan->field[0] = buf;
+	scan->nfields = 1;
+	scan->star = NULL;
+	for (cp = buf + 1; cp < end; cp++) {
+		if (*cp == '*') {
+			scan->star = cp;
+			break;
+		}
+		sum ^= (unsigned char)*cp;
+		if (*cp == ',' && scan->nfields < NMEA_SCAN_FIELDS)
+			scan->field[scan->nfields++] = cp + 1;
+	}
+	scan->sum = sum;
+	return scan->nfields;
+}
+
+#ifdef AIVDM_HAVE_SSE2
+/* loaded at offset 16 - n, keeps the first n bytes of a block */
+static const unsigned char prefix_mask[32] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+AIVDM_TARGET_SSE2
+static int scan_sse2(const char *buf, size_t len, struct nmea_scan_t *scan)
+{
+	const __m128i kcomma = _mm_set1_epi8(',');
+	const __m128i kstar = _mm_set1_epi8('*');
+	__m128i acc = _mm_setzero_si128(), v;
+	unsigned char tail[16];
+	const char *cp = buf + 1, *end = buf + len;
+	unsigned int commas, stars, n;
+
+	scan->field[0] = buf;
+	scan->nfields = 1;
+	scan->star = NULL;
+	for (; cp < end; cp += 16) {
+		if (end - cp >= 16)
+			v = _mm_loadu_si128((const __m128i *)cp);
+		else {
+			/* zeros match neither character and leave the XOR alone */
+			(void)memset(tail, '\0', sizeof(tail));
+			(void)memcpy(tail, cp, (size_t)(end - cp));
+			v = _mm_loadu_si128((const __m128i *)tail);
+		}
+		commas = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, kcomma));
+		stars = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, kstar));
+		if (stars != 0) {
+			n = aivdm_ctz32(stars);
+			scan->star = cp + n;
+			commas &= (1U << n) - 1;
+			v = _mm_and_si128(v, _mm_loadu_si128(
+					(const __m128i *)(prefix_mask + 16 - n)));
+		}
+		acc = _mm_xor_si128(acc, v);
+		for (; commas != 0 && scan->nfields < NMEA_SCAN_FIELDS;
+				commas &= commas - 1)
+			scan->field[scan->nfields++] = cp + aivdm_ctz32(commas) + 1;
+		if (scan->star != NULL)
+			break;
+	}
+	/* fold the sixteen lanes into one */
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+	scan->sum = (unsigned int)_mm_cvtsi128_si32(acc) & 0xff;
+	return scan->nfields;
+}
+#endif /* AIVDM_HAVE_SSE2 */
+
+static int scan_dispatch(const char *, size_t, struct nmea_scan_t *);
+
+static scan_kernel_t scan_kernel = scan_dispatch;
+
+static int scan_dispatch(const char *buf, size_t len, struct nmea_scan_t *scan)
+/* pick the best kernel for this host on first use */
+{
+	scan_kernel_t kernel = scan_scalar;
+
+#ifdef AIVDM_HAVE_SSE2
+	if (aivdm_cpu_features() & AIVDM_CPU_SSE2)
+		kernel = scan_sse2;
+#endif
+	scan_kernel = kernel;
+	return kernel(buf, len, scan);
+}
+
+int nmea_scan(const char *buf, size_t len, struct nmea_scan_t *scan)
+{
+	return scan_kernel(buf, len, scan);
+}
+
+static int hexval(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+int nmea_checksum_ok(const struct nmea_scan_t *scan, const char *end)
+{
+	int hi, lo;
+
+	if (scan->star == NULL || end - scan->star < 3)
+		return 0;
+	hi = hexval(scan->star[1]);
+	lo = hexval(scan->star[2]);
+	return hi >= 0 && lo >= 0 && (unsigned int)(hi * 16 + lo) == scan->sum;
+}
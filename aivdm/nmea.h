@@ -0,0 +1,36 @@
+/*
+ * nmea.h - single-pass NMEA 0183 sentence scanning
+ *
+ * Locating the fields of a sentence and checking its checksum both
+ * have to look at every character, so they are done in one pass, a
+ * vector register at a time where the CPU allows.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_NMEA_H_
+#define _GPSD_NMEA_H_
+
+#include <stddef.h>
+
+/* fields recorded by nmea_scan(); AIVDM needs the first seven */
+#define NMEA_SCAN_FIELDS	8
+
+struct nmea_scan_t {
+    const char *field[NMEA_SCAN_FIELDS];	/* starts, field[0] is the sentence */
+    int nfields;
+    const char *star;		/* the '*' before the checksum, NULL if none */
+    unsigned int sum;		/* XOR of the characters between '!' and star */
+};
+
+/*
+ * Scan the len characters of the sentence at buf, which starts with its
+ * '!' or '$'.  Fields are only looked for ahead of the '*', and past
+ * NMEA_SCAN_FIELDS they are not recorded.  Returns scan->nfields.
+ */
+extern int nmea_scan(const char *buf, size_t len, struct nmea_scan_t *scan);
+
+/* nonzero if the two hex digits after scan->star, before end, match sum */
+extern int nmea_checksum_ok(const struct nmea_scan_t *scan, const char *end);
+
+#endif /* _GPSD_NMEA_H_ */
@@ -0,0 +1,53 @@
+/* simd.c - run-time detection of the vector units the kernels may use
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#include "simd.h"
+
+static unsigned int detect_features(void)
+{
+	unsigned int features = 0;
+
+#if defined(AIVDM_X86) && defined(_MSC_VER)
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] >= 1) {
+		__cpuid(regs, 1);
+		if (regs[3] & (1 << 26))
+			features |= AIVDM_CPU_SSE2;
+#ifdef AIVDM_HAVE_AVX2
+		/* OSXSAVE and AVX, then make sure the OS saves the YMM state */
+		if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28))
+				&& (_xgetbv(0) & 0x6) == 0x6) {
+			__cpuidex(regs, 7, 0);
+			if (regs[1] & (1 << 5))
+				features |= AIVDM_CPU_AVX2;
+		}
+#endif
+	}
+#elif defined(AIVDM_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		features |= AIVDM_CPU_SSE2;
+#ifdef AIVDM_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		features |= AIVDM_CPU_AVX2;
+#endif
+#endif
+	return features;
+}
+
+unsigned int aivdm_cpu_features(void)
+/* report usable vector extensions; the race on first use is benign */
+{
+	static volatile int detected = 0;
+	static volatile unsigned int features = 0;
+
+	if (!detected) {
+		features = detect_features();
+		detected = 1;
+	}
+	return features;
+}
@@ -0,0 +1,82 @@
+/*
+ * simd.h - compiler and CPU feature plumbing for the vectorized kernels
+ *
+ * The kernels are always compiled with a portable scalar fallback.  The
+ * SSE2 and AVX2 variants are compiled in when the toolchain can emit
+ * them, and selected at run time through aivdm_cpu_features() so that a
+ * single binary still runs on hosts without the instructions.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_SIMD_H_
+#define _GPSD_SIMD_H_
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AIVDM_X86	1
+#endif
+
+#ifdef AIVDM_X86
+#if defined(_MSC_VER)
+/* SSE2 intrinsics exist since VC7.1, AVX2 ones since VS2013 */
+#define AIVDM_HAVE_SSE2	1
+#if _MSC_VER >= 1800
+#define AIVDM_HAVE_AVX2	1
+#endif
+#define AIVDM_TARGET_SSE2
+#define AIVDM_TARGET_AVX2
+#elif defined(__GNUC__)
+#define AIVDM_HAVE_SSE2	1
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__)
+#define AIVDM_HAVE_AVX2	1
+#endif
+#define AIVDM_TARGET_SSE2	__attribute__((target("sse2")))
+#define AIVDM_TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+#endif /* AIVDM_X86 */
+
+#ifdef AIVDM_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef AIVDM_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIMD_INLINE	static __inline
+#else
+#define SIMD_INLINE	static __inline__
+#endif
+
+SIMD_INLINE unsigned int aivdm_ctz32(unsigned int x)
+/* index of the lowest set bit; x must be nonzero */
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward(&i, x);
+	return (unsigned int)i;
+#else
+	return (unsigned int)__builtin_ctz(x);
+#endif
+}
+
+SIMD_INLINE unsigned int aivdm_bsr32(unsigned int x)
+/* index of the highest set bit; x must be nonzero */
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanReverse(&i, x);
+	return (unsigned int)i;
+#else
+	return 31 - (unsigned int)__builtin_clz(x);
+#endif
+}
+
+#define AIVDM_CPU_SSE2	0x01
+#define AIVDM_CPU_AVX2	0x02
+
+/* bitmask of AIVDM_CPU_* usable on this host (detected once, then cached) */
+extern unsigned int aivdm_cpu_features(void);
+
+#endif /* _GPSD_SIMD_H_ */
@@ -0,0 +1,407 @@
+/* sixbit.c - AIVDM payload de-armoring and six-bit text kernels
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ *
+ * Each armored character c carries the six-bit value c - 48, less a
+ * further 8 when that is 40 or more.  Four characters pack into three
+ * bytes, so the byte-aligned case is handled in groups of four; the
+ * vector kernels do 16 (SSE2) or 32 (AVX2) characters per iteration.
+ * Anything left over, or a start that is not on a byte boundary, goes
+ * through a shift-register loop over the same lookup table.
+ *
+ * Text fields use the same four-characters-to-three-bytes packing with
+ * a different character map; they are converted eight characters (one
+ * 48-bit field) at a time, or sixteen at a time with SSE2.
+ */
+#include <string.h>
+
+#include "sixbit.h"
+#include "simd.h"
+
+/* (c - 48) less 8 if that is >= 40, in unsigned char arithmetic, as gpsd does */
+const unsigned char sixbit_dearmor_table[256] = {
+	 8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+	32, 33, 34, 35, 36, 37, 38, 39, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63,  0,  1,  2,  3,  4,  5,  6,  7,
+	 8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63,  0,  1,  2,  3,  4,  5,  6,  7,
+	 8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+	40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63,  0,  1,  2,  3,  4,  5,  6,  7,
+};
+
+/*
+ * A bulk kernel converts as many leading characters as it likes, in
+ * whole groups of four, into byte-aligned output, and returns how many
+ * characters it consumed.
+ */
+typedef size_t (*dearmor_kernel_t)(unsigned char *, const unsigned char *, size_t);
+
+static size_t dearmor_none(unsigned char *out, const unsigned char *cp, size_t len)
+{
+	(void)out;
+	(void)cp;
+	(void)len;
+	return 0;
+}
+
+#ifdef AIVDM_HAVE_SSE2
+AIVDM_TARGET_SSE2
+static size_t dearmor_sse2(unsigned char *out, const unsigned char *cp, size_t len)
+{
+	const __m128i k48 = _mm_set1_epi8(48);
+	const __m128i k40 = _mm_set1_epi8(40);
+	const __m128i k8 = _mm_set1_epi8(8);
+	const __m128i k3f = _mm_set1_epi8(0x3f);
+	const __m128i klow = _mm_set1_epi16(0x00ff);
+	const __m128i kmerge = _mm_set1_epi32(0x00011000);	/* hi*1 + lo*4096 */
+	unsigned int w[4];
+	size_t done;
+	int i;
+
+	for (done = 0; done + 16 <= len; done += 16) {
+		__m128i v = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(cp + done)), k48);
+		/* unsigned v >= 40 */
+		__m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(v, k40), v);
+
+		v = _mm_and_si128(_mm_sub_epi8(v, _mm_and_si128(ge, k8)), k3f);
+		/* character pairs to 12 bits, then pairs of those to 24 */
+		v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, klow), 6),
+				 _mm_srli_epi16(v, 8));
+		v = _mm_madd_epi16(v, kmerge);
+		_mm_storeu_si128((__m128i *)w, v);
+		for (i = 0; i < 4; i++) {
+			out[0] = (unsigned char)(w[i] >> 16);
+			out[1] = (unsigned char)(w[i] >> 8);
+			out[2] = (unsigned char)w[i];
+			out += 3;
+		}
+	}
+	return done;
+}
+#endif /* AIVDM_HAVE_SSE2 */
+
+#ifdef AIVDM_HAVE_AVX2
+AIVDM_TARGET_AVX2
+static size_t dearmor_avx2(unsigned char *out, const unsigned char *cp, size_t len)
+{
+	const __m256i k48 = _mm256_set1_epi8(48);
+	const __m256i k40 = _mm256_set1_epi8(40);
+	const __m256i k8 = _mm256_set1_epi8(8);
+	const __m256i k3f = _mm256_set1_epi8(0x3f);
+	const __m256i klow = _mm256_set1_epi16(0x00ff);
+	const __m256i kmerge = _mm256_set1_epi32(0x00011000);
+	/* big-endian low three bytes of each dword, packed to 12 per lane */
+	const __m256i kbytes = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	size_t done;
+
+	for (done = 0; done + 32 <= len; done += 32) {
+		__m256i v = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(cp + done)), k48);
+		__m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(v, k40), v);
+
+		v = _mm256_and_si256(_mm256_sub_epi8(v, _mm256_and_si256(ge, k8)), k3f);
+		v = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, klow), 6),
+				    _mm256_srli_epi16(v, 8));
+		v = _mm256_madd_epi16(v, kmerge);
+		v = _mm256_shuffle_epi8(v, kbytes);
+		/* each store runs 4 bytes long; the next one or the slack absorbs it */
+		_mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(v));
+		_mm_storeu_si128((__m128i *)(out + 12), _mm256_extracti128_si256(v, 1));
+		out += 24;
+	}
+	return done + dearmor_sse2(out, cp + done, len - done);
+}
+#endif /* AIVDM_HAVE_AVX2 */
+
+static size_t dearmor_dispatch(unsigned char *, const unsigned char *, size_t);
+
+static dearmor_kernel_t dearmor_bulk = dearmor_dispatch;
+
+static size_t dearmor_dispatch(unsigned char *out, const unsigned char *cp, size_t len)
+/* pick the best kernel for this host on first use */
+{
+	unsigned int features = aivdm_cpu_features();
+	dearmor_kernel_t kernel = dearmor_none;
+
+#ifdef AIVDM_HAVE_SSE2
+	if (features & AIVDM_CPU_SSE2)
+		kernel = dearmor_sse2;
+#endif
+#ifdef AIVDM_HAVE_AVX2
+	if (features & AIVDM_CPU_AVX2)
+		kernel = dearmor_avx2;
+#endif
+	(void)features;
+	dearmor_bulk = kernel;
+	return kernel(out, cp, len);
+}
+
+size_t aivdm_dearmor(unsigned char *bits, size_t bitlen,
+		     const char *data, size_t len)
+{
+	const unsigned char *cp = (const unsigned char *)data;
+	unsigned char *out = bits + bitlen / 8;
+	unsigned long acc = 0, w;
+	unsigned int nacc = (unsigned int)(bitlen % 8);
+	size_t done = 0;
+
+	if (nacc == 0) {
+		done = dearmor_bulk(out, cp, len);
+		out += done / 4 * 3;
+	} else
+		acc = *out >> (8 - nacc);
+
+	/* shift register holds fewer than 8 pending bits between groups */
+	for (; done + 4 <= len; done += 4) {
+		w = ((unsigned long)sixbit_dearmor_table[cp[done]] << 18)
+		  | ((unsigned long)sixbit_dearmor_table[cp[done + 1]] << 12)
+		  | ((unsigned long)sixbit_dearmor_table[cp[done + 2]] << 6)
+		  | (unsigned long)sixbit_dearmor_table[cp[done + 3]];
+		acc = (acc << 24) | w;
+		out[0] = (unsigned char)(acc >> (nacc + 16));
+		out[1] = (unsigned char)(acc >> (nacc + 8));
+		out[2] = (unsigned char)(acc >> nacc);
+		out += 3;
+	}
+	for (; done < len; done++) {
+		acc = (acc << 6) | sixbit_dearmor_table[cp[done]];
+		nacc += 6;
+		if (nacc >= 8) {
+			nacc -= 8;
+			*out++ = (unsigned char)(acc >> nacc);
+		}
+	}
+	if (nacc != 0)
+		*out = (unsigned char)(acc << (8 - nacc));
+
+	return bitlen + 6 * len;
+}
+
+/* six-bit value to armored payload character */
+static const char sixbit_armor_table[64] =
+	"0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVW`abcdefghijklmnopqrstuvw";
+
+size_t aivdm_armor_sum(const unsigned char *bits, size_t bitlen, char *out,
+		       unsigned int *sum)
+{
+	size_t nchars = (bitlen + 5) / 6;
+	size_t i;
+	unsigned long w;
+	unsigned int x = 0;
+	const unsigned char *cp = bits;
+
+	/* three bytes to four characters */
+	for (i = 0; i < nchars; i += 4, cp += 3) {
+		w = ((unsigned long)cp[0] << 16) | ((unsigned long)cp[1] << 8) | cp[2];
+		out[i] = sixbit_armor_table[w >> 18];
+		out[i + 1] = sixbit_armor_table[(w >> 12) & 0x3f];
+		out[i + 2] = sixbit_armor_table[(w >> 6) & 0x3f];
+		out[i + 3] = sixbit_armor_table[w & 0x3f];
+		x ^= (unsigned char)(out[i] ^ out[i + 1] ^ out[i + 2] ^ out[i + 3]);
+	}
+	/* take back the characters of the last group past the payload */
+	for (; i > nchars; i--)
+		x ^= (unsigned char)out[i - 1];
+	*sum = x;
+	return nchars;
+}
+
+size_t aivdm_armor(const unsigned char *bits, size_t bitlen, char *out)
+{
+	unsigned int sum;
+
+	return aivdm_armor_sum(bits, bitlen, out, &sum);
+}
+
+const char sixbit_to_ascii[64] =
+	"@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^- !\"#$%&`()*+,-./0123456789:;<=>?";
+
+/* ASCII to six-bit; '-' gets its ITU code 45 rather than the duplicate 31 */
+const unsigned char sixbit_from_ascii[256] = {
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+	48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+	39,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+	16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+#define SIXBIT_SPACE	32
+#define SIXBIT_SPACES8	0x820820820820ULL	/* eight spaces, 48 bits */
+
+#ifdef AIVDM_HAVE_SSE2
+AIVDM_TARGET_SSE2
+static unsigned int put_text_sse2(struct bitwriter_t *bw,
+				  const unsigned char *cp, unsigned int n)
+/* map and pack sixteen characters per iteration; returns how many were done */
+{
+	const __m128i k31 = _mm_set1_epi8(31);
+	const __m128i k39 = _mm_set1_epi8(39);
+	const __m128i k63 = _mm_set1_epi8(63);
+	const __m128i k64 = _mm_set1_epi8(64);
+	const __m128i k96 = _mm_set1_epi8(96);
+	const __m128i k123 = _mm_set1_epi8(123);
+	const __m128i klow = _mm_set1_epi16(0x00ff);
+	const __m128i kmerge = _mm_set1_epi32(0x00011000);
+	unsigned int w[4];
+	unsigned int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(cp + i));
+		/* signed compares send bytes >= 128 to the '@' default */
+		__m128i punct = _mm_and_si128(_mm_cmpgt_epi8(c, k31), _mm_cmpgt_epi8(k64, c));
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, k63), _mm_cmpgt_epi8(k96, c));
+		__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, k96), _mm_cmpgt_epi8(k123, c));
+		__m128i grave = _mm_cmpeq_epi8(c, k96);
+		__m128i v = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(punct, c),
+				     _mm_and_si128(upper, _mm_sub_epi8(c, k64))),
+			_mm_or_si128(_mm_and_si128(lower, _mm_sub_epi8(c, k96)),
+				     _mm_and_si128(grave, k39)));
+
+		v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, klow), 6),
+				 _mm_srli_epi16(v, 8));
+		v = _mm_madd_epi16(v, kmerge);
+		_mm_storeu_si128((__m128i *)w, v);
+		bw_put(bw, 48, ((uint64_t)w[0] << 24) | w[1]);
+		bw_put(bw, 48, ((uint64_t)w[2] << 24) | w[3]);
+	}
+	return i;
+}
+#endif /* AIVDM_HAVE_SSE2 */
+
+void sixbit_put_text(struct bitwriter_t *bw, const char *str, unsigned int length)
+{
+	const unsigned char *cp = (const unsigned char *)str;
+	const char *nul = (const char *)memchr(str, '\0', length);
+	unsigned int n = nul != NULL ? (unsigned int)(nul - str) : length;
+	unsigned int i = 0;
+	uint64_t w;
+
+#ifdef AIVDM_HAVE_SSE2
+	if (n >= 16 && (aivdm_cpu_features() & AIVDM_CPU_SSE2))
+		i = put_text_sse2(bw, cp, n);
+#endif
+	for (; i + 8 <= n; i += 8) {
+		w = ((uint64_t)sixbit_from_ascii[cp[i]] << 42)
+		  | ((uint64_t)sixbit_from_ascii[cp[i + 1]] << 36)
+		  | ((uint64_t)sixbit_from_ascii[cp[i + 2]] << 30)
+		  | ((uint64_t)sixbit_from_ascii[cp[i + 3]] << 24)
+		  | ((uint64_t)sixbit_from_ascii[cp[i + 4]] << 18)
+		  | ((uint64_t)sixbit_from_ascii[cp[i + 5]] << 12)
+		  | ((uint64_t)sixbit_from_ascii[cp[i + 6]] << 6)
+		  | (uint64_t)sixbit_from_ascii[cp[i + 7]];
+		bw_put(bw, 48, w);
+	}
+	for (; i < n; i++)
+		bw_put(bw, 6, sixbit_from_ascii[cp[i]]);
+	for (; i + 8 <= length; i += 8)
+		bw_put(bw, 48, SIXBIT_SPACES8);
+	for (; i < length; i++)
+		bw_put(bw, 6, SIXBIT_SPACE);
+}
+
+#ifdef AIVDM_HAVE_SSE2
+AIVDM_TARGET_SSE2
+static unsigned int get_text_sse2(const unsigned char *bits, unsigned int start,
+				  unsigned int count, char *to,
+				  unsigned int *len, int *stopped)
+/* unpack and map sixteen characters per iteration, tracking '@' and trailing spaces */
+{
+	const __m128i k6 = _mm_set1_epi32(63);
+	const __m128i k31 = _mm_set1_epi8(31);
+	const __m128i k32 = _mm_set1_epi8(32);
+	const __m128i k39 = _mm_set1_epi8(39);
+	const __m128i k64 = _mm_set1_epi8(64);
+	const __m128i kdash = _mm_set1_epi8('-');
+	const __m128i kgrave = _mm_set1_epi8('`');
+	const __m128i kzero = _mm_setzero_si128();
+	unsigned int i, at, atmask, textmask;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		uint64_t a = ubits_fast(bits, start + 6 * i, 48);
+		uint64_t b = ubits_fast(bits, start + 6 * i + 48, 48);
+		/* four characters per dword, first character in the low byte */
+		__m128i w = _mm_set_epi32((int)(b & 0xffffff), (int)(b >> 24),
+					  (int)(a & 0xffffff), (int)(a >> 24));
+		__m128i v = _mm_or_si128(
+			_mm_or_si128(_mm_srli_epi32(w, 18),
+				     _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(w, 12), k6), 8)),
+			_mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(w, 6), k6), 16),
+				     _mm_slli_epi32(_mm_and_si128(w, k6), 24)));
+		__m128i c = _mm_add_epi8(v, _mm_and_si128(_mm_cmpgt_epi8(k32, v), k64));
+		__m128i is31 = _mm_cmpeq_epi8(v, k31);
+		__m128i is39 = _mm_cmpeq_epi8(v, k39);
+
+		c = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(is31, is39), c),
+				 _mm_or_si128(_mm_and_si128(is31, kdash),
+					      _mm_and_si128(is39, kgrave)));
+		_mm_storeu_si128((__m128i *)(to + i), c);
+		atmask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, kzero));
+		textmask = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(c, k32)) & 0xffff;
+		if (atmask != 0) {
+			at = aivdm_ctz32(atmask);
+			textmask &= (1U << at) - 1;
+			if (textmask != 0)
+				*len = i + aivdm_bsr32(textmask) + 1;
+			*stopped = 1;
+			return i + at;
+		}
+		if (textmask != 0)
+			*len = i + aivdm_bsr32(textmask) + 1;
+	}
+	return i;
+}
+#endif /* AIVDM_HAVE_SSE2 */
+
+size_t sixbit_get_text(const unsigned char *bits, unsigned int start,
+		       unsigned int count, char *to)
+{
+	unsigned int i = 0, k, len = 0;
+	int stopped = 0;
+	uint64_t w;
+	char c;
+
+#ifdef AIVDM_HAVE_SSE2
+	if (count >= 16 && (aivdm_cpu_features() & AIVDM_CPU_SSE2))
+		i = get_text_sse2(bits, start, count, to, &len, &stopped);
+#endif
+	while (!stopped && i < count) {
+		/* up to eight characters out of one 48-bit extraction */
+		k = count - i < 8 ? count - i : 8;
+		w = ubits_fast(bits, start + 6 * i, 6 * k);
+		for (; k > 0; k--, i++) {
+			c = sixbit_to_ascii[(w >> (6 * (k - 1))) & 0x3f];
+			if (c == '@') {
+				stopped = 1;
+				break;
+			}
+			to[i] = c;
+			if (c != ' ')
+				len = i + 1;
+		}
+	}
+	to[len] = '\0';
+	return len;
+}
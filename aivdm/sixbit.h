@@ -0,0 +1,72 @@
+/*
+ * sixbit.h - bulk conversion between AIVDM payload armoring and packed bits
+ *
+ * The AIVDM payload carries six bits per printable character, so four
+ * characters make exactly three bytes.  The kernels here work on whole
+ * groups of characters at once rather than one bit at a time.
+ *
+ * This file is Copyright (c) 2010 by the GPSD project
+ * BSD terms apply: see the file COPYING in the distribution root for details.
+ */
+#ifndef _GPSD_SIXBIT_H_
+#define _GPSD_SIXBIT_H_
+
+#include <stddef.h>
+
+#include "bits.h"
+
+/*
+ * The vector kernels store whole registers, so up to this many bytes
+ * past the last complete output byte may be scribbled on.  Size bit
+ * buffers accordingly.
+ */
+#define SIXBIT_WRITE_SLACK	8
+
+/* armored payload character to its six-bit value */
+extern const unsigned char sixbit_dearmor_table[256];
+
+/*
+ * Append len armored payload characters to the packed big-endian bit
+ * buffer at bit offset bitlen, and return the new bit length.  Bits
+ * past the returned length in the last byte are cleared.
+ */
+extern size_t aivdm_dearmor(unsigned char *bits, size_t bitlen,
+			    const char *data, size_t len);
+
+/*
+ * Armor bitlen bits (zero padded up to a whole character) as payload
+ * characters into out, and return how many were written.  Not
+ * NUL-terminated.  Works in groups of three bytes to four characters,
+ * so bits is read, and out written, up to the next whole group.
+ */
+extern size_t aivdm_armor(const unsigned char *bits, size_t bitlen, char *out);
+
+/* the same, also leaving the XOR of the characters written in *sum */
+extern size_t aivdm_armor_sum(const unsigned char *bits, size_t bitlen,
+			      char *out, unsigned int *sum);
+
+/*
+ * Six-bit text fields (names, callsigns, destinations).  The forward
+ * table folds lower case to upper case and maps anything that has no
+ * six-bit code to '@'.
+ */
+extern const char sixbit_to_ascii[64];
+extern const unsigned char sixbit_from_ascii[256];
+
+/*
+ * Append str as length six-bit characters, stopping at its NUL and
+ * padding the remainder with spaces in the same pass.
+ */
+extern void sixbit_put_text(struct bitwriter_t *bw, const char *str,
+			    unsigned int length);
+
+/*
+ * Decode count characters starting at bit start into to[], which must
+ * hold count + 1 bytes.  Decoding stops at an '@' and trailing spaces
+ * are trimmed as it goes; returns the resulting string length.  Reads
+ * with ubits_fast(), so bits needs the usual slack.
+ */
+extern size_t sixbit_get_text(const unsigned char *bits, unsigned int start,
+			      unsigned int count, char *to);
+
+#endif /* _GPSD_SIXBIT_H_ */